@@ -6,7 +6,12 @@ shift 3
 
 # extract model as pickled file
 # note that this drops unconstrained features
-kclause "$@" < "$kextractor_file" > "$kclause_file"
+# the kextractor file may have been compressed by the binding (see --compress), which we undo on the fly
+case "$kextractor_file" in
+    *.gz) gzip -dc "$kextractor_file" ;;
+    *.zst) zstd -qdc "$kextractor_file" ;;
+    *) cat "$kextractor_file" ;;
+esac | kclause "$@" > "$kclause_file"
 
 # transform model into kconfigreader format
 python3 /home/kclause2model.py "$kclause_file" > "$kconfig_model"
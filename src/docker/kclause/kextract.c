@@ -0,0 +1,221 @@
+/*
+ * libkextract: a visitor-style C API for Kconfig models extracted by kextractor (see kextract.h).
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "kextract.h"
+
+struct kextract {
+  struct snapshot snapshot;
+  // names of the symbols, hashed lazily for kextract_find (open addressing, -1 marks a free slot)
+  int32_t *name_slots;
+  size_t name_slots_size;
+  // nodes visited by the current call to kextract_visit_expr, marked with a generation number
+  uint32_t *node_marks;
+  uint32_t node_generation;
+  int32_t *node_stack;
+  int node_stack_capacity;
+};
+
+struct kextract *kextract_open(const char *path)
+{
+  struct kextract *model = calloc(1, sizeof(struct kextract));
+
+  if (!model)
+    return NULL;
+  if (snapshot_open(&model->snapshot, path) < 0) {
+    free(model);
+    return NULL;
+  }
+  return model;
+}
+
+void kextract_close(struct kextract *model)
+{
+  if (!model)
+    return;
+  snapshot_close(&model->snapshot);
+  free(model->name_slots);
+  free(model->node_marks);
+  free(model->node_stack);
+  free(model);
+}
+
+const struct snapshot *kextract_snapshot(const struct kextract *model)
+{
+  return &model->snapshot;
+}
+
+int32_t kextract_symbols_size(const struct kextract *model)
+{
+  return model->snapshot.header->symbols_size;
+}
+
+const struct snapshot_symbol *kextract_symbol(const struct kextract *model, int32_t id)
+{
+  return id >= 0 && (uint32_t) id < model->snapshot.header->symbols_size ? &model->snapshot.symbols[id] : NULL;
+}
+
+const struct snapshot_property *kextract_property(const struct kextract *model, int32_t id)
+{
+  return id >= 0 && (uint32_t) id < model->snapshot.header->properties_size ? &model->snapshot.properties[id] : NULL;
+}
+
+const struct snapshot_node *kextract_node(const struct kextract *model, int32_t id)
+{
+  return id >= 0 && (uint32_t) id < model->snapshot.header->nodes_size ? &model->snapshot.nodes[id] : NULL;
+}
+
+const char *kextract_name(const struct kextract *model, int32_t id)
+{
+  return kextract_symbol(model, id) ? snapshot_name(&model->snapshot, id) : NULL;
+}
+
+static size_t hash_name(const char *name)
+{
+  size_t hash = 5381;
+
+  while (*name)
+    hash = hash * 33 + (unsigned char) *name++;
+  return hash;
+}
+
+int32_t kextract_find(struct kextract *model, const char *name)
+{
+  const char *other;
+  size_t slot;
+  int32_t id;
+
+  if (!model->name_slots) {
+    model->name_slots_size = 1024;
+    while (model->name_slots_size < 2 * (size_t) kextract_symbols_size(model))
+      model->name_slots_size *= 2;
+    model->name_slots = malloc(model->name_slots_size * sizeof(int32_t));
+    memset(model->name_slots, -1, model->name_slots_size * sizeof(int32_t));
+    // if several symbols have the same name (e.g., constants), the first one is found
+    for (id = 0; id < kextract_symbols_size(model); id++) {
+      if (!(other = kextract_name(model, id)))
+        continue;
+      for (slot = hash_name(other) & (model->name_slots_size - 1); model->name_slots[slot] != -1;
+           slot = (slot + 1) & (model->name_slots_size - 1))
+        if (!strcmp(kextract_name(model, model->name_slots[slot]), other))
+          break;
+      if (model->name_slots[slot] == -1)
+        model->name_slots[slot] = id;
+    }
+  }
+  for (slot = hash_name(name) & (model->name_slots_size - 1); (id = model->name_slots[slot]) != -1;
+       slot = (slot + 1) & (model->name_slots_size - 1))
+    if (!strcmp(kextract_name(model, id), name))
+      return id;
+  return -1;
+}
+
+int kextract_visit_symbol(const struct kextract *model, int32_t id, const struct kextract_visitor *visitor)
+{
+  const struct snapshot *snapshot = &model->snapshot;
+  const struct snapshot_symbol *symbol = &snapshot->symbols[id];
+  const struct snapshot_property *property;
+  uint32_t i;
+  int result;
+
+  if (visitor->symbol && (result = visitor->symbol(visitor->context, id, symbol, snapshot_name(snapshot, id))))
+    return result;
+  if (visitor->property)
+    for (i = 0; i < symbol->properties_size; i++) {
+      property = &snapshot->properties[symbol->properties + i];
+      if ((result = visitor->property(visitor->context, id, symbol->properties + i, property,
+                                      snapshot_string(snapshot, property->text))))
+        return result;
+    }
+  if (visitor->choice)
+    for (i = 0; i < symbol->members_size; i++)
+      if ((result = visitor->choice(visitor->context, id, snapshot->members[symbol->members + i])))
+        return result;
+  return 0;
+}
+
+int kextract_visit(const struct kextract *model, const struct kextract_visitor *visitor)
+{
+  int32_t id;
+  int result;
+
+  for (id = 0; id < kextract_symbols_size(model); id++)
+    if ((result = kextract_visit_symbol(model, id, visitor)))
+      return result;
+  return 0;
+}
+
+/* The subexpressions of a node, if any */
+static void node_children(const struct snapshot_node *node, int32_t *left, int32_t *right)
+{
+  *left = *right = -1;
+  switch (node->type) {
+  case SNAPSHOT_E_NOT:
+  case SNAPSHOT_E_LIST:
+  case SNAPSHOT_E_CHOICE:
+    *left = node->left;
+    break;
+  case SNAPSHOT_E_AND:
+  case SNAPSHOT_E_OR:
+    *left = node->left;
+    *right = node->right;
+    break;
+  }
+}
+
+static int32_t *grow_stack(struct kextract *model, int size)
+{
+  if (size == model->node_stack_capacity) {
+    model->node_stack_capacity = model->node_stack_capacity ? 2 * model->node_stack_capacity : 256;
+    model->node_stack = realloc(model->node_stack, model->node_stack_capacity * sizeof(int32_t));
+  }
+  return model->node_stack;
+}
+
+int kextract_visit_expr(const struct kextract *model, int32_t node, const struct kextract_visitor *visitor)
+{
+  // the marks are only a cache, so we allow them to be updated for a const model
+  struct kextract *cache = (struct kextract *) model;
+  const struct snapshot *snapshot = &model->snapshot;
+  uint32_t nodes_size = snapshot->header->nodes_size;
+  int32_t top, left, right;
+  int size = 0, result;
+
+  if (node == -1 || !visitor->node)
+    return 0;
+  if (!cache->node_marks)
+    cache->node_marks = calloc(nodes_size, sizeof(uint32_t));
+  if (++cache->node_generation == 0) {
+    memset(cache->node_marks, 0, nodes_size * sizeof(uint32_t));
+    cache->node_generation = 1;
+  }
+
+  // a node is marked when it has been visited, but it may be pushed several times before (e.g., for a AND(NOT(b), b))
+  cache->node_stack = grow_stack(cache, size);
+  cache->node_stack[size++] = node;
+  while (size > 0) {
+    top = cache->node_stack[size - 1];
+    if (cache->node_marks[top] == cache->node_generation) {
+      size--;
+      continue;
+    }
+    node_children(&snapshot->nodes[top], &left, &right);
+    if (right != -1 && cache->node_marks[right] != cache->node_generation) {
+      cache->node_stack = grow_stack(cache, size);
+      cache->node_stack[size++] = right;
+    }
+    if (left != -1 && cache->node_marks[left] != cache->node_generation) {
+      cache->node_stack = grow_stack(cache, size);
+      cache->node_stack[size++] = left;
+    }
+    if (cache->node_stack[size - 1] != top)
+      continue;
+    size--;
+    cache->node_marks[top] = cache->node_generation;
+    if ((result = visitor->node(visitor->context, top, &snapshot->nodes[top])))
+      return result;
+  }
+  return 0;
+}
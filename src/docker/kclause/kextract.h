@@ -0,0 +1,66 @@
+/*
+ * libkextract: a visitor-style C API for Kconfig models extracted by kextractor.
+ *
+ * The model is read from a binary snapshot (kextractor --snapshot), which is mapped into memory, so opening a model
+ * takes no parsing, and all names and texts passed to the callbacks point directly into the mapping (valid until
+ * kextract_close). Symbols, properties, and expression nodes are identified by their indices in the snapshot
+ * (see kextractor-snapshot.h for the meaning of their fields), where -1 stands for none.
+ *
+ *   int print_symbol(void *context, int32_t id, const struct snapshot_symbol *symbol, const char *name) {
+ *     if (name) puts(name);
+ *     return 0; // a nonzero result stops the visit and is returned by kextract_visit
+ *   }
+ *   struct kextract_visitor visitor = { .symbol = print_symbol };
+ *   struct kextract *model = kextract_open("linux.kxsnapshot");
+ *   kextract_visit(model, &visitor);
+ *   kextract_close(model);
+ *
+ * kextract.py wraps this API for Python (with ctypes), so analyses can query a model in-process.
+ */
+#ifndef KEXTRACT_H
+#define KEXTRACT_H
+
+#include "kextractor-snapshot.h"
+
+struct kextract;
+
+struct kextract_visitor {
+  void *context;
+  // called for each symbol in the order of its ID
+  int (*symbol)(void *context, int32_t id, const struct snapshot_symbol *symbol, const char *name);
+  // called for each property of the symbol visited last
+  int (*property)(void *context, int32_t symbol, int32_t id, const struct snapshot_property *property, const char *text);
+  // called for each member of a choice, after the choice's properties
+  int (*choice)(void *context, int32_t choice, int32_t member);
+  // called for each node of an expression (by kextract_visit_expr), children before their parents
+  int (*node)(void *context, int32_t id, const struct snapshot_node *node);
+};
+
+/* Open a snapshot, returning NULL (with errno set) if it cannot be read or has another version */
+struct kextract *kextract_open(const char *path);
+void kextract_close(struct kextract *model);
+
+/* Access the underlying snapshot, whose arrays can also be read directly */
+const struct snapshot *kextract_snapshot(const struct kextract *model);
+
+int32_t kextract_symbols_size(const struct kextract *model);
+const struct snapshot_symbol *kextract_symbol(const struct kextract *model, int32_t id);
+const struct snapshot_property *kextract_property(const struct kextract *model, int32_t id);
+const struct snapshot_node *kextract_node(const struct kextract *model, int32_t id);
+
+/* Return the name of a symbol, or NULL if it has none */
+const char *kextract_name(const struct kextract *model, int32_t id);
+
+/* Return the ID of the symbol with the given name, or -1 if there is none */
+int32_t kextract_find(struct kextract *model, const char *name);
+
+/* Visit all symbols with their properties and choice members */
+int kextract_visit(const struct kextract *model, const struct kextract_visitor *visitor);
+
+/* Visit a single symbol with its properties and choice members */
+int kextract_visit_symbol(const struct kextract *model, int32_t id, const struct kextract_visitor *visitor);
+
+/* Visit each node of an expression once, children before their parents */
+int kextract_visit_expr(const struct kextract *model, int32_t node, const struct kextract_visitor *visitor);
+
+#endif
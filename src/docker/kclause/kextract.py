@@ -0,0 +1,166 @@
+# Python bindings for libkextract (see kextract.h), which give in-process access to Kconfig models extracted by kextractor.
+# The model is read from a binary snapshot (kextractor --snapshot) without any parsing, for example:
+#
+#   from kextract import Model
+#   with Model('linux.kxsnapshot') as model:
+#       symbol = model.symbol(model.find('MODULES'))
+#       for prop in model.properties(symbol.id):
+#           print(prop.type, model.expr(prop.visible))
+#
+# Expressions are returned as nested tuples, e.g., ('and', ('symbol', 'A'), ('not', ('symbol', 'B'))).
+import ctypes
+import os
+from collections import namedtuple
+
+SYMBOL_TYPES = ['unknown', 'boolean', 'tristate', 'int', 'hex', 'string']
+PROPERTY_TYPES = ['unknown', 'prompt', 'comment', 'menu', 'default', 'choice', 'select', 'imply', 'range', 'env', 'symbol']
+EXPR_TYPES = ['none', 'symbol', 'not', 'equal', 'unequal', 'lth', 'leq', 'gth', 'geq', 'range', 'and', 'or', 'list', 'choice']
+SYMBOL_FLAGS = {'choice': 1, 'optional': 2, 'const': 4, 'declared': 8}
+
+Symbol = namedtuple('Symbol', ['id', 'name', 'type', 'flags', 'dir_dep', 'rev_dep'])
+Property = namedtuple('Property', ['id', 'symbol', 'type', 'text', 'expr', 'visible'])
+
+
+class SnapshotSymbol(ctypes.Structure):
+    _fields_ = [('name', ctypes.c_uint32), ('type', ctypes.c_uint32), ('flags', ctypes.c_uint32),
+                ('lkc_flags', ctypes.c_uint32), ('properties', ctypes.c_uint32), ('properties_size', ctypes.c_uint32),
+                ('members', ctypes.c_uint32), ('members_size', ctypes.c_uint32),
+                ('dir_dep', ctypes.c_int32), ('rev_dep', ctypes.c_int32)]
+
+
+class SnapshotProperty(ctypes.Structure):
+    _fields_ = [('type', ctypes.c_uint32), ('text', ctypes.c_uint32),
+                ('expr', ctypes.c_int32), ('visible', ctypes.c_int32)]
+
+
+class SnapshotNode(ctypes.Structure):
+    _fields_ = [('type', ctypes.c_uint32), ('left', ctypes.c_int32), ('right', ctypes.c_int32)]
+
+
+SymbolCallback = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.c_int32,
+                                  ctypes.POINTER(SnapshotSymbol), ctypes.c_char_p)
+PropertyCallback = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.c_int32, ctypes.c_int32,
+                                    ctypes.POINTER(SnapshotProperty), ctypes.c_char_p)
+ChoiceCallback = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.c_int32, ctypes.c_int32)
+NodeCallback = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.c_int32, ctypes.POINTER(SnapshotNode))
+
+
+class Visitor(ctypes.Structure):
+    _fields_ = [('context', ctypes.c_void_p), ('symbol', SymbolCallback), ('property', PropertyCallback),
+                ('choice', ChoiceCallback), ('node', NodeCallback)]
+
+
+def load_library(path=None):
+    path = path or os.environ.get('LIBKEXTRACT', os.path.join(os.path.dirname(os.path.abspath(__file__)), 'libkextract.so'))
+    lib = ctypes.CDLL(path, use_errno=True)
+    lib.kextract_open.argtypes = [ctypes.c_char_p]
+    lib.kextract_open.restype = ctypes.c_void_p
+    lib.kextract_close.argtypes = [ctypes.c_void_p]
+    lib.kextract_symbols_size.argtypes = [ctypes.c_void_p]
+    lib.kextract_symbols_size.restype = ctypes.c_int32
+    lib.kextract_symbol.argtypes = [ctypes.c_void_p, ctypes.c_int32]
+    lib.kextract_symbol.restype = ctypes.POINTER(SnapshotSymbol)
+    lib.kextract_name.argtypes = [ctypes.c_void_p, ctypes.c_int32]
+    lib.kextract_name.restype = ctypes.c_char_p
+    lib.kextract_find.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.kextract_find.restype = ctypes.c_int32
+    lib.kextract_visit.argtypes = [ctypes.c_void_p, ctypes.POINTER(Visitor)]
+    lib.kextract_visit_symbol.argtypes = [ctypes.c_void_p, ctypes.c_int32, ctypes.POINTER(Visitor)]
+    lib.kextract_visit_expr.argtypes = [ctypes.c_void_p, ctypes.c_int32, ctypes.POINTER(Visitor)]
+    return lib
+
+
+def decode(name):
+    return name.decode('utf-8', 'replace') if name is not None else None
+
+
+class Model:
+    def __init__(self, path, library=None):
+        self.lib = load_library(library)
+        self.handle = self.lib.kextract_open(os.fsencode(path))
+        if not self.handle:
+            errno = ctypes.get_errno()
+            raise OSError(errno, os.strerror(errno), path)
+
+    def close(self):
+        if self.handle:
+            self.lib.kextract_close(self.handle)
+            self.handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def __len__(self):
+        return self.lib.kextract_symbols_size(self.handle)
+
+    def find(self, name):
+        """Returns the ID of the symbol with the given name, or -1."""
+        return self.lib.kextract_find(self.handle, name.encode())
+
+    def name(self, id):
+        return decode(self.lib.kextract_name(self.handle, id))
+
+    def symbol(self, id):
+        s = self.lib.kextract_symbol(self.handle, id).contents
+        return Symbol(id, self.name(id), SYMBOL_TYPES[s.type],
+                      {flag for flag, bit in SYMBOL_FLAGS.items() if s.flags & bit}, s.dir_dep, s.rev_dep)
+
+    def visit(self, symbol=None, property=None, choice=None, id=None):
+        """Calls the given functions for all symbols (or the symbol with the given ID), their properties, and choice members.
+        A function may return True to stop the visit."""
+        visitor = Visitor()
+        if symbol:
+            visitor.symbol = SymbolCallback(lambda _, id, s, name: bool(symbol(self.symbol(id))))
+        if property:
+            visitor.property = PropertyCallback(lambda _, sym, id, p, text: bool(property(
+                Property(id, sym, PROPERTY_TYPES[p.contents.type], decode(text), p.contents.expr, p.contents.visible))))
+        if choice:
+            visitor.choice = ChoiceCallback(lambda _, sym, member: bool(choice(sym, member)))
+        if id is None:
+            return self.lib.kextract_visit(self.handle, ctypes.byref(visitor))
+        return self.lib.kextract_visit_symbol(self.handle, id, ctypes.byref(visitor))
+
+    def symbols(self):
+        return [self.symbol(id) for id in range(len(self))]
+
+    def properties(self, id):
+        properties = []
+        self.visit(property=properties.append, id=id)
+        return properties
+
+    def members(self, id):
+        members = []
+        self.visit(choice=lambda choice, member: members.append(member), id=id)
+        return members
+
+    def expr(self, node):
+        """Returns the expression with the given root node as nested tuples, or None if there is none."""
+        if node == -1:
+            return None
+        # children are visited before their parents, so we can build each tuple from those of its children
+        exprs = {}
+
+        def visit_node(_, id, n):
+            n = n.contents
+            type = EXPR_TYPES[n.type]
+            if type in ('and', 'or'):
+                exprs[id] = (type, exprs[n.left], exprs[n.right])
+            elif type == 'not':
+                exprs[id] = (type, exprs[n.left])
+            elif type in ('list', 'choice'):
+                exprs[id] = (type, self.name(n.right), exprs[n.left] if n.left != -1 else None)
+            elif type == 'symbol':
+                exprs[id] = (type, self.name(n.left))
+            elif type == 'none':
+                exprs[id] = (type,)
+            else:
+                exprs[id] = (type, self.name(n.left), self.name(n.right))
+            return 0
+
+        visitor = Visitor()
+        visitor.node = NodeCallback(visit_node)
+        self.lib.kextract_visit_expr(self.handle, node, ctypes.byref(visitor))
+        return exprs[node]
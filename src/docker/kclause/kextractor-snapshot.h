@@ -0,0 +1,219 @@
+/*
+ * Reader for the binary snapshots written by kextractor --snapshot.
+ *
+ * A snapshot is mapped into memory as a whole and then accessed directly, without any parsing:
+ *
+ *   struct snapshot snapshot;
+ *   if (snapshot_open(&snapshot, "linux.kxsnapshot") < 0)
+ *     perror("snapshot_open");
+ *   for (id = 0; id < snapshot.header->symbols_size; id++)
+ *     puts(snapshot_name(&snapshot, id));
+ *   snapshot_close(&snapshot);
+ *
+ * The definitions in this file must match those in kextractor.c, which cannot include this file,
+ * as it is compiled as a single file inside of each system's LKC implementation.
+ * Readers reject snapshots with another version, so SNAPSHOT_VERSION must be increased whenever the layout changes.
+ */
+#ifndef KEXTRACTOR_SNAPSHOT_H
+#define KEXTRACTOR_SNAPSHOT_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SNAPSHOT_MAGIC "KXSNAPSH"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+enum snapshot_symbol_type {
+  SNAPSHOT_S_UNKNOWN,
+  SNAPSHOT_S_BOOLEAN,
+  SNAPSHOT_S_TRISTATE,
+  SNAPSHOT_S_INT,
+  SNAPSHOT_S_HEX,
+  SNAPSHOT_S_STRING,
+};
+
+enum snapshot_property_type {
+  SNAPSHOT_P_UNKNOWN,
+  SNAPSHOT_P_PROMPT,
+  SNAPSHOT_P_COMMENT,
+  SNAPSHOT_P_MENU,
+  SNAPSHOT_P_DEFAULT,
+  SNAPSHOT_P_CHOICE,
+  SNAPSHOT_P_SELECT,
+  SNAPSHOT_P_IMPLY,
+  SNAPSHOT_P_RANGE,
+  SNAPSHOT_P_ENV,
+  SNAPSHOT_P_SYMBOL,
+};
+
+enum snapshot_expr_type {
+  SNAPSHOT_E_NONE,
+  SNAPSHOT_E_SYMBOL, // left is a symbol
+  SNAPSHOT_E_NOT, // left is a node
+  SNAPSHOT_E_EQUAL, // left and right are symbols (also for the following comparisons and ranges)
+  SNAPSHOT_E_UNEQUAL,
+  SNAPSHOT_E_LTH,
+  SNAPSHOT_E_LEQ,
+  SNAPSHOT_E_GTH,
+  SNAPSHOT_E_GEQ,
+  SNAPSHOT_E_RANGE,
+  SNAPSHOT_E_AND, // left and right are nodes
+  SNAPSHOT_E_OR,
+  SNAPSHOT_E_LIST, // left is a node (or -1), right is a symbol (also for choices)
+  SNAPSHOT_E_CHOICE,
+};
+
+enum snapshot_symbol_flag {
+  SNAPSHOT_CHOICE = 1,
+  SNAPSHOT_OPTIONAL = 2,
+  SNAPSHOT_CONST = 4,
+  SNAPSHOT_DECLARED = 8, // has a P_SYMBOL property (see --kconfigs)
+};
+
+struct snapshot_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  int32_t symbol_yes, symbol_mod, symbol_no;
+  uint32_t symbols_offset, symbols_size;
+  uint32_t properties_offset, properties_size;
+  uint32_t nodes_offset, nodes_size;
+  uint32_t menus_offset, menus_size;
+  uint32_t members_offset, members_size; // choice members (symbol IDs)
+  uint32_t order_offset, order_size; // symbol IDs in LKC's symbol-table order, which --extract and --configs follow
+  uint32_t strings_offset, strings_size;
+};
+
+struct snapshot_symbol {
+  uint32_t name;
+  uint32_t type;
+  uint32_t flags;
+  uint32_t lkc_flags; // LKC's own flags, which are not stable between versions
+  uint32_t properties, properties_size;
+  uint32_t members, members_size;
+  int32_t dir_dep, rev_dep;
+};
+
+struct snapshot_property {
+  uint32_t type;
+  uint32_t text;
+  int32_t expr, visible;
+};
+
+struct snapshot_node {
+  uint32_t type;
+  int32_t left, right;
+};
+
+struct snapshot_menu {
+  int32_t symbol;
+  int32_t parent;
+  int32_t dep;
+  uint32_t prompt;
+};
+
+struct snapshot {
+  void *data;
+  size_t size;
+  const struct snapshot_header *header;
+  const struct snapshot_symbol *symbols;
+  const struct snapshot_property *properties;
+  const struct snapshot_node *nodes;
+  const struct snapshot_menu *menus;
+  const int32_t *members;
+  const int32_t *order;
+  const char *strings;
+};
+
+/* Check that a section lies within the mapped file */
+static inline int snapshot_section_valid(const struct snapshot *snapshot, uint32_t offset, uint32_t size, size_t element_size)
+{
+  return offset % 4 == 0 && offset <= snapshot->size && size <= (snapshot->size - offset) / element_size;
+}
+
+/* Map a snapshot into memory, returning 0 on success and -1 (with errno set) otherwise */
+static inline int snapshot_open(struct snapshot *snapshot, const char *path)
+{
+  const struct snapshot_header *header;
+  struct stat st;
+  int fd;
+
+  memset(snapshot, 0, sizeof(*snapshot));
+  if ((fd = open(path, O_RDONLY)) < 0)
+    return -1;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return -1;
+  }
+  if ((size_t) st.st_size < sizeof(struct snapshot_header)) {
+    close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+  snapshot->size = st.st_size;
+  snapshot->data = mmap(NULL, snapshot->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (snapshot->data == MAP_FAILED) {
+    snapshot->data = NULL;
+    return -1;
+  }
+
+  header = snapshot->header = (const struct snapshot_header *) snapshot->data;
+  if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != SNAPSHOT_VERSION || header->byte_order != SNAPSHOT_BYTE_ORDER ||
+      !snapshot_section_valid(snapshot, header->symbols_offset, header->symbols_size, sizeof(struct snapshot_symbol)) ||
+      !snapshot_section_valid(snapshot, header->properties_offset, header->properties_size, sizeof(struct snapshot_property)) ||
+      !snapshot_section_valid(snapshot, header->nodes_offset, header->nodes_size, sizeof(struct snapshot_node)) ||
+      !snapshot_section_valid(snapshot, header->menus_offset, header->menus_size, sizeof(struct snapshot_menu)) ||
+      !snapshot_section_valid(snapshot, header->members_offset, header->members_size, sizeof(int32_t)) ||
+      !snapshot_section_valid(snapshot, header->order_offset, header->order_size, sizeof(int32_t)) ||
+      !snapshot_section_valid(snapshot, header->strings_offset, header->strings_size, 1) ||
+      header->strings_size == 0 || ((const char *) snapshot->data)[header->strings_offset + header->strings_size - 1] != '\0') {
+    munmap(snapshot->data, snapshot->size);
+    memset(snapshot, 0, sizeof(*snapshot));
+    errno = EINVAL;
+    return -1;
+  }
+
+  snapshot->symbols = (const struct snapshot_symbol *) ((const char *) snapshot->data + header->symbols_offset);
+  snapshot->properties = (const struct snapshot_property *) ((const char *) snapshot->data + header->properties_offset);
+  snapshot->nodes = (const struct snapshot_node *) ((const char *) snapshot->data + header->nodes_offset);
+  snapshot->menus = (const struct snapshot_menu *) ((const char *) snapshot->data + header->menus_offset);
+  snapshot->members = (const int32_t *) ((const char *) snapshot->data + header->members_offset);
+  snapshot->order = (const int32_t *) ((const char *) snapshot->data + header->order_offset);
+  snapshot->strings = (const char *) snapshot->data + header->strings_offset;
+  return 0;
+}
+
+static inline void snapshot_close(struct snapshot *snapshot)
+{
+  if (snapshot->data)
+    munmap(snapshot->data, snapshot->size);
+  memset(snapshot, 0, sizeof(*snapshot));
+}
+
+/* Return a string from the string pool, or NULL for none */
+static inline const char *snapshot_string(const struct snapshot *snapshot, uint32_t offset)
+{
+  return offset ? snapshot->strings + offset : NULL;
+}
+
+/* Return the name of a symbol, or NULL if it has none (e.g., a choice) */
+static inline const char *snapshot_name(const struct snapshot *snapshot, int32_t id)
+{
+  return snapshot_string(snapshot, snapshot->symbols[id].name);
+}
+
+/* Check whether an expression is absent or the constant y (or m), like LKC's expr_is_yes */
+static inline int snapshot_expr_is(const struct snapshot *snapshot, int32_t node, int32_t symbol)
+{
+  return node == -1 || (snapshot->nodes[node].type == SNAPSHOT_E_SYMBOL && snapshot->nodes[node].left == symbol);
+}
+
+#endif
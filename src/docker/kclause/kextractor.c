@@ -38,7 +38,13 @@
 #include <getopt.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <signal.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define LKC_DIRECT_LINK
 #include "lkc.h"
@@ -98,9 +104,25 @@ enum {
   A_EXTRACT,
   A_DEPS,
   A_DUMP,
+  A_DIMACS,
+  A_MODEL,
+  A_SERVE,
+  A_SYMBOL_TABLE,
+  A_SNAPSHOT,
+  A_MANIFEST,
+  A_FREE_VARIABLES,
+  A_GRAPH,
+  A_GRAPH_BINARY,
+  A_COUNT,
 };
 static int action = A_NONE;
 static char* action_arg;
+static char *serve_path = NULL;
+
+// several actions can be requested at once, so that they share a single (expensive) call to conf_parse
+// each requested action has its own output file, or falls back to the file given with -o (or stdout)
+static bool action_enabled[A_COUNT];
+static char *action_output[A_COUNT];
 static bool verbose = false;
 static char* forceoff = NULL;
 
@@ -110,12 +132,505 @@ struct linked_list {
 };
 
 static struct linked_list *forceoffall = NULL;
+static bool propagate_forceoff_symbols = false;
 
 static char *config_prefix = "CONFIG_";
+static char *model_prefix = NULL; // prefix of var names in --model output, if it differs from config_prefix
 
 static bool enable_reverse_dependencies = true;
 
+static char *slice_seeds = NULL; // restricts all symbol outputs to a dependency cone (see slice_symbols)
+static char *variable_order = NULL; // numbers the features along the dependency graph (see order_feature_variables)
+static char *choice_encoding = NULL; // encodes large choices with auxiliary variables (see at_most_one)
+
 bool is_symbol(struct symbol *);
+void slice_symbols(void);
+
+/*
+ * Phase timers for the torte profiler.
+ * When torte profiles an experiment, compile-lkc-binding compiles in timers around parsing, each emission phase, and output flushing.
+ * Otherwise, the timers are removed by the preprocessor, so they cost nothing in regular extractions.
+ * The timings are appended to the stage's profile ($PROFILE_FILE) in the format of record-function-call,
+ * nested under the stack trace of the Bash function that runs us ($PROFILE_STACK), so flame graphs show our phases as well.
+ * Note that LKC finalizes the menu tree inside of conf_parse, so parsing and menu finalization are timed together.
+ */
+enum phase {
+  PHASE_KEXTRACTOR,
+  PHASE_PARSE,
+  PHASE_PREPARE,
+  PHASE_EMIT,
+  PHASE_SYMBOLS,
+  PHASE_CHOICES,
+  PHASE_DEPENDENCIES,
+  PHASE_SELECTS,
+  PHASE_REVERSE_DEPENDENCIES,
+  PHASE_DIMACS,
+  PHASE_MODEL,
+  PHASE_SNAPSHOT,
+  PHASE_GRAPH,
+  PHASE_FLUSH,
+  PHASE_COUNT,
+};
+
+#if PROFILE_PHASES
+struct phase_timer {
+  const char *stack; // the phase and its enclosing phases, innermost first (like FUNCNAME in Bash)
+  long long calls;
+  long long total_time_us;
+  struct timeval start;
+};
+
+static struct phase_timer phase_timers[PHASE_COUNT] = {
+  { "kextractor" },
+  { "conf_parse;kextractor" },
+  { "prepare;kextractor" },
+  { "emit;kextractor" },
+  { "symbols;emit;kextractor" },
+  { "choices;emit;kextractor" },
+  { "dependencies;emit;kextractor" },
+  { "selects;emit;kextractor" },
+  { "reverse_dependencies;emit;kextractor" },
+  { "dimacs;emit;kextractor" },
+  { "model;emit;kextractor" },
+  { "snapshot;emit;kextractor" },
+  { "graph;emit;kextractor" },
+  { "flush;kextractor" },
+};
+
+void end_phase(struct phase_timer *timer)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  timer->calls++;
+  timer->total_time_us += (long long) (now.tv_sec - timer->start.tv_sec) * 1000000 + (now.tv_usec - timer->start.tv_usec);
+}
+
+/* Append the timed phases to the profile, if torte requested one */
+void print_phases(void)
+{
+  char *file = getenv("PROFILE_FILE"), *stage = getenv("PROFILE_STAGE"), *stack = getenv("PROFILE_STACK");
+  struct phase_timer *timer;
+  FILE *fp;
+
+  if (!file || !(fp = fopen(file, "a")))
+    return;
+  for (timer = phase_timers; timer < phase_timers + PHASE_COUNT; timer++)
+    if (timer->calls > 0)
+      fprintf(fp, "%s,%.*s,%s%s%s,%lld,%lld\n", stage ? stage : "", (int) strcspn(timer->stack, ";"), timer->stack,
+              timer->stack, stack && *stack ? ";" : "", stack ? stack : "", timer->calls, timer->total_time_us);
+  fclose(fp);
+}
+
+#define PHASE_BEGIN(phase) gettimeofday(&phase_timers[phase].start, NULL)
+#define PHASE_END(phase) end_phase(&phase_timers[phase])
+#define PHASE_REPORT() print_phases()
+#else
+#define PHASE_BEGIN(phase)
+#define PHASE_END(phase)
+#define PHASE_REPORT()
+#endif
+
+/*
+ * A small hash map with keys of three words, which we use to look up symbols and other LKC objects.
+ * Values must be non-negative, as -1 marks empty slots.
+ */
+struct hash_map {
+  uintptr_t (*keys)[3];
+  int *values;
+  size_t capacity;
+  size_t size;
+};
+
+static size_t hash_map_slot(struct hash_map *map, uintptr_t a, uintptr_t b, uintptr_t c)
+{
+  uint64_t hash = (a * 0x9E3779B97F4A7C15ULL) ^ (b * 0xC2B2AE3D27D4EB4FULL) ^ (c * 0x165667B19E3779F9ULL);
+  size_t slot = (hash ^ (hash >> 29)) & (map->capacity - 1);
+  while (map->values[slot] != -1 &&
+         (map->keys[slot][0] != a || map->keys[slot][1] != b || map->keys[slot][2] != c))
+    slot = (slot + 1) & (map->capacity - 1);
+  return slot;
+}
+
+int hash_map_get(struct hash_map *map, uintptr_t a, uintptr_t b, uintptr_t c)
+{
+  if (!map->capacity)
+    return -1;
+  return map->values[hash_map_slot(map, a, b, c)];
+}
+
+void hash_map_put(struct hash_map *map, uintptr_t a, uintptr_t b, uintptr_t c, int value)
+{
+  size_t slot, i;
+
+  if (2 * (map->size + 1) > map->capacity) {
+    struct hash_map grown = { .capacity = map->capacity ? 2 * map->capacity : 1024 };
+    grown.keys = malloc(grown.capacity * sizeof(*grown.keys));
+    grown.values = malloc(grown.capacity * sizeof(*grown.values));
+    memset(grown.values, 0xff, grown.capacity * sizeof(*grown.values));
+    for (i = 0; i < map->capacity; i++)
+      if (map->values[i] != -1)
+        hash_map_put(&grown, map->keys[i][0], map->keys[i][1], map->keys[i][2], map->values[i]);
+    free(map->keys);
+    free(map->values);
+    *map = grown;
+  }
+  slot = hash_map_slot(map, a, b, c);
+  if (map->values[slot] == -1)
+    map->size++;
+  map->keys[slot][0] = a;
+  map->keys[slot][1] = b;
+  map->keys[slot][2] = c;
+  map->values[slot] = value;
+}
+
+/*
+ * Buffered output.
+ * All actions write through a struct output, which collects text in a buffer and hands it to write(2) in large chunks.
+ * An output without a file is kept in memory, which we use to defer parts of an output (e.g., the dependencies in --extract).
+ * With --stdio, all outputs are written through stdio instead, so both paths can be compared byte for byte.
+ */
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+
+struct output {
+  FILE *fp; // NULL for in-memory outputs
+  char *data;
+  size_t size;
+  size_t capacity;
+  size_t bytes; // written in total (before compression), for --stats
+  pid_t compressor; // the process compressing this output, if any
+};
+
+static bool stdio_output = false;
+static struct output stdout_output;
+static struct output *action_out[A_COUNT];
+
+void output_flush(struct output *out)
+{
+  size_t written = 0;
+  ssize_t result;
+
+  if (!out->fp)
+    return;
+  fflush(out->fp); // anything written directly to the stream (e.g., by zconfdump) comes first
+  while (written < out->size) {
+    result = write(fileno(out->fp), out->data + written, out->size - written);
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EPIPE)
+        break; // the reader has gone away (only when SIGPIPE is ignored in --serve)
+      perror("write");
+      exit(1);
+    }
+    written += result;
+  }
+  out->size = 0;
+}
+
+void output_write(struct output *out, const char *data, size_t size)
+{
+  out->bytes += size;
+  if (stdio_output && out->fp) {
+    fwrite(data, 1, size, out->fp);
+    return;
+  }
+  if (out->fp && out->size + size > OUTPUT_BUFFER_SIZE)
+    output_flush(out);
+  if (out->size + size > out->capacity) {
+    while (out->size + size > out->capacity)
+      out->capacity = out->capacity ? 2 * out->capacity : OUTPUT_BUFFER_SIZE;
+    out->data = realloc(out->data, out->capacity);
+  }
+  memcpy(out->data + out->size, data, size);
+  out->size += size;
+}
+
+/* Append an in-memory output to another output and release its buffer */
+void output_append(struct output *out, struct output *from)
+{
+  if (from->size > 0) // a sliced output may be empty
+    output_write(out, from->data, from->size);
+  free(from->data);
+  from->data = NULL;
+  from->size = from->capacity = 0;
+}
+
+static inline void out_str(struct output *out, const char *str)
+{
+  output_write(out, str, strlen(str));
+}
+
+static inline void out_line(struct output *out, const char *str)
+{
+  out_str(out, str);
+  output_write(out, "\n", 1);
+}
+
+void out_int(struct output *out, int value)
+{
+  char buffer[12], *p = buffer + sizeof(buffer);
+  unsigned int magnitude = value < 0 ? -(unsigned int) value : (unsigned int) value;
+
+  do {
+    *--p = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude);
+  if (value < 0)
+    *--p = '-';
+  output_write(out, p, buffer + sizeof(buffer) - p);
+}
+
+/*
+ * Symbol names are printed many times, so we compute each prefixed or escaped name only once.
+ * The names are stored consecutively in a simple arena that is never freed.
+ */
+struct output_name {
+  const char *data;
+  size_t size;
+};
+
+static struct output_name *output_names = NULL;
+static int output_names_size = 0, output_names_capacity = 0;
+static struct hash_map output_name_ids;
+static char *name_arena = NULL;
+static size_t name_arena_left = 0;
+
+static char *name_arena_alloc(size_t size)
+{
+  char *p;
+
+  if (size > name_arena_left) {
+    name_arena_left = size > OUTPUT_BUFFER_SIZE ? size : OUTPUT_BUFFER_SIZE;
+    name_arena = malloc(name_arena_left);
+  }
+  p = name_arena;
+  name_arena += size;
+  name_arena_left -= size;
+  return p;
+}
+
+/* Escape quotes and backslashes in a string value in a single pass */
+static struct output_name escape_string_value(const char *in)
+{
+  struct output_name name;
+  const char *p;
+  char *q;
+  size_t len = strlen(in) + strlen("\"\"");
+
+  for (p = in; *p; p++)
+    if (*p == '"' || *p == '\\')
+      len++;
+  name.data = q = name_arena_alloc(len);
+  name.size = len;
+  *q++ = '"';
+  for (p = in; *p; p++) {
+    if (*p == '"' || *p == '\\')
+      *q++ = '\\';
+    *q++ = *p;
+  }
+  *q = '"';
+  return name;
+}
+
+static struct output_name *output_name(struct symbol *sym, bool escaped)
+{
+  int id = hash_map_get(&output_name_ids, (uintptr_t) sym, escaped, 0);
+
+  if (id == -1) {
+    if (output_names_size == output_names_capacity) {
+      output_names_capacity = output_names_capacity ? 2 * output_names_capacity : 1024;
+      output_names = realloc(output_names, output_names_capacity * sizeof(*output_names));
+    }
+    if (escaped)
+      output_names[output_names_size] = escape_string_value(sym->name);
+    else {
+      size_t prefix_size = strlen(config_prefix), name_size = strlen(sym->name);
+      char *data = name_arena_alloc(prefix_size + name_size);
+      memcpy(data, config_prefix, prefix_size);
+      memcpy(data + prefix_size, sym->name, name_size);
+      output_names[output_names_size].data = data;
+      output_names[output_names_size].size = prefix_size + name_size;
+    }
+    id = output_names_size++;
+    hash_map_put(&output_name_ids, (uintptr_t) sym, escaped, 0, id);
+  }
+  return &output_names[id];
+}
+
+/* Print the name of a symbol with the configured prefix */
+void out_name(struct output *out, struct symbol *sym)
+{
+  struct output_name *name = output_name(sym, false);
+  output_write(out, name->data, name->size);
+}
+
+/* Print the name of an unknown symbol (i.e., a constant) as an escaped string */
+void out_escaped_name(struct output *out, struct symbol *sym)
+{
+  struct output_name *name = output_name(sym, true);
+  output_write(out, name->data, name->size);
+}
+
+/*
+ * Shared subexpressions (--shared-expressions).
+ * LKC propagates menu dependencies into every prompt, default, and select, so the same subexpressions are printed over and over.
+ * We intern expressions by their operator and the IDs of their children, so structurally identical subexpressions get the same ID.
+ * Conjunctions and disjunctions that are referenced more than once are then printed once as a definition and referenced as E@<id>.
+ */
+struct shared_expr {
+  struct expr *expr; // representative expression
+  int references;
+};
+
+static bool shared_expressions = false;
+static struct shared_expr *shared_exprs = NULL;
+static int shared_exprs_size = 0, shared_exprs_capacity = 0;
+static struct hash_map shared_expr_ids, shared_expr_pointers;
+static struct expr *shared_definition = NULL; // the expression whose definition is currently printed
+
+/* Split an expression into its subexpressions and its symbol operands (which are identified by their address) */
+void intern_operands(struct expr *e, struct expr **left_expr, struct expr **right_expr, uintptr_t *left, uintptr_t *right)
+{
+  *left_expr = *right_expr = NULL;
+  *left = *right = 0;
+  switch (e->type) {
+#if HAS_E_NOT
+  case E_NOT:
+    *left_expr = e->left.expr;
+    break;
+#endif
+#if HAS_E_AND
+  case E_AND:
+    *left_expr = e->left.expr;
+    *right_expr = e->right.expr;
+    break;
+#endif
+#if HAS_E_OR
+  case E_OR:
+    *left_expr = e->left.expr;
+    *right_expr = e->right.expr;
+    break;
+#endif
+#if HAS_E_LIST
+  case E_LIST:
+    *left_expr = e->left.expr;
+    *right = (uintptr_t) e->right.sym;
+    break;
+#endif
+#if HAS_E_CHOICE
+  case E_CHOICE:
+    *left_expr = e->left.expr;
+    *right = (uintptr_t) e->right.sym;
+    break;
+#endif
+#if HAS_E_SYMBOL
+  case E_SYMBOL:
+    *left = (uintptr_t) e->left.sym;
+    break;
+#endif
+  default:
+    // comparisons and ranges
+    *left = (uintptr_t) e->left.sym;
+    *right = (uintptr_t) e->right.sym;
+    break;
+  }
+}
+
+/* Intern an expression and all its subexpressions in post-order (with an explicit stack, as long select chains are deep) */
+int intern_expr(struct expr *e)
+{
+  static struct expr **stack = NULL;
+  static int stack_capacity = 0;
+  struct expr *top, *left_expr, *right_expr;
+  uintptr_t left, right;
+  int size = 0, id;
+
+  if (!e)
+    return -1;
+  if ((id = hash_map_get(&shared_expr_pointers, (uintptr_t) e, 0, 0)) != -1)
+    return id;
+  if (!stack) {
+    stack_capacity = 256;
+    stack = malloc(stack_capacity * sizeof(struct expr *));
+  }
+  stack[size++] = e;
+  while (size > 0) {
+    top = stack[size - 1];
+    if (hash_map_get(&shared_expr_pointers, (uintptr_t) top, 0, 0) != -1) {
+      size--;
+      continue;
+    }
+    // children are interned first, so we postpone this expression until they are
+    intern_operands(top, &left_expr, &right_expr, &left, &right);
+    if (size + 2 > stack_capacity) {
+      stack_capacity *= 2;
+      stack = realloc(stack, stack_capacity * sizeof(struct expr *));
+    }
+    if (right_expr && hash_map_get(&shared_expr_pointers, (uintptr_t) right_expr, 0, 0) == -1)
+      stack[size++] = right_expr;
+    if (left_expr && hash_map_get(&shared_expr_pointers, (uintptr_t) left_expr, 0, 0) == -1)
+      stack[size++] = left_expr;
+    if (stack[size - 1] != top)
+      continue;
+    size--;
+
+    // child expressions are identified by their ID (shifted by one, so that missing children are 0)
+    if (left_expr)
+      left = hash_map_get(&shared_expr_pointers, (uintptr_t) left_expr, 0, 0) + 1;
+    if (right_expr)
+      right = hash_map_get(&shared_expr_pointers, (uintptr_t) right_expr, 0, 0) + 1;
+    if ((id = hash_map_get(&shared_expr_ids, top->type, left, right)) == -1) {
+      if (shared_exprs_size == shared_exprs_capacity) {
+        shared_exprs_capacity = shared_exprs_capacity ? 2 * shared_exprs_capacity : 4096;
+        shared_exprs = realloc(shared_exprs, shared_exprs_capacity * sizeof(struct shared_expr));
+      }
+      id = shared_exprs_size++;
+      shared_exprs[id].expr = top;
+      shared_exprs[id].references = 0;
+      hash_map_put(&shared_expr_ids, top->type, left, right, id);
+      // each distinct parent references its children once
+#if HAS_E_NOT
+      if (top->type == E_NOT)
+        shared_exprs[left - 1].references++;
+#endif
+#if HAS_E_AND && HAS_E_OR
+      if (top->type == E_AND || top->type == E_OR) {
+        shared_exprs[left - 1].references++;
+        shared_exprs[right - 1].references++;
+      }
+#endif
+    }
+    hash_map_put(&shared_expr_pointers, (uintptr_t) top, 0, 0, id);
+  }
+  return hash_map_get(&shared_expr_pointers, (uintptr_t) e, 0, 0);
+}
+
+/* Register a top-level use of an expression */
+void share_expr(struct expr *e)
+{
+  int id;
+
+  if (e) {
+    id = intern_expr(e); // may grow shared_exprs
+    shared_exprs[id].references++;
+  }
+}
+
+/* Return the ID of a shared expression, or -1 if the expression should be printed inline */
+int shared_expr_id(struct expr *e)
+{
+  int id;
+
+  if (!shared_expressions || e == shared_definition)
+    return -1;
+#if HAS_E_AND && HAS_E_OR
+  if (e->type != E_AND && e->type != E_OR)
+    return -1;
+#endif
+  id = hash_map_get(&shared_expr_pointers, (uintptr_t) e, 0, 0);
+  return id != -1 && shared_exprs[id].references > 1 ? id : -1;
+}
 
 static int _expr_compare_type(enum expr_type t1, enum expr_type t2)
 {
@@ -183,37 +698,121 @@ static int _expr_compare_type(enum expr_type t1, enum expr_type t2)
  * Recursively search in symbols referenced in the expression.
  */
 
-void print_symbol_detail(FILE *out, struct symbol *sym, bool force_naked) {
+void print_symbol_detail(struct output *out, struct symbol *sym, bool force_naked) {
   if (sym->name) {
     /* fprintf(stderr, "name = %s, type = %d\n", sym->name, sym->type); */
     if (strcmp(sym->name, "y") == 0 ||
         strcmp(sym->name, "m") == 0) {
-      fprintf(out, "1");
+      out_str(out, "1");
     } else if (strcmp(sym->name, "n") == 0) {
-      fprintf(out, "0");
+      out_str(out, "0");
     } else if (S_UNKNOWN == sym->type) {
-      fprintf(out, "0");
+      out_str(out, "0");
     } else {
       if (! force_naked) {
-        fprintf(out, "(defined CONFIG_%s)", sym->name);
+        out_str(out, "(defined CONFIG_");
+        out_str(out, sym->name);
+        out_str(out, ")");
       } else {
-        fprintf(out, "CONFIG_%s", sym->name);
+        out_str(out, "CONFIG_");
+        out_str(out, sym->name);
       }
     }
   } else {
-    fprintf(out, "1");
+    out_str(out, "1");
   }
 }
 
-static void print_symbol(FILE *out, struct symbol *sym) {
+static void print_symbol(struct output *out, struct symbol *sym) {
   print_symbol_detail(out, sym, false);
 }
 
+/*
+ * Expressions are printed with an explicit stack instead of recursion, as reverse dependencies of heavily selected symbols
+ * are chains of hundreds of operands. A printer prints the leading part of an expression and pushes the rest as tasks,
+ * which are either subexpressions (possibly for another printer) or text. Tasks are pushed in reverse order.
+ */
+struct expr_stack;
+typedef void (*expr_printer)(struct expr *e, struct output *out, enum expr_type prevtoken, struct expr_stack *stack);
+
+struct expr_task {
+  expr_printer printer; // NULL for text
+  struct expr *expr;
+  enum expr_type prevtoken;
+  const char *text;
+};
+
+struct expr_stack {
+  struct expr_task *tasks;
+  int size;
+  int capacity;
+};
+
+void push_expr_task(struct expr_stack *stack, expr_printer printer, struct expr *e, enum expr_type prevtoken, const char *text)
+{
+  if (stack->size == stack->capacity) {
+    stack->capacity = stack->capacity ? 2 * stack->capacity : 256;
+    stack->tasks = realloc(stack->tasks, stack->capacity * sizeof(struct expr_task));
+  }
+  stack->tasks[stack->size].printer = printer;
+  stack->tasks[stack->size].expr = e;
+  stack->tasks[stack->size].prevtoken = prevtoken;
+  stack->tasks[stack->size].text = text;
+  stack->size++;
+}
+
+static inline void push_expr(struct expr_stack *stack, expr_printer printer, struct expr *e, enum expr_type prevtoken)
+{
+  push_expr_task(stack, printer, e, prevtoken, NULL);
+}
+
+static inline void push_text(struct expr_stack *stack, const char *text)
+{
+  push_expr_task(stack, NULL, NULL, E_NONE, text);
+}
+
+void print_expr_with(expr_printer printer, struct expr *e, struct output *out, enum expr_type prevtoken)
+{
+  static struct expr_stack stack;
+  struct expr_task task;
+  int base = stack.size;
+
+  push_expr(&stack, printer, e, prevtoken);
+  while (stack.size > base) {
+    task = stack.tasks[--stack.size];
+    if (task.printer)
+      task.printer(task.expr, out, task.prevtoken, &stack);
+    else
+      out_str(out, task.text);
+  }
+}
+
+static void my_print_expr_step(struct expr *e, struct output *out, enum expr_type prevtoken, struct expr_stack *stack);
+static void print_python_expr_step(struct expr *e, struct output *out, enum expr_type prevtoken, struct expr_stack *stack);
+
 // use E_NONE for first call to print_expr's prevtoken
- void my_print_expr(struct expr *e, FILE *out, enum expr_type prevtoken)
+void my_print_expr(struct expr *e, struct output *out, enum expr_type prevtoken)
 {
-	if (_expr_compare_type(prevtoken, e->type) > 0)
-		fprintf(out, "(");
+  print_expr_with(my_print_expr_step, e, out, prevtoken);
+}
+
+void print_python_expr(struct expr *e, struct output *out, enum expr_type prevtoken)
+{
+  print_expr_with(print_python_expr_step, e, out, prevtoken);
+}
+
+static void my_print_expr_step(struct expr *e, struct output *out, enum expr_type prevtoken, struct expr_stack *stack)
+{
+	int id = shared_expr_id(e);
+	if (id != -1) {
+		out_str(out, "E@");
+		out_int(out, id);
+		return;
+	}
+	if (_expr_compare_type(prevtoken, e->type) > 0) {
+		out_str(out, "(");
+		push_text(stack, ")");
+	}
 	switch (e->type) {
 #if HAS_E_NONE
   case E_NONE:
@@ -226,8 +825,8 @@ static void print_symbol(FILE *out, struct symbol *sym) {
 #endif
 #if HAS_E_NOT
 	case E_NOT:
-    fprintf(out, "!");
-    my_print_expr(e->left.expr, out, E_NOT);
+    out_str(out, "!");
+    push_expr(stack, my_print_expr_step, e->left.expr, E_NOT);
 		break;
 #endif
 #if HAS_E_EQUAL
@@ -236,12 +835,12 @@ static void print_symbol(FILE *out, struct symbol *sym) {
         strcmp(e->right.sym->name, "m") == 0) {
       print_symbol(out, e->left.sym);
     } else if (strcmp(e->right.sym->name, "n") == 0) {
-      fprintf(out, "!");
+      out_str(out, "!");
       print_symbol(out, e->left.sym);
     } else {
       // don't print (defined ... ) around config
       print_symbol_detail(out, e->left.sym, true);
-      fprintf(out, "==");
+      out_str(out, "==");
       print_symbol_detail(out, e->right.sym, true);
     }
 		break;
@@ -250,40 +849,40 @@ static void print_symbol(FILE *out, struct symbol *sym) {
 	case E_UNEQUAL:
     if (strcmp(e->right.sym->name, "y") == 0 ||
         strcmp(e->right.sym->name, "m") == 0) {
-      fprintf(out, "!");
+      out_str(out, "!");
       print_symbol(out, e->left.sym);
     } else if (strcmp(e->right.sym->name, "n") == 0) {
       print_symbol(out, e->left.sym);
     } else {
       // don't print (defined ... ) around config
       print_symbol_detail(out, e->left.sym, true);
-      fprintf(out, "!=");
+      out_str(out, "!=");
       print_symbol_detail(out, e->right.sym, true);
     }
 		break;
 #endif
 #if HAS_E_OR
 	case E_OR:
-    my_print_expr(e->left.expr, out, E_OR);
-    fprintf(out, " || ");
-    my_print_expr(e->right.expr, out, E_OR);
+    push_expr(stack, my_print_expr_step, e->right.expr, E_OR);
+    push_text(stack, " || ");
+    push_expr(stack, my_print_expr_step, e->left.expr, E_OR);
 		break;
 #endif
 #if HAS_E_AND
 	case E_AND:
-    my_print_expr(e->left.expr, out, E_AND);
-    fprintf(out, " && ");
-    my_print_expr(e->right.expr, out, E_AND);
+    push_expr(stack, my_print_expr_step, e->right.expr, E_AND);
+    push_text(stack, " && ");
+    push_expr(stack, my_print_expr_step, e->left.expr, E_AND);
 		break;
 #endif
 #if HAS_E_LIST
 	case E_LIST:
     //E_LIST is created in menu_finalize and is related to <choice>
     print_symbol(out, e->right.sym);
-    fprintf(out, " ");
+    out_str(out, " ");
 		if (e->left.expr) {
-      fprintf(out, "^ ");
-      my_print_expr(e->left.expr, out, E_LIST);
+      out_str(out, "^ ");
+      push_expr(stack, my_print_expr_step, e->left.expr, E_LIST);
 		}
 		break;
 #endif
@@ -291,102 +890,66 @@ static void print_symbol(FILE *out, struct symbol *sym) {
 	case E_CHOICE:
     //E_LIST is created in menu_finalize and is related to <choice>
     print_symbol(out, e->right.sym);
-    fprintf(out, " ");
+    out_str(out, " ");
 		if (e->left.expr) {
-      fprintf(out, "^ ");
-      my_print_expr(e->left.expr, out, E_CHOICE);
+      out_str(out, "^ ");
+      push_expr(stack, my_print_expr_step, e->left.expr, E_CHOICE);
 		}
 		break;
 #endif
 #if HAS_E_RANGE
 	case E_RANGE:
-    fprintf(out, "[");
+    out_str(out, "[");
     print_symbol(out, e->left.sym);
     print_symbol(out, e->right.sym);
-    fprintf(out, "]");
+    out_str(out, "]");
 		break;
 #endif
 	default:
-		fprintf(out, "<unknown type %d>", e->type);
+		out_str(out, "<unknown type ");
+		out_int(out, e->type);
+		out_str(out, ">");
 		break;
 	}
-	if (_expr_compare_type(prevtoken, e->type) > 0)
-		fprintf(out, ")");
-}
-
-/* The returned pointer must be freed on the caller side */
-static char *escape_string_value(const char *in)
-{
-	const char *p;
-	char *out;
-	size_t len;
-
-	len = strlen(in) + strlen("\"\"") + 1;
-
-	p = in;
-	while (1) {
-		p += strcspn(p, "\"\\");
-
-		if (p[0] == '\0')
-			break;
-
-		len++;
-		p++;
-	}
-
-	out = malloc(len);
-	out[0] = '\0';
-
-	strcat(out, "\"");
-
-	p = in;
-	while (1) {
-		len = strcspn(p, "\"\\");
-		strncat(out, p, len);
-		p += len;
-
-		if (p[0] == '\0')
-			break;
-
-		strcat(out, "\\");
-		strncat(out, p++, 1);
-	}
-
-	strcat(out, "\"");
-
-	return out;
 }
 
-void print_python_symbol_detail(FILE *out, struct symbol *sym, bool force_naked) {
+void print_python_symbol_detail(struct output *out, struct symbol *sym, bool force_naked) {
   if (sym->name) {
     if (strcmp(sym->name, "y") == 0 ||
         strcmp(sym->name, "m") == 0) {
-      fprintf(out, "1");
+      out_str(out, "1");
     } else if (strcmp(sym->name, "n") == 0) {
-      fprintf(out, "0");
+      out_str(out, "0");
     } else if (S_UNKNOWN == sym->type) {
-      fprintf(out, "%s", escape_string_value(sym->name));
+      out_escaped_name(out, sym);
     } else {
       if (! force_naked) {
-        fprintf(out, "%s%s", config_prefix, sym->name);
+        out_name(out, sym);
       } else {
-        fprintf(out, "%s%s", config_prefix, sym->name);
+        out_name(out, sym);
       }
     }
   } else {
-    fprintf(out, "1");
+    out_str(out, "1");
   }
 }
 
-void print_python_symbol(FILE *out, struct symbol *sym) {
+void print_python_symbol(struct output *out, struct symbol *sym) {
   print_python_symbol_detail(out, sym, false);
 }
 
-// use E_NONE for first call to print_expr's prevtoken
-void print_python_expr(struct expr *e, FILE *out, enum expr_type prevtoken)
+static void print_python_expr_step(struct expr *e, struct output *out, enum expr_type prevtoken, struct expr_stack *stack)
 {
-	if (_expr_compare_type(prevtoken, e->type) > 0)
-		fprintf(out, "(");
+	int id = shared_expr_id(e);
+	if (id != -1) {
+		out_str(out, "E@");
+		out_int(out, id);
+		return;
+	}
+	if (_expr_compare_type(prevtoken, e->type) > 0) {
+		out_str(out, "(");
+		push_text(stack, ")");
+	}
 	switch (e->type) {
 #if HAS_E_NONE
   case E_NONE:
@@ -399,25 +962,25 @@ void print_python_expr(struct expr *e, FILE *out, enum expr_type prevtoken)
 #endif
 #if HAS_E_NOT
 	case E_NOT:
-    fprintf(out, " not ");
-    print_python_expr(e->left.expr, out, E_NOT);
+    out_str(out, " not ");
+    push_expr(stack, print_python_expr_step, e->left.expr, E_NOT);
 		break;
 #endif
 #if HAS_E_EQUAL
 	case E_EQUAL:
     if (strcmp(e->right.sym->name, "y") == 0) {
       print_python_symbol(out, e->left.sym);
-			fprintf(out, "==y");
+			out_str(out, "==y");
 		} else if (strcmp(e->right.sym->name, "m") == 0) {
       print_python_symbol(out, e->left.sym);
-			fprintf(out, "==m");
+			out_str(out, "==m");
     } else if (strcmp(e->right.sym->name, "n") == 0) {
-      fprintf(out, " not ");
+      out_str(out, " not ");
       print_python_symbol(out, e->left.sym);
     } else {
       // don't print (defined ... ) around config
       print_python_symbol_detail(out, e->left.sym, true);
-      fprintf(out, "==");
+      out_str(out, "==");
       print_python_symbol_detail(out, e->right.sym, true);
     }
 		break;
@@ -425,63 +988,63 @@ void print_python_expr(struct expr *e, FILE *out, enum expr_type prevtoken)
 #if HAS_E_UNEQUAL
 	case E_UNEQUAL:
     if (strcmp(e->right.sym->name, "y") == 0) {
-      fprintf(out, " not ");
+      out_str(out, " not ");
       print_python_symbol(out, e->left.sym);
-			fprintf(out, "==y");
+			out_str(out, "==y");
     } else if (strcmp(e->right.sym->name, "m") == 0) {
       // TODO: actually print out ==m instead
-      fprintf(out, " not ");
+      out_str(out, " not ");
       print_python_symbol(out, e->left.sym);
-			fprintf(out, "==m");
+			out_str(out, "==m");
     } else if (strcmp(e->right.sym->name, "n") == 0) {
       print_python_symbol(out, e->left.sym);
     } else {
       // don't print (defined ... ) around config
       print_python_symbol_detail(out, e->left.sym, true);
-      fprintf(out, "!=");
+      out_str(out, "!=");
       print_python_symbol_detail(out, e->right.sym, true);
     }
 		break;
 #endif
 #if HAS_E_OR
 	case E_OR:
-    print_python_expr(e->left.expr, out, E_OR);
-    fprintf(out, " or ");
-    print_python_expr(e->right.expr, out, E_OR);
+    push_expr(stack, print_python_expr_step, e->right.expr, E_OR);
+    push_text(stack, " or ");
+    push_expr(stack, print_python_expr_step, e->left.expr, E_OR);
 		break;
 #endif
 #if HAS_E_AND
 	case E_AND:
-    print_python_expr(e->left.expr, out, E_AND);
-    fprintf(out, " and ");
-    print_python_expr(e->right.expr, out, E_AND);
+    push_expr(stack, print_python_expr_step, e->right.expr, E_AND);
+    push_text(stack, " and ");
+    push_expr(stack, print_python_expr_step, e->left.expr, E_AND);
 		break;
 #endif
 #if HAS_E_LTH
 	case E_LTH:
     print_python_symbol(out, e->left.sym);
-    fprintf(out, " < ");
+    out_str(out, " < ");
     print_python_symbol(out, e->right.sym);
 		break;
 #endif
 #if HAS_E_LEQ
 	case E_LEQ:
     print_python_symbol(out, e->left.sym);
-    fprintf(out, " <= ");
+    out_str(out, " <= ");
     print_python_symbol(out, e->right.sym);
 		break;
 #endif
 #if HAS_E_GTH
 	case E_GTH:
     print_python_symbol(out, e->left.sym);
-    fprintf(out, " > ");
+    out_str(out, " > ");
     print_python_symbol(out, e->right.sym);
 		break;
 #endif
 #if HAS_E_GEQ
 	case E_GEQ:
     print_python_symbol(out, e->left.sym);
-    fprintf(out, " >= ");
+    out_str(out, " >= ");
     print_python_symbol(out, e->right.sym);
 		break;
 #endif
@@ -489,10 +1052,10 @@ void print_python_expr(struct expr *e, FILE *out, enum expr_type prevtoken)
 	case E_LIST:
     //E_LIST is created in menu_finalize and is related to <choice>
     print_python_symbol(out, e->right.sym);
-    fprintf(out, " ");
+    out_str(out, " ");
 		if (e->left.expr) {
-      fprintf(out, "^ ");
-      my_print_expr(e->left.expr, out, E_LIST);
+      out_str(out, "^ ");
+      push_expr(stack, my_print_expr_step, e->left.expr, E_LIST);
 		}
 		break;
 #endif
@@ -500,19 +1063,19 @@ void print_python_expr(struct expr *e, FILE *out, enum expr_type prevtoken)
 	case E_CHOICE:
     //E_LIST is created in menu_finalize and is related to <choice>
     print_python_symbol(out, e->right.sym);
-    fprintf(out, " ");
+    out_str(out, " ");
 		if (e->left.expr) {
-      fprintf(out, "^ ");
-      my_print_expr(e->left.expr, out, E_CHOICE);
+      out_str(out, "^ ");
+      push_expr(stack, my_print_expr_step, e->left.expr, E_CHOICE);
 		}
 		break;
 #endif
 #if HAS_E_RANGE
 	case E_RANGE:
-    fprintf(out, "[");
+    out_str(out, "[");
     print_python_symbol(out, e->left.sym);
     print_python_symbol(out, e->right.sym);
-    fprintf(out, "]");
+    out_str(out, "]");
 		break;
 #endif
 	/* default: */
@@ -522,8 +1085,6 @@ void print_python_expr(struct expr *e, FILE *out, enum expr_type prevtoken)
 	/* 	break; */
 	/*   } */
 	}
-	if (_expr_compare_type(prevtoken, e->type) > 0)
-		fprintf(out, ")");
 }
 
 static inline int expr_is_mod(struct expr *e)
@@ -561,73 +1122,3913 @@ bool never(struct symbol *sym)
   return false;
 }
 
-/* Check whether a configuration variable should be forced to off */
-bool check_forceoff(struct symbol *sym)
+/* Look up a symbol by name, with or without the configured prefix */
+struct symbol *find_symbol(const char *name)
+{
+  size_t prefix_size = strlen(config_prefix);
+  struct symbol *sym = sym_find(name);
+
+  if (!sym && prefix_size > 0 && !strncmp(name, config_prefix, prefix_size))
+    sym = sym_find(name + prefix_size);
+  return sym;
+}
+
+static struct hash_map forceoff_symbols;
+
+/* Resolve the names given with --forceoff and --forceoffall into a set of symbols, once the Kconfig files are parsed */
+void load_forceoff(void)
 {
   struct linked_list *p;
+  struct symbol *sym;
 
   for (p = forceoffall; p != NULL; p = p->next)
-    if (!strcmp(p->data, sym->name))
-      return true;
+    if ((sym = find_symbol(p->data)))
+      hash_map_put(&forceoff_symbols, (uintptr_t) sym, 0, 0, 0);
+  if (NULL != forceoff && (sym = find_symbol(forceoff)))
+    hash_map_put(&forceoff_symbols, (uintptr_t) sym, 0, 0, 0);
+}
 
-  return NULL != forceoff && !strcmp(forceoff, sym->name);
+/* Check whether a configuration variable should be forced to off */
+bool check_forceoff(struct symbol *sym)
+{
+  return hash_map_get(&forceoff_symbols, (uintptr_t) sym, 0, 0) != -1;
 }
 
-/* Write out the config files with no configuration variables set */
-void everyno(void)
+/*
+ * Expression simplification (--simplify and --propagate-forceoff).
+ * With --propagate-forceoff, forced-off Boolean and tristate variables are replaced by n in all expressions.
+ * With --simplify, constants are folded, comparisons of Boolean variables with y and n are decided, undefined symbols become n,
+ * and chains of conjunctions and disjunctions are flattened, so that duplicate and absorbed operands can be removed.
+ * LKC expressions are binary, so flattened chains are rebuilt as balanced trees, which keeps the printed formulas flat and their depth logarithmic.
+ * Simplified expressions are memoized, so expressions that LKC shares between properties stay shared.
+ */
+static bool simplify_expressions_enabled = false;
+static struct hash_map simplified_expr_ids, canonical_expr_ids;
+static struct expr **simplified_exprs = NULL;
+static int simplified_exprs_size = 0, simplified_exprs_capacity = 0;
+
+bool is_forced_off(struct symbol *sym)
 {
-  char *cfiles[] = { ".config",
-                     "include/config/auto.conf.cmd",
-                     "include/config/auto.conf",
-                     "include/config/tristate.conf" };
-  char *zfiles[] = { "include/generated/autoconf.h",
-                     "include/config/auto.conf.cmd" };
-  int i;
+  return (sym->type == S_BOOLEAN || sym->type == S_TRISTATE) && check_forceoff(sym);
+}
 
-#define ARRAY_SIZE(a) (sizeof(a)/sizeof(*a))
+struct expr *new_expr(enum expr_type type, void *left, void *right)
+{
+  struct expr *e = calloc(1, sizeof(struct expr));
 
-  for (i = 0; i < ARRAY_SIZE(cfiles); i++)
-    if (truncate(cfiles[i], 0))
-      perror("truncate");
+  e->type = type;
+  e->left.expr = left;
+  e->right.expr = right;
+  return e;
+}
 
-  for (i = 0; i < ARRAY_SIZE(zfiles); i++)
-    if (truncate(zfiles[i], 0))
-      perror("truncate");
+int remember_expr(struct hash_map *map, uintptr_t a, uintptr_t b, uintptr_t c, struct expr *e)
+{
+  if (simplified_exprs_size == simplified_exprs_capacity) {
+    simplified_exprs_capacity = simplified_exprs_capacity ? 2 * simplified_exprs_capacity : 4096;
+    simplified_exprs = realloc(simplified_exprs, simplified_exprs_capacity * sizeof(struct expr *));
+  }
+  simplified_exprs[simplified_exprs_size] = e;
+  hash_map_put(map, a, b, c, simplified_exprs_size);
+  return simplified_exprs_size++;
 }
 
-bool is_symbol(struct symbol *sym)
+/* Return an expression, creating it only if no structurally identical expression was created before (with --simplify) */
+struct expr *make_expr(enum expr_type type, void *left, void *right)
 {
-#if HAS_P_SYMBOL // removed in Linux 6.11 (https://github.com/torvalds/linux/commit/96490176f1e11947be2bdd2700075275e2c27310)
-  struct property *st;
-  for_all_properties(sym, st, P_SYMBOL)
-    return true;
-#endif    
-  return false;
+  int id;
+
+  if (!simplify_expressions_enabled)
+    return new_expr(type, left, right);
+  // children are canonical themselves, so comparing their addresses suffices
+  if ((id = hash_map_get(&canonical_expr_ids, type, (uintptr_t) left, (uintptr_t) right)) != -1)
+    return simplified_exprs[id];
+  id = remember_expr(&canonical_expr_ids, type, (uintptr_t) left, (uintptr_t) right, new_expr(type, left, right)); // may grow simplified_exprs
+  return simplified_exprs[id];
 }
 
-void print_menusyms(struct menu *m)
+struct expr *constant_expr(bool value)
 {
-  while (m) {
-    if (m->sym && m->sym->name && strlen(m->sym->name) > 0)
-      printf("%s\n", m->sym->name);
-    if (m->list)
-      print_menusyms(m->list);
-    m = m->next;
+  static struct expr *yes = NULL, *no = NULL;
+
+  if (!yes) {
+    yes = make_expr(E_SYMBOL, &symbol_yes, NULL);
+    no = make_expr(E_SYMBOL, &symbol_no, NULL);
   }
+  return value ? yes : no;
 }
 
-void print_usage(void)
+static inline bool is_tristate_constant(struct symbol *sym)
 {
-  printf("USAGE\n");
-  printf("%s [options] --ACTION Kconfig\n", progname);
-  printf("\n");
+  return sym == &symbol_yes || sym == &symbol_mod || sym == &symbol_no;
+}
+
+static inline struct symbol *simplify_symbol(struct symbol *sym)
+{
+  if (!sym || is_tristate_constant(sym))
+    return sym;
+  if (propagate_forceoff_symbols && is_forced_off(sym))
+    return &symbol_no;
+  return sym;
+}
+
+struct expr *simplify_expr(struct expr *e);
+
+/* A list of distinct operands, whose indices are found in expr_list_ids by the address and the ID of the list */
+struct expr_list {
+  struct expr **exprs;
+  int size, capacity, id;
+};
+
+static struct hash_map expr_list_ids;
+static int expr_lists_size = 0;
+
+void expr_list_add(struct expr_list *list, struct expr *e)
+{
+  if (!list->id)
+    list->id = ++expr_lists_size;
+  if (hash_map_get(&expr_list_ids, (uintptr_t) e, list->id, 0) != -1)
+    return; // canonical expressions are equal if and only if they are identical
+  if (list->size == list->capacity) {
+    list->capacity = list->capacity ? 2 * list->capacity : 8;
+    list->exprs = realloc(list->exprs, list->capacity * sizeof(struct expr *));
+  }
+  hash_map_put(&expr_list_ids, (uintptr_t) e, list->id, 0, list->size);
+  list->exprs[list->size++] = e;
+}
+
+struct operand_frame {
+  struct expr *expr;
+  bool simplified;
+};
+
+/*
+ * Collect the distinct operands of a chain of conjunctions or disjunctions, simplifying each operand on the way.
+ * Simplifying an operand may collect the operands of another chain, so each call has its own stack.
+ */
+void collect_operands(struct expr *e, enum expr_type type, struct expr_list *operands)
+{
+  struct operand_frame *stack, top;
+  int size = 0, capacity = 256;
+
+  stack = malloc(capacity * sizeof(struct operand_frame));
+  stack[size].expr = e;
+  stack[size++].simplified = false;
+  while (size > 0) {
+    top = stack[--size];
+    if (!top.simplified && top.expr->type != type) {
+      top.expr = simplify_expr(top.expr);
+      top.simplified = true;
+    }
+    if (top.expr->type != type) {
+      expr_list_add(operands, top.expr);
+      continue;
+    }
+    if (size + 2 > capacity) {
+      capacity *= 2;
+      stack = realloc(stack, capacity * sizeof(struct operand_frame));
+    }
+    stack[size].expr = top.expr->right.expr;
+    stack[size++].simplified = top.simplified;
+    stack[size].expr = top.expr->left.expr;
+    stack[size++].simplified = top.simplified;
+  }
+  free(stack);
+}
+
+/* Check whether a chain of the given type contains any operand of the list other than the one at the given index */
+bool contains_other_operand(struct expr *e, enum expr_type type, struct expr_list *operands, int index)
+{
+  static struct expr **stack = NULL;
+  static int stack_capacity = 0;
+  int size = 0, id;
+
+  if (!stack) {
+    stack_capacity = 256;
+    stack = malloc(stack_capacity * sizeof(struct expr *));
+  }
+  stack[size++] = e;
+  while (size > 0) {
+    e = stack[--size];
+    if ((id = hash_map_get(&expr_list_ids, (uintptr_t) e, operands->id, 0)) != -1 && id != index)
+      return true;
+    if (e->type != type)
+      continue;
+    if (size + 2 > stack_capacity) {
+      stack_capacity *= 2;
+      stack = realloc(stack, stack_capacity * sizeof(struct expr *));
+    }
+    stack[size++] = e->right.expr;
+    stack[size++] = e->left.expr;
+  }
+  return false;
+}
+
+struct expr *balanced_expr(enum expr_type type, struct expr **operands, int size)
+{
+  if (size == 1)
+    return operands[0];
+  return make_expr(type, balanced_expr(type, operands, size / 2), balanced_expr(type, operands + size / 2, size - size / 2));
+}
+
+/* Simplify a conjunction (E_AND) or disjunction (E_OR) as a flat list of operands */
+struct expr *simplify_chain(struct expr *e, enum expr_type type, enum expr_type dual_type)
+{
+  struct expr_list operands = { NULL }, kept = { NULL };
+  struct expr *result;
+  bool neutral_value = type == E_AND;
+  int i;
+
+  collect_operands(e, type, &operands);
+  for (i = 0; i < operands.size; i++)
+    if (operands.exprs[i] == constant_expr(!neutral_value)) {
+      free(operands.exprs);
+      return constant_expr(!neutral_value);
+    }
+  for (i = 0; i < operands.size; i++) {
+    if (operands.exprs[i] == constant_expr(neutral_value))
+      continue;
+    // absorption: a and (a or b) = a, a or (a and b) = a
+    if (operands.exprs[i]->type != dual_type || !contains_other_operand(operands.exprs[i], dual_type, &operands, i))
+      expr_list_add(&kept, operands.exprs[i]);
+  }
+  result = kept.size == 0 ? constant_expr(neutral_value) : balanced_expr(type, kept.exprs, kept.size);
+  free(operands.exprs);
+  free(kept.exprs);
+  return result;
+}
+
+struct expr *simplify_expr(struct expr *e)
+{
+  struct expr *left, *right, *result = e;
+  struct symbol *left_sym, *right_sym;
+  int id;
+
+  if (!e)
+    return NULL;
+  if ((id = hash_map_get(&simplified_expr_ids, (uintptr_t) e, 0, 0)) != -1)
+    return simplified_exprs[id];
+
+  switch (e->type) {
+#if HAS_E_SYMBOL
+  case E_SYMBOL:
+    left_sym = simplify_symbol(e->left.sym);
+    if (left_sym == &symbol_yes || left_sym == &symbol_no)
+      result = constant_expr(left_sym == &symbol_yes);
+    else if (simplify_expressions_enabled && left_sym->type == S_UNKNOWN && !(left_sym->flags & SYMBOL_CONST))
+      result = constant_expr(false); // undefined symbols are n (constants, however, may be values of nonbooleans)
+    else if (simplify_expressions_enabled)
+      result = make_expr(E_SYMBOL, left_sym, NULL);
+    break;
+#endif
+#if HAS_E_NOT
+  case E_NOT:
+    left = simplify_expr(e->left.expr);
+    if (expr_is_yes(left) || expr_is_no(left))
+      result = constant_expr(expr_is_no(left));
+    else if (simplify_expressions_enabled && left->type == E_NOT)
+      result = left->left.expr;
+    else if (left != e->left.expr || simplify_expressions_enabled)
+      result = make_expr(E_NOT, left, NULL);
+    break;
+#endif
+#if HAS_E_AND
+  case E_AND:
+    if (simplify_expressions_enabled) {
+      result = simplify_chain(e, E_AND, E_OR);
+      break;
+    }
+    left = simplify_expr(e->left.expr);
+    right = simplify_expr(e->right.expr);
+    if (expr_is_no(left) || expr_is_no(right))
+      result = constant_expr(false);
+    else if (expr_is_yes(left))
+      result = right;
+    else if (expr_is_yes(right))
+      result = left;
+    else if (left != e->left.expr || right != e->right.expr)
+      result = make_expr(E_AND, left, right);
+    break;
+#endif
+#if HAS_E_OR
+  case E_OR:
+    if (simplify_expressions_enabled) {
+      result = simplify_chain(e, E_OR, E_AND);
+      break;
+    }
+    left = simplify_expr(e->left.expr);
+    right = simplify_expr(e->right.expr);
+    if (expr_is_yes(left) || expr_is_yes(right))
+      result = constant_expr(true);
+    else if (expr_is_no(left))
+      result = right;
+    else if (expr_is_no(right))
+      result = left;
+    else if (left != e->left.expr || right != e->right.expr)
+      result = make_expr(E_OR, left, right);
+    break;
+#endif
+#if HAS_E_LIST
+  case E_LIST:
+    break;
+#endif
+#if HAS_E_CHOICE
+  case E_CHOICE:
+    break;
+#endif
+#if HAS_E_RANGE
+  case E_RANGE:
+    break;
+#endif
+#if HAS_E_NONE
+  case E_NONE:
+    break;
+#endif
+  default:
+    // comparisons, of which we can decide (in)equalities between tristate constants and, with --simplify,
+    // between a symbol and itself and between a Boolean variable and y or n
+    left_sym = simplify_symbol(e->left.sym);
+    right_sym = simplify_symbol(e->right.sym);
+    if (left_sym == e->left.sym && right_sym == e->right.sym && !simplify_expressions_enabled)
+      break;
+#if HAS_E_EQUAL && HAS_E_UNEQUAL
+    if (e->type == E_EQUAL || e->type == E_UNEQUAL) {
+      bool equal = e->type == E_EQUAL;
+      if (is_tristate_constant(left_sym) && is_tristate_constant(right_sym)) {
+        result = constant_expr((left_sym == right_sym) == equal);
+        break;
+      }
+      if (simplify_expressions_enabled && left_sym == right_sym) {
+        result = constant_expr(equal);
+        break;
+      }
+      if (simplify_expressions_enabled && is_tristate_constant(left_sym)) {
+        struct symbol *swap = left_sym;
+        left_sym = right_sym;
+        right_sym = swap;
+      }
+      if (simplify_expressions_enabled && left_sym->type == S_BOOLEAN && !(left_sym->flags & SYMBOL_CONST) &&
+          (right_sym == &symbol_yes || right_sym == &symbol_no)) {
+        result = make_expr(E_SYMBOL, left_sym, NULL);
+        if ((right_sym == &symbol_yes) != equal)
+          result = make_expr(E_NOT, result, NULL);
+        break;
+      }
+    }
+#endif
+    result = make_expr(e->type, left_sym, right_sym);
+    break;
+  }
+
+  remember_expr(&simplified_expr_ids, (uintptr_t) e, 0, 0, result);
+  return result;
+}
+
+/* Simplify a condition, which LKC omits when it is always true */
+static inline struct expr *simplify_condition(struct expr *e)
+{
+  e = simplify_expr(e);
+  return expr_is_yes(e) ? NULL : e;
+}
+
+/*
+ * Simplify all properties, dependencies, and reverse dependencies in place, so that all actions emit the simplified model.
+ * Forced-off variables themselves depend on n, variables that select them depend on the select's condition being false
+ * (as LKC lets selects override dependencies, this does not cover variables that are selected themselves),
+ * selects and defaults that can never apply are removed, and conditions that become true are dropped.
+ */
+void simplify_symbols(void)
+{
+  struct symbol *sym;
+  struct property *prop, **link;
+  int i;
+
+  _for_all_symbols(sym) {
+    bool forced_off = propagate_forceoff_symbols && is_forced_off(sym);
+    if (forced_off) {
+#if HAS_dir_dep
+      sym->dir_dep.expr = constant_expr(false);
+#endif
+      sym->rev_dep.expr = NULL;
+    } else {
+#if HAS_dir_dep
+      sym->dir_dep.expr = simplify_condition(sym->dir_dep.expr);
+#endif
+      sym->rev_dep.expr = simplify_expr(sym->rev_dep.expr);
+      if (expr_is_no(sym->rev_dep.expr))
+        sym->rev_dep.expr = NULL;
+    }
+
+    for (link = &sym->prop; (prop = *link); ) {
+      bool never_applies;
+      prop->visible.expr = simplify_condition(prop->visible.expr);
+      never_applies = expr_is_no(prop->visible.expr);
+#if HAS_P_SELECT
+      if (prop->type == P_SELECT) {
+        // selects of forced-off variables never apply
+        never_applies = never_applies || forced_off;
+        if (!never_applies && propagate_forceoff_symbols && prop->expr && prop->expr->type == E_SYMBOL &&
+            is_forced_off(prop->expr->left.sym)) {
+          // a forced-off variable cannot be selected, so the selecting variable depends on the select's condition being false
+#if HAS_dir_dep
+          struct expr *condition_off = simplify_expr(make_expr(E_NOT, prop->visible.expr ? prop->visible.expr : constant_expr(true), NULL));
+          sym->dir_dep.expr = simplify_condition(sym->dir_dep.expr ? make_expr(E_AND, sym->dir_dep.expr, condition_off) : condition_off);
+#endif
+          never_applies = true;
+        }
+      } else
+#endif
+        prop->expr = simplify_expr(prop->expr);
+#if HAS_P_DEFAULT
+      if (prop->type == P_DEFAULT && never_applies) {
+        *link = prop->next;
+        continue;
+      }
+#endif
+#if HAS_P_SELECT
+      if (prop->type == P_SELECT && never_applies) {
+        *link = prop->next;
+        continue;
+      }
+#endif
+      link = &prop->next;
+    }
+  }
+}
+
+/* Write out the config files with no configuration variables set */
+void everyno(void)
+{
+  char *cfiles[] = { ".config",
+                     "include/config/auto.conf.cmd",
+                     "include/config/auto.conf",
+                     "include/config/tristate.conf" };
+  char *zfiles[] = { "include/generated/autoconf.h",
+                     "include/config/auto.conf.cmd" };
+  int i;
+
+#define ARRAY_SIZE(a) (sizeof(a)/sizeof(*a))
+
+  for (i = 0; i < ARRAY_SIZE(cfiles); i++)
+    if (truncate(cfiles[i], 0))
+      perror("truncate");
+
+  for (i = 0; i < ARRAY_SIZE(zfiles); i++)
+    if (truncate(zfiles[i], 0))
+      perror("truncate");
+}
+
+bool is_symbol(struct symbol *sym)
+{
+#if HAS_P_SYMBOL // removed in Linux 6.11 (https://github.com/torvalds/linux/commit/96490176f1e11947be2bdd2700075275e2c27310)
+  struct property *st;
+  for_all_properties(sym, st, P_SYMBOL)
+    return true;
+#endif    
+  return false;
+}
+
+void print_menusyms(struct output *out, struct menu *m)
+{
+  while (m) {
+    if (m->sym && m->sym->name && strlen(m->sym->name) > 0)
+      out_line(out, m->sym->name);
+    if (m->list)
+      print_menusyms(out, m->list);
+    m = m->next;
+  }
+}
+
+/*
+ * Dense symbol IDs (--symbol-table).
+ * Symbols are numbered in menu-tree order, followed by all remaining symbols in symbol-table order,
+ * so that identical Kconfig trees always yield identical IDs.
+ */
+static struct hash_map symbol_ids;
+static struct symbol **symbols_by_id = NULL;
+static int symbols_by_id_size = 0, symbols_by_id_capacity = 0;
+
+int symbol_id(struct symbol *sym)
+{
+  int id = hash_map_get(&symbol_ids, (uintptr_t) sym, 0, 0);
+
+  if (id != -1)
+    return id;
+  if (symbols_by_id_size == symbols_by_id_capacity) {
+    symbols_by_id_capacity = symbols_by_id_capacity ? 2 * symbols_by_id_capacity : 1024;
+    symbols_by_id = realloc(symbols_by_id, symbols_by_id_capacity * sizeof(struct symbol *));
+  }
+  symbols_by_id[symbols_by_id_size] = sym;
+  hash_map_put(&symbol_ids, (uintptr_t) sym, 0, 0, symbols_by_id_size);
+  return symbols_by_id_size++;
+}
+
+/*
+ * Canonical output order (--canonical).
+ * By default, symbols are printed in the order of LKC's symbol table, which depends on the hash function and table size
+ * of each LKC version. In canonical mode, symbols are sorted by name (ties, such as unnamed choices, by their position in the
+ * menu tree), and selects and choice members by the name of their symbol, so semantically identical Kconfig files
+ * yield byte-identical outputs. Defaults keep their order, as the first applicable default wins.
+ */
+static bool canonical_output = false;
+static struct symbol **output_symbols = NULL;
+static int output_symbols_size = 0;
+
+// iterates over all symbols in output order (requires number_symbols and an int i)
+#define _for_output_symbols(sym) for (i = 0; i < output_symbols_size && ((sym) = output_symbols[i]); i++)
+
+struct sort_item {
+  const char *name; // NULL comes first
+  int constant;
+  int id; // position in the menu tree, if any
+  int index; // original position, which makes the sort stable
+  void *item;
+};
+
+static int compare_sort_items(const void *a, const void *b)
+{
+  const struct sort_item *x = a, *y = b;
+  int result;
+
+  if (!x->name != !y->name)
+    return x->name ? 1 : -1;
+  if (x->name && (result = strcmp(x->name, y->name)))
+    return result;
+  if (x->constant != y->constant)
+    return x->constant - y->constant;
+  if (x->id != y->id)
+    return x->id < y->id ? -1 : 1;
+  return x->index < y->index ? -1 : x->index > y->index;
+}
+
+static void init_sort_item(struct sort_item *item, struct symbol *sym, int index, void *data)
+{
+  int id = sym ? hash_map_get(&symbol_ids, (uintptr_t) sym, 0, 0) : -1;
+
+  item->name = sym ? sym->name : NULL;
+  item->constant = sym && (sym->flags & SYMBOL_CONST);
+  item->id = id == -1 ? symbols_by_id_size : id;
+  item->index = index;
+  item->item = data;
+}
+
+/* Sort symbols canonically (see above) */
+void sort_symbols(struct symbol **symbols, int size)
+{
+  struct sort_item *items = malloc(size * sizeof(struct sort_item));
+  int i;
+
+  for (i = 0; i < size; i++)
+    init_sort_item(&items[i], symbols[i], i, symbols[i]);
+  qsort(items, size, sizeof(struct sort_item), compare_sort_items);
+  for (i = 0; i < size; i++)
+    symbols[i] = items[i].item;
+  free(items);
+}
+
+/* Sort select properties canonically by the symbol they select */
+void sort_selects(struct property **selects, int size)
+{
+  struct sort_item *items = malloc(size * sizeof(struct sort_item));
+  int i;
+
+  for (i = 0; i < size; i++)
+    init_sort_item(&items[i], selects[i]->expr && selects[i]->expr->type == E_SYMBOL ? selects[i]->expr->left.sym : NULL,
+                   i, selects[i]);
+  qsort(items, size, sizeof(struct sort_item), compare_sort_items);
+  for (i = 0; i < size; i++)
+    selects[i] = items[i].item;
+  free(items);
+}
+
+/* Collect the members of a choice, sorted in canonical mode (the caller frees the array) */
+struct symbol **choice_members(struct symbol *sym, int *size)
+{
+  struct choice_type *choice;
+  struct symbol *def_sym, **members = NULL;
+  struct expr *e;
+
+  *size = 0;
+  if (!sym_is_choice(sym) || !(choice = choice_function(sym)))
+    return NULL;
+  choice_loop
+    if (def_sym) {
+      members = realloc(members, (*size + 1) * sizeof(struct symbol *));
+      members[(*size)++] = def_sym;
+    }
+  }
+  if (canonical_output)
+    sort_symbols(members, *size);
+  return members;
+}
+
+/*
+ * Number all symbols and determine their output order.
+ * The symbols in the menu tree are numbered first, so that they can break ties when sorting canonically.
+ */
+void number_symbols(void)
+{
+  struct menu *menu;
+  struct symbol *sym;
+  int i;
+
+  if (symbols_by_id_size > 0)
+    return;
+  for (menu = rootmenu.list; menu; ) {
+    if (menu->sym)
+      symbol_id(menu->sym);
+    if (menu->list)
+      menu = menu->list;
+    else if (menu->next)
+      menu = menu->next;
+    else while ((menu = menu->parent)) {
+      if (menu->next) {
+        menu = menu->next;
+        break;
+      }
+    }
+  }
+  _for_all_symbols(sym)
+    output_symbols_size++;
+  output_symbols = malloc(output_symbols_size * sizeof(struct symbol *));
+  output_symbols_size = 0;
+  _for_all_symbols(sym)
+    output_symbols[output_symbols_size++] = sym;
+  if (canonical_output)
+    sort_symbols(output_symbols, output_symbols_size);
+  _for_output_symbols(sym)
+    symbol_id(sym);
+  if (slice_seeds)
+    slice_symbols();
+}
+
+/* Print the ID and name of each symbol in a line (unnamed symbols, such as choices, have an empty name) */
+void print_symbol_table(struct output *out)
+{
+  int id;
+
+  number_symbols();
+  for (id = 0; id < symbols_by_id_size; id++) {
+    out_int(out, id);
+    out_str(out, " ");
+    out_line(out, symbols_by_id[id]->name ? symbols_by_id[id]->name : "");
+  }
+}
+
+/*
+ * Parsed-file manifest (--manifest).
+ * The manifest lists each Kconfig file that LKC has opened with its git blob ID (i.e., the SHA-1 of "blob <size>\0" and
+ * the file's content), as well as each environment variable that LKC has read with its value:
+ *
+ *   file <blob ID, or - if the file cannot be read> <path>
+ *   env <name> <value>
+ *
+ * Together, these determine the parsed model, so extraction can use the manifest as a cache key (see extraction.sh),
+ * which can even be checked against the blobs of a revision before checking it out.
+ * We take both lists from the dependency file LKC writes for make (file_write_dep), whose format is stable since Linux 2.6.
+ */
+#define MANIFEST_DEPENDENCY_FILE ".kextractor-manifest.d"
+
+struct sha1 {
+  uint32_t state[5];
+  uint64_t size;
+  unsigned char block[64];
+};
+
+static inline uint32_t sha1_rotate(uint32_t value, int bits)
+{
+  return value << bits | value >> (32 - bits);
+}
+
+static void sha1_transform(struct sha1 *ctx)
+{
+  uint32_t w[80], a, b, c, d, e, f, k, temp;
+  int t;
+
+  for (t = 0; t < 16; t++)
+    w[t] = (uint32_t) ctx->block[4 * t] << 24 | (uint32_t) ctx->block[4 * t + 1] << 16 |
+           (uint32_t) ctx->block[4 * t + 2] << 8 | (uint32_t) ctx->block[4 * t + 3];
+  for (; t < 80; t++)
+    w[t] = sha1_rotate(w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1);
+  a = ctx->state[0];
+  b = ctx->state[1];
+  c = ctx->state[2];
+  d = ctx->state[3];
+  e = ctx->state[4];
+  for (t = 0; t < 80; t++) {
+    if (t < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5a827999;
+    } else if (t < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ed9eba1;
+    } else if (t < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8f1bbcdc;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xca62c1d6;
+    }
+    temp = sha1_rotate(a, 5) + f + e + k + w[t];
+    e = d;
+    d = c;
+    c = sha1_rotate(b, 30);
+    b = a;
+    a = temp;
+  }
+  ctx->state[0] += a;
+  ctx->state[1] += b;
+  ctx->state[2] += c;
+  ctx->state[3] += d;
+  ctx->state[4] += e;
+}
+
+static void sha1_init(struct sha1 *ctx)
+{
+  ctx->state[0] = 0x67452301;
+  ctx->state[1] = 0xefcdab89;
+  ctx->state[2] = 0x98badcfe;
+  ctx->state[3] = 0x10325476;
+  ctx->state[4] = 0xc3d2e1f0;
+  ctx->size = 0;
+}
+
+static void sha1_update(struct sha1 *ctx, const void *data, size_t size)
+{
+  const unsigned char *bytes = data;
+
+  while (size-- > 0) {
+    ctx->block[ctx->size++ % 64] = *bytes++;
+    if (ctx->size % 64 == 0)
+      sha1_transform(ctx);
+  }
+}
+
+static void sha1_final(struct sha1 *ctx, char hex[41])
+{
+  uint64_t bits = ctx->size * 8;
+  unsigned char byte = 0x80;
+  int i;
+
+  sha1_update(ctx, &byte, 1);
+  byte = 0;
+  while (ctx->size % 64 != 56)
+    sha1_update(ctx, &byte, 1);
+  for (i = 7; i >= 0; i--) {
+    byte = bits >> (8 * i);
+    sha1_update(ctx, &byte, 1);
+  }
+  for (i = 0; i < 20; i++)
+    sprintf(hex + 2 * i, "%02x", (ctx->state[i / 4] >> (24 - 8 * (i % 4))) & 0xff);
+}
+
+/* Compute the git blob ID of a file (as git hash-object does), returning false if it cannot be read */
+bool file_blob_id(const char *path, char hex[41])
+{
+  struct sha1 ctx;
+  struct stat st;
+  char buffer[8192];
+  size_t size;
+  FILE *fp;
+
+  if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) || !(fp = fopen(path, "rb")))
+    return false;
+  sha1_init(&ctx);
+  size = sprintf(buffer, "blob %lu", (unsigned long) st.st_size);
+  sha1_update(&ctx, buffer, size + 1);
+  while ((size = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+    sha1_update(&ctx, buffer, size);
+  fclose(fp);
+  sha1_final(&ctx, hex);
+  return true;
+}
+
+void print_manifest_file(struct output *out, const char *path)
+{
+  char hex[41], *srctree = getenv("srctree"), *source_path;
+  bool found = file_blob_id(path, hex);
+
+  // newer versions of LKC look up relative paths in $srctree as well
+  if (!found && srctree && path[0] != '/') {
+    source_path = malloc(strlen(srctree) + strlen(path) + 2);
+    sprintf(source_path, "%s/%s", srctree, path);
+    found = file_blob_id(source_path, hex);
+    free(source_path);
+  }
+  out_str(out, "file ");
+  out_str(out, found ? hex : "-");
+  out_str(out, " ");
+  out_line(out, path);
+}
+
+void print_manifest(struct output *out)
+{
+  // these variables select the architecture, so we record them even if LKC does not (e.g., in old versions)
+  static const char *architecture_variables[] = { "ARCH", "SRCARCH", "SUBARCH", NULL };
+  bool architecture_printed[3] = { false, false, false };
+  int i;
+#if HAS_file_write_dep
+  char *line = NULL, *name, *value, *p;
+  size_t len = 0;
+  FILE *fp;
+
+  // LKC lists the opened files as "\t<path> \" (the last one without a backslash in old versions),
+  // and the environment variables read as 'ifneq "$(<name>)" "<value>"'
+  if (file_write_dep(MANIFEST_DEPENDENCY_FILE) != 0 || !(fp = fopen(MANIFEST_DEPENDENCY_FILE, "r"))) {
+    fprintf(stderr, "could not list the parsed files\n");
+    exit(1);
+  }
+  while (getline(&line, &len, fp) != -1) {
+    line[strcspn(line, "\n")] = '\0';
+    if (line[0] == '\t' && line[1] != '$' && line[1] != '\0') {
+      p = line + strlen(line);
+      if (p - line > 2 && !strcmp(p - 2, " \\"))
+        p[-2] = '\0';
+      print_manifest_file(out, line + 1);
+    } else if (!strncmp(line, "ifneq \"$(", strlen("ifneq \"$("))) {
+      name = line + strlen("ifneq \"$(");
+      if (!(p = strstr(name, ")\" \"")))
+        continue;
+      *p = '\0';
+      value = p + strlen(")\" \"");
+      if ((p = strrchr(value, '"')))
+        *p = '\0';
+      for (i = 0; architecture_variables[i]; i++)
+        if (!strcmp(name, architecture_variables[i]))
+          architecture_printed[i] = true;
+      out_str(out, "env ");
+      out_str(out, name);
+      out_str(out, " ");
+      out_line(out, value);
+    }
+  }
+  free(line);
+  fclose(fp);
+  unlink(MANIFEST_DEPENDENCY_FILE);
+#else
+  // without a file list, the manifest cannot serve as a cache key, which extraction.sh detects by the missing file lines
+  fprintf(stderr, "this LKC implementation does not list the parsed files\n");
+#endif
+  for (i = 0; architecture_variables[i]; i++)
+    if (!architecture_printed[i] && getenv(architecture_variables[i])) {
+      out_str(out, "env ");
+      out_str(out, architecture_variables[i]);
+      out_str(out, " ");
+      out_line(out, getenv(architecture_variables[i]));
+    }
+}
+
+/*
+ * Binary snapshot (--snapshot).
+ * The snapshot stores the parsed symbols, properties, menus, and expressions in flat arrays, so that later stages can
+ * mmap it and walk it without any parsing (kextractor-snapshot.h is the reader, and its definitions must match these).
+ * All records consist of 32-bit integers in native byte order. References are indices into the other arrays (-1 for none)
+ * or offsets into the string pool (0 for none, as the pool starts with an empty string).
+ * Symbols are stored by their dense IDs (see --symbol-table), and each expression node is stored after its children.
+ * LKC's enumerations differ between versions, so we translate them into the stable enumerations below.
+ */
+#define SNAPSHOT_MAGIC "KXSNAPSH"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+enum snapshot_symbol_type {
+  SNAPSHOT_S_UNKNOWN,
+  SNAPSHOT_S_BOOLEAN,
+  SNAPSHOT_S_TRISTATE,
+  SNAPSHOT_S_INT,
+  SNAPSHOT_S_HEX,
+  SNAPSHOT_S_STRING,
+};
+
+enum snapshot_property_type {
+  SNAPSHOT_P_UNKNOWN,
+  SNAPSHOT_P_PROMPT,
+  SNAPSHOT_P_COMMENT,
+  SNAPSHOT_P_MENU,
+  SNAPSHOT_P_DEFAULT,
+  SNAPSHOT_P_CHOICE,
+  SNAPSHOT_P_SELECT,
+  SNAPSHOT_P_IMPLY,
+  SNAPSHOT_P_RANGE,
+  SNAPSHOT_P_ENV,
+  SNAPSHOT_P_SYMBOL,
+};
+
+enum snapshot_expr_type {
+  SNAPSHOT_E_NONE,
+  SNAPSHOT_E_SYMBOL, // left is a symbol
+  SNAPSHOT_E_NOT, // left is a node
+  SNAPSHOT_E_EQUAL, // left and right are symbols (also for the following comparisons and ranges)
+  SNAPSHOT_E_UNEQUAL,
+  SNAPSHOT_E_LTH,
+  SNAPSHOT_E_LEQ,
+  SNAPSHOT_E_GTH,
+  SNAPSHOT_E_GEQ,
+  SNAPSHOT_E_RANGE,
+  SNAPSHOT_E_AND, // left and right are nodes
+  SNAPSHOT_E_OR,
+  SNAPSHOT_E_LIST, // left is a node (or -1), right is a symbol (also for choices)
+  SNAPSHOT_E_CHOICE,
+};
+
+enum snapshot_symbol_flag {
+  SNAPSHOT_CHOICE = 1,
+  SNAPSHOT_OPTIONAL = 2,
+  SNAPSHOT_CONST = 4,
+  SNAPSHOT_DECLARED = 8, // has a P_SYMBOL property (see --kconfigs)
+};
+
+struct snapshot_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  int32_t symbol_yes, symbol_mod, symbol_no;
+  uint32_t symbols_offset, symbols_size;
+  uint32_t properties_offset, properties_size;
+  uint32_t nodes_offset, nodes_size;
+  uint32_t menus_offset, menus_size;
+  uint32_t members_offset, members_size; // choice members (symbol IDs)
+  uint32_t order_offset, order_size; // symbol IDs in LKC's symbol-table order, which --extract and --configs follow
+  uint32_t strings_offset, strings_size;
+};
+
+struct snapshot_symbol {
+  uint32_t name;
+  uint32_t type;
+  uint32_t flags;
+  uint32_t lkc_flags; // LKC's own flags, which are not stable between versions
+  uint32_t properties, properties_size;
+  uint32_t members, members_size;
+  int32_t dir_dep, rev_dep;
+};
+
+struct snapshot_property {
+  uint32_t type;
+  uint32_t text;
+  int32_t expr, visible;
+};
+
+struct snapshot_node {
+  uint32_t type;
+  int32_t left, right;
+};
+
+struct snapshot_menu {
+  int32_t symbol;
+  int32_t parent;
+  int32_t dep;
+  uint32_t prompt;
+};
+
+static struct snapshot_property *snapshot_properties = NULL;
+static int snapshot_properties_size = 0, snapshot_properties_capacity = 0;
+static struct snapshot_node *snapshot_nodes = NULL;
+static int snapshot_nodes_size = 0, snapshot_nodes_capacity = 0;
+static struct hash_map snapshot_node_ids;
+static struct output snapshot_strings;
+
+/* Make room for one more element in a growing array */
+static void *grow_array(void *array, int size, int *capacity, size_t element_size)
+{
+  if (size == *capacity) {
+    *capacity = *capacity ? 2 * *capacity : 1024;
+    array = realloc(array, *capacity * element_size);
+  }
+  return array;
+}
+
+uint32_t snapshot_string(const char *str)
+{
+  uint32_t offset = snapshot_strings.size;
+
+  if (!str)
+    return 0;
+  output_write(&snapshot_strings, str, strlen(str) + 1);
+  return offset;
+}
+
+uint32_t snapshot_symbol_type(enum symbol_type type)
+{
+  switch (type) {
+#if HAS_S_BOOLEAN
+  case S_BOOLEAN: return SNAPSHOT_S_BOOLEAN;
+#endif
+#if HAS_S_TRISTATE
+  case S_TRISTATE: return SNAPSHOT_S_TRISTATE;
+#endif
+#if HAS_S_INT
+  case S_INT: return SNAPSHOT_S_INT;
+#endif
+#if HAS_S_HEX
+  case S_HEX: return SNAPSHOT_S_HEX;
+#endif
+#if HAS_S_STRING
+  case S_STRING: return SNAPSHOT_S_STRING;
+#endif
+  default: return SNAPSHOT_S_UNKNOWN;
+  }
+}
+
+uint32_t snapshot_property_type(enum prop_type type)
+{
+  switch (type) {
+#if HAS_P_PROMPT
+  case P_PROMPT: return SNAPSHOT_P_PROMPT;
+#endif
+#if HAS_P_COMMENT
+  case P_COMMENT: return SNAPSHOT_P_COMMENT;
+#endif
+#if HAS_P_MENU
+  case P_MENU: return SNAPSHOT_P_MENU;
+#endif
+#if HAS_P_DEFAULT
+  case P_DEFAULT: return SNAPSHOT_P_DEFAULT;
+#endif
+#if HAS_P_CHOICE
+  case P_CHOICE: return SNAPSHOT_P_CHOICE;
+#endif
+#if HAS_P_SELECT
+  case P_SELECT: return SNAPSHOT_P_SELECT;
+#endif
+#if HAS_P_IMPLY
+  case P_IMPLY: return SNAPSHOT_P_IMPLY;
+#endif
+#if HAS_P_RANGE
+  case P_RANGE: return SNAPSHOT_P_RANGE;
+#endif
+#if HAS_P_ENV
+  case P_ENV: return SNAPSHOT_P_ENV;
+#endif
+#if HAS_P_SYMBOL
+  case P_SYMBOL: return SNAPSHOT_P_SYMBOL;
+#endif
+  default: return SNAPSHOT_P_UNKNOWN;
+  }
+}
+
+/* Translate the type of an expression and find its subexpressions, if any */
+uint32_t snapshot_expr_type(struct expr *e, struct expr **left, struct expr **right)
+{
+  *left = *right = NULL;
+  switch (e->type) {
+#if HAS_E_SYMBOL
+  case E_SYMBOL: return SNAPSHOT_E_SYMBOL;
+#endif
+#if HAS_E_NOT
+  case E_NOT: *left = e->left.expr; return SNAPSHOT_E_NOT;
+#endif
+#if HAS_E_EQUAL
+  case E_EQUAL: return SNAPSHOT_E_EQUAL;
+#endif
+#if HAS_E_UNEQUAL
+  case E_UNEQUAL: return SNAPSHOT_E_UNEQUAL;
+#endif
+#if HAS_E_LTH
+  case E_LTH: return SNAPSHOT_E_LTH;
+#endif
+#if HAS_E_LEQ
+  case E_LEQ: return SNAPSHOT_E_LEQ;
+#endif
+#if HAS_E_GTH
+  case E_GTH: return SNAPSHOT_E_GTH;
+#endif
+#if HAS_E_GEQ
+  case E_GEQ: return SNAPSHOT_E_GEQ;
+#endif
+#if HAS_E_RANGE
+  case E_RANGE: return SNAPSHOT_E_RANGE;
+#endif
+#if HAS_E_AND
+  case E_AND: *left = e->left.expr; *right = e->right.expr; return SNAPSHOT_E_AND;
+#endif
+#if HAS_E_OR
+  case E_OR: *left = e->left.expr; *right = e->right.expr; return SNAPSHOT_E_OR;
+#endif
+#if HAS_E_LIST
+  case E_LIST: *left = e->left.expr; return SNAPSHOT_E_LIST;
+#endif
+#if HAS_E_CHOICE
+  case E_CHOICE: *left = e->left.expr; return SNAPSHOT_E_CHOICE;
+#endif
+  default: return SNAPSHOT_E_NONE;
+  }
+}
+
+/* Store an expression and all its subexpressions (each shared subexpression once) and return the index of its node */
+int snapshot_expr(struct expr *e)
+{
+  static struct expr **stack = NULL;
+  static int stack_capacity = 0;
+  struct expr *top, *left, *right;
+  struct snapshot_node node;
+  int size = 0, id;
+
+  if (!e)
+    return -1;
+  stack = grow_array(stack, size, &stack_capacity, sizeof(struct expr *));
+  stack[size++] = e;
+  while (size > 0) {
+    top = stack[size - 1];
+    if (hash_map_get(&snapshot_node_ids, (uintptr_t) top, 0, 0) != -1) {
+      size--;
+      continue;
+    }
+    node.type = snapshot_expr_type(top, &left, &right);
+    // children are stored first, so we postpone this node until they are
+    if (right && hash_map_get(&snapshot_node_ids, (uintptr_t) right, 0, 0) == -1) {
+      stack = grow_array(stack, size, &stack_capacity, sizeof(struct expr *));
+      stack[size++] = right;
+    }
+    if (left && hash_map_get(&snapshot_node_ids, (uintptr_t) left, 0, 0) == -1) {
+      stack = grow_array(stack, size, &stack_capacity, sizeof(struct expr *));
+      stack[size++] = left;
+    }
+    if (stack[size - 1] != top)
+      continue;
+    switch (node.type) {
+    case SNAPSHOT_E_NONE:
+      node.left = node.right = -1;
+      break;
+    case SNAPSHOT_E_SYMBOL:
+      node.left = symbol_id(top->left.sym);
+      node.right = -1;
+      break;
+    case SNAPSHOT_E_NOT:
+      node.left = hash_map_get(&snapshot_node_ids, (uintptr_t) left, 0, 0);
+      node.right = -1;
+      break;
+    case SNAPSHOT_E_AND:
+    case SNAPSHOT_E_OR:
+      node.left = hash_map_get(&snapshot_node_ids, (uintptr_t) left, 0, 0);
+      node.right = hash_map_get(&snapshot_node_ids, (uintptr_t) right, 0, 0);
+      break;
+    case SNAPSHOT_E_LIST:
+    case SNAPSHOT_E_CHOICE:
+      node.left = left ? hash_map_get(&snapshot_node_ids, (uintptr_t) left, 0, 0) : -1;
+      node.right = symbol_id(top->right.sym);
+      break;
+    default:
+      node.left = symbol_id(top->left.sym);
+      node.right = symbol_id(top->right.sym);
+      break;
+    }
+    snapshot_nodes = grow_array(snapshot_nodes, snapshot_nodes_size, &snapshot_nodes_capacity, sizeof(struct snapshot_node));
+    id = snapshot_nodes_size++;
+    snapshot_nodes[id] = node;
+    hash_map_put(&snapshot_node_ids, (uintptr_t) top, 0, 0, id);
+    size--;
+  }
+  return hash_map_get(&snapshot_node_ids, (uintptr_t) e, 0, 0);
+}
+
+/* Write a section of the snapshot, padded to 8 bytes */
+void write_snapshot_section(struct output *out, const void *data, size_t size)
+{
+  static const char padding[8];
+
+  output_write(out, data, size);
+  output_write(out, padding, -size & 7);
+}
+
+static inline uint32_t snapshot_section_size(size_t size)
+{
+  return (size + 7) & ~(size_t) 7;
+}
+
+void print_snapshot(struct output *out)
+{
+  struct snapshot_header header;
+  struct snapshot_symbol *symbols;
+  struct snapshot_menu *menus = NULL;
+  int32_t *members = NULL, *order = NULL;
+  int menus_size = 0, menus_capacity = 0, members_size = 0, members_capacity = 0, order_size = 0, order_capacity = 0;
+  struct hash_map menu_ids = { NULL };
+  struct symbol **choice;
+  int choice_size;
+  struct property *prop;
+  struct menu *menu;
+  struct symbol *sym;
+  uint32_t offset;
+  int id, i;
+
+  number_symbols();
+  output_write(&snapshot_strings, "", 1);
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.byte_order = SNAPSHOT_BYTE_ORDER;
+  header.symbol_yes = symbol_id(&symbol_yes);
+  header.symbol_mod = symbol_id(&symbol_mod);
+  header.symbol_no = symbol_id(&symbol_no);
+
+  // menus are stored in the order of a depth-first walk, so each parent comes before its children
+  for (menu = rootmenu.list; menu; ) {
+    menus = grow_array(menus, menus_size, &menus_capacity, sizeof(struct snapshot_menu));
+    menus[menus_size].symbol = menu->sym ? symbol_id(menu->sym) : -1;
+    menus[menus_size].parent = menu->parent ? hash_map_get(&menu_ids, (uintptr_t) menu->parent, 0, 0) : -1;
+    menus[menus_size].dep = snapshot_expr(menu->dep);
+    menus[menus_size].prompt = snapshot_string(menu->prompt ? menu->prompt->text : NULL);
+    hash_map_put(&menu_ids, (uintptr_t) menu, 0, 0, menus_size++);
+    if (menu->list)
+      menu = menu->list;
+    else if (menu->next)
+      menu = menu->next;
+    else while ((menu = menu->parent)) {
+      if (menu->next) {
+        menu = menu->next;
+        break;
+      }
+    }
+  }
+
+  _for_output_symbols(sym) {
+    order = grow_array(order, order_size, &order_capacity, sizeof(int32_t));
+    order[order_size++] = symbol_id(sym);
+  }
+
+  // expressions may reference symbols that have no ID yet (e.g., y), so the number of symbols can grow in this loop
+  symbols = NULL;
+  for (id = 0; id < symbols_by_id_size; id++) {
+    struct snapshot_symbol symbol;
+
+    sym = symbols_by_id[id];
+    symbol.name = snapshot_string(sym->name);
+    symbol.type = snapshot_symbol_type(sym->type);
+    symbol.flags = (sym_is_choice(sym) ? SNAPSHOT_CHOICE : 0) | (sym_is_optional(sym) ? SNAPSHOT_OPTIONAL : 0) |
+      (sym->flags & SYMBOL_CONST ? SNAPSHOT_CONST : 0) | (is_symbol(sym) ? SNAPSHOT_DECLARED : 0);
+    symbol.lkc_flags = sym->flags;
+    symbol.properties = snapshot_properties_size;
+    for (prop = sym->prop; prop; prop = prop->next) {
+      snapshot_properties = grow_array(snapshot_properties, snapshot_properties_size, &snapshot_properties_capacity, sizeof(struct snapshot_property));
+      i = snapshot_properties_size++;
+      snapshot_properties[i].type = snapshot_property_type(prop->type);
+      snapshot_properties[i].text = snapshot_string(prop->text);
+      snapshot_properties[i].expr = snapshot_expr(prop->expr);
+      snapshot_properties[i].visible = snapshot_expr(prop->visible.expr);
+    }
+    symbol.properties_size = snapshot_properties_size - symbol.properties;
+    symbol.members = members_size;
+    choice = choice_members(sym, &choice_size);
+    for (i = 0; i < choice_size; i++) {
+      members = grow_array(members, members_size, &members_capacity, sizeof(int32_t));
+      members[members_size++] = symbol_id(choice[i]);
+    }
+    free(choice);
+    symbol.members_size = members_size - symbol.members;
+#if HAS_dir_dep
+    symbol.dir_dep = snapshot_expr(sym->dir_dep.expr);
+#else
+    symbol.dir_dep = -1;
+#endif
+    symbol.rev_dep = snapshot_expr(sym->rev_dep.expr);
+    symbols = realloc(symbols, (id + 1) * sizeof(struct snapshot_symbol));
+    symbols[id] = symbol;
+  }
+
+  offset = snapshot_section_size(sizeof(header));
+#define SNAPSHOT_SECTION(section, size, element_size) \
+  header.section##_offset = offset;                   \
+  header.section##_size = size;                       \
+  offset += snapshot_section_size((size_t) (size) * (element_size));
+  SNAPSHOT_SECTION(symbols, symbols_by_id_size, sizeof(struct snapshot_symbol))
+  SNAPSHOT_SECTION(properties, snapshot_properties_size, sizeof(struct snapshot_property))
+  SNAPSHOT_SECTION(nodes, snapshot_nodes_size, sizeof(struct snapshot_node))
+  SNAPSHOT_SECTION(menus, menus_size, sizeof(struct snapshot_menu))
+  SNAPSHOT_SECTION(members, members_size, sizeof(int32_t))
+  SNAPSHOT_SECTION(order, order_size, sizeof(int32_t))
+  SNAPSHOT_SECTION(strings, snapshot_strings.size, 1)
+#undef SNAPSHOT_SECTION
+
+  write_snapshot_section(out, &header, sizeof(header));
+  write_snapshot_section(out, symbols, symbols_by_id_size * sizeof(struct snapshot_symbol));
+  write_snapshot_section(out, snapshot_properties, snapshot_properties_size * sizeof(struct snapshot_property));
+  write_snapshot_section(out, snapshot_nodes, snapshot_nodes_size * sizeof(struct snapshot_node));
+  write_snapshot_section(out, menus, menus_size * sizeof(struct snapshot_menu));
+  write_snapshot_section(out, members, members_size * sizeof(int32_t));
+  write_snapshot_section(out, order, order_size * sizeof(int32_t));
+  write_snapshot_section(out, snapshot_strings.data, snapshot_strings.size);
+  free(symbols);
+  free(menus);
+  free(members);
+  free(order);
+}
+
+/* Print the configuration variable itself, its prompts, and its defaults (first part of --extract) */
+void extract_symbol(struct output *output_fp, struct symbol *sym)
+{
+  struct property *prop;
+  char *typename;
+  int is_string;
+  int is_bool;
+
+  switch (sym->type) {
+  case S_BOOLEAN:
+    // fall through
+  case S_TRISTATE:
+
+    switch (sym->type) {
+    case S_BOOLEAN:
+      is_bool = true;
+      break;
+    case S_TRISTATE:
+      is_bool = false;
+      break;
+    default:
+      is_bool = true;
+      // should not reach here
+      break;
+    }
+
+    typename = is_bool ? "bool" : "tristate";
+    out_str(output_fp, "config ");
+    out_name(output_fp, sym);
+    out_str(output_fp, " ");
+    out_line(output_fp, typename);
+    // print prompt conditions, if any
+    prop = NULL;
+    for_all_prompts(sym, prop) {
+      if ((NULL != prop)) {
+        out_str(output_fp, "prompt ");
+        out_name(output_fp, sym);
+        out_str(output_fp, " (");
+        if (NULL != prop->visible.expr) {
+          print_python_expr(prop->visible.expr, output_fp, E_NONE);
+        } else {
+          out_str(output_fp, "1");
+        }
+        out_str(output_fp, ")");
+        out_str(output_fp, "\n");
+      }
+    }
+    // print default values
+    prop = NULL;
+    for_all_defaults(sym, prop) {
+      if ((NULL != prop) && (NULL != (prop->expr))) {
+        out_str(output_fp, "def_bool ");
+        out_name(output_fp, sym);
+        out_str(output_fp, " ");
+        print_python_expr(prop->expr, output_fp, E_NONE);
+        out_str(output_fp, "|(");
+        if (NULL != prop->visible.expr) {
+          print_python_expr(prop->visible.expr, output_fp, E_NONE);
+        } else {
+          out_str(output_fp, "1");
+        }
+        out_str(output_fp, ")");
+        out_str(output_fp, "\n");
+      }
+    }
+    break;
+  case S_INT:
+    // fall through
+  case S_HEX:
+    // fall through
+  case S_STRING:
+
+    switch (sym->type) {
+    case S_INT:
+      is_string = false;
+      break;
+    case S_HEX:
+      is_string = false;
+      break;
+    case S_STRING:
+      is_string = true;
+      break;
+    default:
+      is_string = true;
+      // should not reach here
+      break;
+    }
+
+    typename = is_string ? "string" : "number";
+    
+    out_str(output_fp, "config ");
+    out_name(output_fp, sym);
+    out_str(output_fp, " ");
+    out_line(output_fp, typename);
+    // print prompt conditions, if any
+    prop = NULL;
+    for_all_prompts(sym, prop) {
+      if ((NULL != prop)) {
+        out_str(output_fp, "prompt ");
+        out_name(output_fp, sym);
+        out_str(output_fp, " (");
+        if (NULL != prop->visible.expr) {
+          print_python_expr(prop->visible.expr, output_fp, E_NONE);
+        } else {
+          out_str(output_fp, "1");
+        }
+        out_str(output_fp, ")");
+        out_str(output_fp, "\n");
+      }
+    }
+    // print default values
+    prop = NULL;
+    for_all_defaults(sym, prop) {
+      if ((NULL != prop) && (NULL != (prop->expr))) {
+        out_str(output_fp, "def_nonbool ");
+        out_name(output_fp, sym);
+        out_str(output_fp, " ");
+        /* if (is_string) out_str(output_fp, "\""); */
+        print_python_expr(prop->expr, output_fp, E_NONE);
+        /* if (is_string) out_str(output_fp, "\""); */
+        out_str(output_fp, "|(");
+        if (NULL != prop->visible.expr) {
+          print_python_expr(prop->visible.expr, output_fp, E_NONE);
+        } else {
+          out_str(output_fp, "1");
+        }
+        out_str(output_fp, ")");
+        out_str(output_fp, "\n");
+      }
+    }
+    break;
+  case S_UNKNOWN:
+    // fall through
+  default:
+    // can't deal with this
+    break;
+  }
+}
+
+/* Print the choice, direct dependencies, selects, and reverse dependencies of a configuration variable (second part of --extract) */
+void extract_dependencies(struct output *output_fp, struct symbol *sym)
+{
+  if (sym_is_choice(sym)) {
+    struct property *prop;
+    struct symbol **members;
+    int members_size, i;
+
+    PHASE_BEGIN(PHASE_CHOICES);
+    members = choice_members(sym, &members_size);
+	
+	// print choice type, depending on config type and optional statement
+	switch(sym->type) {
+      case S_BOOLEAN:
+        sym_is_optional(sym) ? out_str(output_fp, "bool_opt_choice") : out_str(output_fp, "bool_choice");
+        break;
+      case S_TRISTATE:
+        sym_is_optional(sym) ? out_str(output_fp, "tristate_opt_choice") : out_str(output_fp, "tristate_choice");
+        break;
+      default:
+        fprintf(stderr, "fatal: choice type can only be bool or tristate, otherwise is impossible due to the parser.\n");
+        exit(1);
+    }
+    
+    for (i = 0; i < members_size; i++) {
+      out_str(output_fp, " ");
+      out_name(output_fp, members[i]);  // any dependencies should be handled below with 'dep'
+    }
+    free(members);
+    out_str(output_fp, "|(");
+
+	// Both depends on and visibility shoul be satisfied for 
+	// the choice to be selectable.
+	// Kconfig conjuncts depends on constraint to the 
+	// visibility constraint, so that for choice, looking at
+	// only the visibility is sufficient.
+	// rev_dep of choice copies the visibility to prevent
+	// non-optional choices have no selection (menu.c, l854) 
+	// Thus, rev_dep is the same as visibiltiy except conjoing
+	// 'm' which is currently not needed for kclause.
+	// In sum, only visibility is needed as the condition of
+	// choice.
+
+    // for formatting
+    int printed_expr = 0;
+	prop = NULL;
+    for_all_prompts(sym, prop) {
+      if ((NULL != prop)) {
+
+	    if (printed_expr) {
+	      fprintf(stderr, "warning: encountered multiple prompts, ignoring.");
+	      break;
+	      // commented code below can handle the case where multiple
+	      // prompts are defined, where satisfying any of them makes
+	      // the config option visible. However, multiple prompts 
+	      // raises a warning by Kconfig and we consider it as an 
+	      // invalid use of Kconfig language. Thus, this code is 
+          // commented for now. Note that, using this code here
+          // means the code for prompt keyword should also reflect
+          // this case.
+	      //out_str(output_fp, " or ");
+	    }
+	    
+	    printed_expr = 1;
+	    out_str(output_fp, "(");
+        if (NULL != prop->visible.expr) {
+          print_python_expr(prop->visible.expr, output_fp, E_NONE);
+        } else {
+          out_str(output_fp, "1");
+        }
+        out_str(output_fp, ")");
+      }
+    }
+
+    if (!printed_expr)
+      out_str(output_fp, "1");
+    
+    out_str(output_fp, ")\n");
+    PHASE_END(PHASE_CHOICES);
+  }
+  
+  if (!sym->name || strlen(sym->name) == 0)
+    return;
+
+  if (sym->type == S_TRISTATE ||
+      sym->type == S_BOOLEAN ||
+      sym->type == S_INT ||
+      sym->type == S_HEX ||
+      sym->type == S_STRING) {
+    bool no_dependencies = true;
+    PHASE_BEGIN(PHASE_DEPENDENCIES);
+#if HAS_dir_dep
+    if (sym->dir_dep.expr) {
+      no_dependencies = false;
+      out_str(output_fp, "dep ");
+      out_name(output_fp, sym);
+      out_str(output_fp, " (");
+      print_python_expr(sym->dir_dep.expr, output_fp, E_NONE);
+      out_str(output_fp, ")\n");
+    }
+#endif
+    PHASE_END(PHASE_DEPENDENCIES);
+
+    if (enable_reverse_dependencies) {
+      // print all the variables selected by this variable
+      struct property *prop, **selects = NULL;
+      int selects_size = 0, i;
+      PHASE_BEGIN(PHASE_SELECTS);
+      for_all_properties(sym, prop, P_SELECT) {
+        selects = realloc(selects, (selects_size + 1) * sizeof(struct property *));
+        selects[selects_size++] = prop;
+      }
+      if (canonical_output)
+        sort_selects(selects, selects_size);
+      for (i = 0; i < selects_size; i++) {
+        prop = selects[i];
+        // the current var itself is the var doing the select
+        // prop->expr is the variable being selected
+        // prop->visible.expr is And(sym->dir_dept, select_dep) where select_dep
+        // is the dependency for select defined as "select 'selected' if 'select_dep'"
+        out_str(output_fp, "select ");
+        // note: this assumes that prop->expr is only a single
+        // variable name, which zconf.y guarantees
+        print_python_expr(prop->expr, output_fp, E_NONE);
+        out_str(output_fp, " ");
+        out_name(output_fp, sym);
+        out_str(output_fp, " (");
+        if (NULL != prop->visible.expr) {
+          print_python_expr(prop->visible.expr, output_fp, E_NONE);
+        } else {
+          out_str(output_fp, "1");
+        }
+        out_str(output_fp, ")\n");
+      }
+      free(selects);
+      PHASE_END(PHASE_SELECTS);
+
+      // print the reverse dependency for this variable
+      PHASE_BEGIN(PHASE_REVERSE_DEPENDENCIES);
+      if (sym->rev_dep.expr) {
+        no_dependencies = false;
+        out_str(output_fp, "rev_dep ");
+        out_name(output_fp, sym);
+        out_str(output_fp, " (");
+        print_python_expr(sym->rev_dep.expr, output_fp, E_NONE);
+        out_str(output_fp, ")\n");
+      }
+      PHASE_END(PHASE_REVERSE_DEPENDENCIES);
+    }
+
+    // nonbools without dependencies should depend on true
+    if (sym->type == S_INT ||
+        sym->type == S_HEX ||
+        sym->type == S_STRING) {
+      if (no_dependencies) {
+        out_str(output_fp, "dep ");
+        out_name(output_fp, sym);
+        out_str(output_fp, " (1)\n");
+      }
+    }
+  } else {
+    /* ffprintf(output_fp, stderr, "skipping %s\n", sym->name); */
+  }
+}
+
+/* Register all expressions that --extract prints for a configuration variable, mirroring extract_symbol and extract_dependencies */
+void share_symbol_expressions(struct symbol *sym)
+{
+  struct property *prop;
+
+  if (sym_is_choice(sym)) {
+    for_all_prompts(sym, prop) {
+      share_expr(prop->visible.expr);
+      break;
+    }
+  }
+
+  if (!sym->name || strlen(sym->name) == 0)
+    return;
+  if (sym->type != S_TRISTATE && sym->type != S_BOOLEAN &&
+      sym->type != S_INT && sym->type != S_HEX && sym->type != S_STRING)
+    return;
+
+  for_all_prompts(sym, prop)
+    share_expr(prop->visible.expr);
+  for_all_defaults(sym, prop) {
+    if (NULL != prop->expr) {
+      share_expr(prop->expr);
+      share_expr(prop->visible.expr);
+    }
+  }
+#if HAS_dir_dep
+  share_expr(sym->dir_dep.expr);
+#endif
+  if (enable_reverse_dependencies) {
+    for_all_properties(sym, prop, P_SELECT) {
+      share_expr(prop->expr);
+      share_expr(prop->visible.expr);
+    }
+    share_expr(sym->rev_dep.expr);
+  }
+}
+
+/* Print all shared expressions as definitions, each after the definitions it references */
+void print_shared_definitions(struct output *out)
+{
+  int id;
+
+  for (id = 0; id < shared_exprs_size; id++) {
+    shared_definition = shared_exprs[id].expr;
+    if (shared_expr_id(shared_definition) == -1 && shared_exprs[id].references > 1 &&
+        (shared_definition->type == E_AND || shared_definition->type == E_OR)) {
+      out_str(out, "expr E@");
+      out_int(out, id);
+      out_str(out, " (");
+      print_python_expr(shared_definition, out, E_NONE);
+      out_str(out, ")\n");
+    }
+  }
+  shared_definition = NULL;
+}
+
+/*
+ * Extraction statistics (--stats=FILE).
+ * We count symbols by type, properties by kind, and expression nodes (with the maximum depth of an expression),
+ * and measure the bytes written, the time spent in each phase (in nanoseconds, like measure in torte), and the peak RSS.
+ * The statistics are written as a CSV header and row, or as a JSON object if FILE ends in .json,
+ * so that extraction can record them without post-processing the (possibly huge) outputs.
+ */
+#define STATS_SIZE 48
+
+struct stat_entry {
+  const char *name;
+  long long value;
+};
+
+static char *stats_file = NULL;
+static struct stat_entry stats[STATS_SIZE];
+static int stats_size = 0;
+static struct timeval phase_start;
+// collected while writing --model, which is the only output that corresponds to the .model file
+static long long model_literals = 0, model_variables = 0;
+static bool *model_variable_used = NULL;
+
+static long long output_bytes = 0; // written to all outputs when they are closed
+// indexed by the stable enumerations of the snapshot
+static const char *stats_symbol_types[] = {
+  "symbols_unknown", "symbols_boolean", "symbols_tristate", "symbols_int", "symbols_hex", "symbols_string"
+};
+static const char *stats_property_types[] = {
+  "properties_unknown", "properties_prompt", "properties_comment", "properties_menu", "properties_default",
+  "properties_choice", "properties_select", "properties_imply", "properties_range", "properties_env", "properties_symbol"
+};
+
+void add_stat(const char *name, long long value)
+{
+  if (stats_size < STATS_SIZE) {
+    stats[stats_size].name = name;
+    stats[stats_size].value = value;
+    stats_size++;
+  }
+}
+
+/* Record the time since the last phase ended (or since the start) */
+void add_phase_stat(const char *name)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  add_stat(name, ((long long) (now.tv_sec - phase_start.tv_sec) * 1000000 + (now.tv_usec - phase_start.tv_usec)) * 1000);
+  phase_start = now;
+}
+
+/* Count the nodes of an expression and update the maximum depth, with an explicit stack for long reverse dependencies */
+void count_expr(struct expr *e, long long *nodes, long long *max_depth)
+{
+  static struct expr **stack = NULL;
+  static int *depths = NULL;
+  static int capacity = 0;
+  struct expr *top, *left, *right;
+  int size = 0, depth;
+
+  if (!e)
+    return;
+  if (!capacity) {
+    capacity = 256;
+    stack = malloc(capacity * sizeof(struct expr *));
+    depths = malloc(capacity * sizeof(int));
+  }
+  stack[size] = e;
+  depths[size++] = 1;
+  while (size > 0) {
+    top = stack[--size];
+    depth = depths[size];
+    (*nodes)++;
+    if (depth > *max_depth)
+      *max_depth = depth;
+    snapshot_expr_type(top, &left, &right);
+    if (size + 2 > capacity) {
+      capacity *= 2;
+      stack = realloc(stack, capacity * sizeof(struct expr *));
+      depths = realloc(depths, capacity * sizeof(int));
+    }
+    if (left) {
+      stack[size] = left;
+      depths[size++] = depth + 1;
+    }
+    if (right) {
+      stack[size] = right;
+      depths[size++] = depth + 1;
+    }
+  }
+}
+
+void collect_stats(void)
+{
+  long long symbols[6] = { 0 }, properties[11] = { 0 }, choices = 0, nodes = 0, max_depth = 0;
+  struct property *prop;
+  struct symbol *sym;
+  struct rusage usage;
+  int i;
+
+  _for_output_symbols(sym) {
+    if (sym->flags & SYMBOL_CONST)
+      continue;
+    symbols[snapshot_symbol_type(sym->type)]++;
+    if (sym_is_choice(sym))
+      choices++;
+    for (prop = sym->prop; prop; prop = prop->next) {
+      properties[snapshot_property_type(prop->type)]++;
+      count_expr(prop->expr, &nodes, &max_depth);
+      count_expr(prop->visible.expr, &nodes, &max_depth);
+    }
+#if HAS_dir_dep
+    count_expr(sym->dir_dep.expr, &nodes, &max_depth);
+#endif
+    count_expr(sym->rev_dep.expr, &nodes, &max_depth);
+  }
+  for (i = 0; i < 6; i++)
+    add_stat(stats_symbol_types[i], symbols[i]);
+  add_stat("choices", choices);
+  for (i = 0; i < 11; i++)
+    add_stat(stats_property_types[i], properties[i]);
+  add_stat("expression_nodes", nodes);
+  add_stat("expression_max_depth", max_depth);
+  add_stat("output_bytes", output_bytes);
+  if (action_enabled[A_MODEL]) {
+    add_stat("model_variables", model_variables);
+    add_stat("model_literals", model_literals);
+  }
+  getrusage(RUSAGE_SELF, &usage);
+  add_stat("peak_rss", (long long) usage.ru_maxrss * 1024);
+}
+
+/* Print the statistics as a CSV header and row, or as a JSON object */
+void print_stats(struct output *out, bool json)
+{
+  char buffer[32];
+  int i;
+
+  if (json)
+    out_str(out, "{");
+  for (i = 0; i < stats_size; i++) {
+    if (i > 0)
+      out_str(out, json ? ", " : ",");
+    if (json)
+      out_str(out, "\"");
+    out_str(out, stats[i].name);
+    if (json) {
+      sprintf(buffer, "\": %lld", stats[i].value);
+      out_str(out, buffer);
+    }
+  }
+  if (!json) {
+    out_str(out, "\n");
+    for (i = 0; i < stats_size; i++) {
+      sprintf(buffer, i == 0 ? "%lld" : ",%lld", stats[i].value);
+      out_str(out, buffer);
+    }
+  }
+  out_str(out, json ? "}\n" : "\n");
+}
+
+/*
+ * Native formula output (--dimacs and --model).
+ * We translate LKC's expressions into a small Boolean formula graph, which is then printed or Tseitin-transformed.
+ * This follows KClause's Boolean semantics (i.e., --disable-tristate-support), so m is treated like y,
+ * and nonboolean variables are true if and only if they have a value.
+ */
+enum bool_type {
+  B_FALSE,
+  B_TRUE,
+  B_VAR,
+  B_NOT,
+  B_AND,
+  B_OR,
+};
+
+struct bool_node {
+  enum bool_type type;
+  int left; // child node, or variable index for B_VAR
+  int right;
+};
+
+#define BOOL_FALSE 0
+#define BOOL_TRUE 1
+
+static struct bool_node *bool_nodes = NULL;
+static int bool_nodes_size = 0, bool_nodes_capacity = 0;
+static struct hash_map bool_node_ids;
+
+// variables are numbered from 1: features first, then comparisons interleaved with the auxiliary variables of --choice-encoding
+// (in the order they are created while translating the constraints), and finally the Tseitin variables of --dimacs
+// auxiliary and Tseitin variables have no name, so they are printed as k!<index>
+static char **variable_names = NULL, **variable_model_names = NULL; // the latter only with --model-prefix
+static int variables_size = 0, variables_capacity = 0, features_size = 0;
+static struct hash_map symbol_variables, comparison_variables, comparison_names, comparison_model_names;
+static int *constraints = NULL, constraints_size = 0;
+static int *dimacs_tseitin_literals = NULL;
+static struct output dimacs_clauses_out;
+static int dimacs_clauses = 0;
+
+int bool_node(enum bool_type type, int left, int right)
+{
+  // nodes are hash-consed, so identical subformulas are represented (and Tseitin-transformed) only once
+  int node = hash_map_get(&bool_node_ids, type, left, right);
+  if (node != -1)
+    return node;
+  if (bool_nodes_size == bool_nodes_capacity) {
+    bool_nodes_capacity = bool_nodes_capacity ? 2 * bool_nodes_capacity : 4096;
+    bool_nodes = realloc(bool_nodes, bool_nodes_capacity * sizeof(struct bool_node));
+  }
+  bool_nodes[bool_nodes_size].type = type;
+  bool_nodes[bool_nodes_size].left = left;
+  bool_nodes[bool_nodes_size].right = right;
+  hash_map_put(&bool_node_ids, type, left, right, bool_nodes_size);
+  return bool_nodes_size++;
+}
+
+int bool_var(int variable)
+{
+  return bool_node(B_VAR, variable, 0);
+}
+
+int bool_not(int a)
+{
+  if (a == BOOL_TRUE)
+    return BOOL_FALSE;
+  if (a == BOOL_FALSE)
+    return BOOL_TRUE;
+  if (bool_nodes[a].type == B_NOT)
+    return bool_nodes[a].left;
+  return bool_node(B_NOT, a, 0);
+}
+
+int bool_and(int a, int b)
+{
+  if (a == BOOL_FALSE || b == BOOL_FALSE)
+    return BOOL_FALSE;
+  if (a == BOOL_TRUE || a == b)
+    return b;
+  if (b == BOOL_TRUE)
+    return a;
+  return a < b ? bool_node(B_AND, a, b) : bool_node(B_AND, b, a);
+}
+
+int bool_or(int a, int b)
+{
+  if (a == BOOL_TRUE || b == BOOL_TRUE)
+    return BOOL_TRUE;
+  if (a == BOOL_FALSE || a == b)
+    return b;
+  if (b == BOOL_FALSE)
+    return a;
+  return a < b ? bool_node(B_OR, a, b) : bool_node(B_OR, b, a);
+}
+
+int bool_implies(int a, int b)
+{
+  return bool_or(bool_not(a), b);
+}
+
+int new_variable(char *name)
+{
+  if (variables_size + 1 >= variables_capacity) {
+    variables_capacity = variables_capacity ? 2 * variables_capacity : 4096;
+    variable_names = realloc(variable_names, variables_capacity * sizeof(char *));
+    if (model_prefix)
+      variable_model_names = realloc(variable_model_names, variables_capacity * sizeof(char *));
+  }
+  variable_names[++variables_size] = name;
+  if (model_prefix)
+    variable_model_names[variables_size] = name;
+  return variables_size;
+}
+
+/* Return the name of a variable in --model output */
+static inline char *model_variable_name(int variable)
+{
+  return model_prefix ? variable_model_names[variable] : variable_names[variable];
+}
+
+bool has_feature_variable(struct symbol *sym)
+{
+  return sym->name && strlen(sym->name) > 0 &&
+    (sym->type == S_BOOLEAN || sym->type == S_TRISTATE || sym->type == S_INT || sym->type == S_HEX || sym->type == S_STRING);
+}
+
+/* Register a feature variable for every configuration variable, so that features are numbered densely */
+void add_feature_variable(struct symbol *sym)
+{
+  char *name;
+  int variable;
+
+  if (!has_feature_variable(sym) || hash_map_get(&symbol_variables, (uintptr_t) sym, 0, 0) != -1)
+    return;
+  name = malloc(strlen(config_prefix) + strlen(sym->name) + 1);
+  sprintf(name, "%s%s", config_prefix, sym->name);
+  variable = new_variable(name);
+  if (model_prefix) {
+    name = malloc(strlen(model_prefix) + strlen(sym->name) + 1);
+    sprintf(name, "%s%s", model_prefix, sym->name);
+    variable_model_names[variable] = name;
+  }
+  hash_map_put(&symbol_variables, (uintptr_t) sym, 0, 0, variable);
+  features_size++;
+}
+
+bool is_constant_symbol(struct symbol *sym, const char *name)
+{
+  return sym->name && !strcmp(sym->name, name);
+}
+
+int symbol_to_bool(struct symbol *sym)
+{
+  int variable;
+
+  if (!sym->name)
+    return BOOL_TRUE; // choices are always considered active, as in --extract
+  if (is_constant_symbol(sym, "y") || is_constant_symbol(sym, "m"))
+    return BOOL_TRUE;
+  variable = hash_map_get(&symbol_variables, (uintptr_t) sym, 0, 0);
+  return variable == -1 ? BOOL_FALSE : bool_var(variable); // undefined symbols and constants are n
+}
+
+/*
+ * Look up the comparison variable with the given name, or the slot to register it at (if variable is -1).
+ * Names are keyed by their FNV-1a hash and length, and colliding hashes are told apart by a probe number.
+ */
+int find_comparison_name(struct hash_map *map, char **names, const char *name, uint64_t *hash, int *probe)
+{
+  const char *c;
+  int variable;
+
+  *hash = 0xcbf29ce484222325ULL;
+  for (c = name; *c; c++)
+    *hash = (*hash ^ (unsigned char) *c) * 0x100000001b3ULL;
+  for (*probe = 0; (variable = hash_map_get(map, *hash, c - name, *probe)) != -1; (*probe)++)
+    if (!strcmp(names[variable], name))
+      return variable;
+  return -1;
+}
+
+/*
+ * Name a comparison variable with the given prefix for its nonconstant operands.
+ * Characters that cannot appear in .model and DIMACS files become _, which may give distinct comparisons the same name
+ * (e.g., STR="foo\"bar" and STR="foo_bar"), so the name gets the first free suffix _<n> if it is taken.
+ */
+char *comparison_name(enum expr_type type, struct symbol *left, struct symbol *right, const char *prefix,
+                      struct hash_map *map, char **names, int variable)
+{
+  const char *operator = type == E_EQUAL ? "=" : type == E_LTH ? "<" : type == E_LEQ ? "<=" : type == E_GTH ? ">" : ">=";
+  char *name = malloc(2 * strlen(prefix) + strlen(left->name ? left->name : "") +
+                      strlen(operator) + strlen(right->name ? right->name : "") + 1), *unique, *c;
+  uint64_t hash;
+  int probe, suffix = 1;
+
+  sprintf(name, "%s%s%s%s%s",
+          left->flags & SYMBOL_CONST ? "" : prefix, left->name ? left->name : "", operator,
+          right->flags & SYMBOL_CONST ? "" : prefix, right->name ? right->name : "");
+  for (c = name; *c; c++)
+    if (!isalnum((unsigned char) *c) && !strchr("_=<>", *c))
+      *c = '_';
+  if (find_comparison_name(map, names, name, &hash, &probe) != -1) {
+    unique = malloc(strlen(name) + 16);
+    do
+      sprintf(unique, "%s_%d", name, ++suffix);
+    while (find_comparison_name(map, names, unique, &hash, &probe) != -1);
+    free(name);
+    name = unique;
+  }
+  hash_map_put(map, hash, strlen(name), probe, variable);
+  return name;
+}
+
+/* Nonboolean comparisons cannot be expressed propositionally, so each distinct comparison becomes an unconstrained variable */
+int comparison_to_bool(enum expr_type type, struct symbol *left, struct symbol *right)
+{
+  int variable = hash_map_get(&comparison_variables, type, (uintptr_t) left, (uintptr_t) right);
+
+  if (variable == -1) {
+    // the name is registered for the next variable, which new_variable creates right afterwards
+    variable = new_variable(comparison_name(type, left, right, config_prefix, &comparison_names, variable_names, variables_size + 1));
+    if (model_prefix)
+      variable_model_names[variable] =
+        comparison_name(type, left, right, model_prefix, &comparison_model_names, variable_model_names, variable);
+    hash_map_put(&comparison_variables, type, (uintptr_t) left, (uintptr_t) right, variable);
+  }
+  return bool_var(variable);
+}
+
+int equality_to_bool(struct symbol *left, struct symbol *right)
+{
+  if (is_constant_symbol(right, "y") || is_constant_symbol(right, "m"))
+    return symbol_to_bool(left);
+  if (is_constant_symbol(right, "n"))
+    return bool_not(symbol_to_bool(left));
+  if (is_constant_symbol(left, "y") || is_constant_symbol(left, "m"))
+    return symbol_to_bool(right);
+  if (is_constant_symbol(left, "n"))
+    return bool_not(symbol_to_bool(right));
+  if ((left->type == S_BOOLEAN || left->type == S_TRISTATE) && !(left->flags & SYMBOL_CONST) &&
+      (right->type == S_BOOLEAN || right->type == S_TRISTATE) && !(right->flags & SYMBOL_CONST)) {
+    int a = symbol_to_bool(left), b = symbol_to_bool(right);
+    return bool_and(bool_implies(a, b), bool_implies(b, a));
+  }
+  return comparison_to_bool(E_EQUAL, left, right);
+}
+
+/* Translate an expression that is not a negation, conjunction, or disjunction */
+int leaf_to_bool(struct expr *e)
+{
+  if (!e)
+    return BOOL_TRUE;
+  switch (e->type) {
+#if HAS_E_SYMBOL
+  case E_SYMBOL:
+    return symbol_to_bool(e->left.sym);
+#endif
+#if HAS_E_EQUAL
+  case E_EQUAL:
+    return equality_to_bool(e->left.sym, e->right.sym);
+#endif
+#if HAS_E_UNEQUAL
+  case E_UNEQUAL:
+    return bool_not(equality_to_bool(e->left.sym, e->right.sym));
+#endif
+#if HAS_E_LTH
+  case E_LTH:
+    return comparison_to_bool(e->type, e->left.sym, e->right.sym);
+#endif
+#if HAS_E_LEQ
+  case E_LEQ:
+    return comparison_to_bool(e->type, e->left.sym, e->right.sym);
+#endif
+#if HAS_E_GTH
+  case E_GTH:
+    return comparison_to_bool(e->type, e->left.sym, e->right.sym);
+#endif
+#if HAS_E_GEQ
+  case E_GEQ:
+    return comparison_to_bool(e->type, e->left.sym, e->right.sym);
+#endif
+  default:
+    // lists, ranges, and empty expressions carry no constraint
+    return BOOL_TRUE;
+  }
+}
+
+struct expr_frame {
+  struct expr *expr;
+  bool expanded;
+};
+
+/* Translate an expression in post-order with explicit stacks, as reverse dependencies can be chains of thousands of selects */
+int expr_to_bool(struct expr *e)
+{
+  static struct expr_frame *stack = NULL;
+  static int *results = NULL;
+  static int stack_capacity = 0, results_capacity = 0;
+  struct expr_frame top;
+  int size = 0, results_size = 0, operands;
+
+  stack = grow_array(stack, size, &stack_capacity, sizeof(struct expr_frame));
+  stack[size].expr = e;
+  stack[size++].expanded = false;
+  while (size > 0) {
+    top = stack[--size];
+    operands = 0;
+    if (top.expr && !top.expanded)
+      switch (top.expr->type) {
+#if HAS_E_NOT
+      case E_NOT:
+        operands = 1;
+        break;
+#endif
+#if HAS_E_AND
+      case E_AND:
+#endif
+#if HAS_E_OR
+      case E_OR:
+#endif
+        operands = 2;
+        break;
+      default:
+        break;
+      }
+    if (operands > 0) {
+      // translate the operands before the connective, the right one first (as GCC evaluated the arguments of
+      // the former recursive calls), so that nodes are numbered and thus printed in the same order as before
+      stack = grow_array(stack, size, &stack_capacity, sizeof(struct expr_frame));
+      stack[size].expr = top.expr;
+      stack[size++].expanded = true;
+      stack = grow_array(stack, size, &stack_capacity, sizeof(struct expr_frame));
+      stack[size].expr = top.expr->left.expr;
+      stack[size++].expanded = false;
+      if (operands == 2) {
+        stack = grow_array(stack, size, &stack_capacity, sizeof(struct expr_frame));
+        stack[size].expr = top.expr->right.expr;
+        stack[size++].expanded = false;
+      }
+      continue;
+    }
+    if (!top.expanded) {
+      results = grow_array(results, results_size, &results_capacity, sizeof(int));
+      results[results_size++] = leaf_to_bool(top.expr);
+      continue;
+    }
+    switch (top.expr->type) {
+#if HAS_E_NOT
+    case E_NOT:
+      results[results_size - 1] = bool_not(results[results_size - 1]);
+      break;
+#endif
+#if HAS_E_AND
+    case E_AND:
+      results_size--;
+      results[results_size - 1] = bool_and(results[results_size], results[results_size - 1]);
+      break;
+#endif
+#if HAS_E_OR
+    case E_OR:
+      results_size--;
+      results[results_size - 1] = bool_or(results[results_size], results[results_size - 1]);
+      break;
+#endif
+    default:
+      break;
+    }
+  }
+  return results[0];
+}
+
+/* Return a DIMACS literal equivalent to the given node, introducing a Tseitin variable for each gate only once */
+int dimacs_literal(int node);
+
+void dimacs_clause(int *literals, int size)
+{
+  int i;
+
+  for (i = 0; i < size; i++) {
+    out_int(&dimacs_clauses_out, literals[i]);
+    out_str(&dimacs_clauses_out, " ");
+  }
+  out_str(&dimacs_clauses_out, "0\n");
+  dimacs_clauses++;
+}
+
+/* Collect the operands of a flattened n-ary conjunction or disjunction, from left to right */
+void collect_bool_operands(int node, enum bool_type type, int **operands, int *size, int *capacity)
+{
+  static int *stack = NULL;
+  static int stack_capacity = 0;
+  int stack_size = 0;
+
+  stack = grow_array(stack, stack_size, &stack_capacity, sizeof(int));
+  stack[stack_size++] = node;
+  while (stack_size > 0) {
+    node = stack[--stack_size];
+    if (bool_nodes[node].type == type) {
+      stack = grow_array(stack, stack_size, &stack_capacity, sizeof(int));
+      stack[stack_size++] = bool_nodes[node].right;
+      stack = grow_array(stack, stack_size, &stack_capacity, sizeof(int));
+      stack[stack_size++] = bool_nodes[node].left;
+      continue;
+    }
+    *operands = grow_array(*operands, *size, capacity, sizeof(int));
+    (*operands)[(*size)++] = node;
+  }
+}
+
+/* Return the gate a literal of the given node refers to, or -1 if it has no (or an already encoded) gate */
+static inline int dimacs_pending_gate(int node)
+{
+  if (bool_nodes[node].type == B_NOT)
+    node = bool_nodes[node].left; // bool_not never nests negations
+  if ((bool_nodes[node].type != B_AND && bool_nodes[node].type != B_OR) || dimacs_tseitin_literals[node])
+    return -1;
+  return node;
+}
+
+int dimacs_literal(int node)
+{
+  static int *stack = NULL, *literals = NULL;
+  static int stack_capacity = 0, literals_capacity = 0;
+  struct bool_node *n = &bool_nodes[node];
+  int root = node, size = 0, literals_size, pending, gate, i, *clause;
+
+  if (n->type == B_VAR)
+    return n->left;
+  if (n->type == B_NOT)
+    return -dimacs_literal(n->left);
+  if (n->type == B_TRUE || n->type == B_FALSE) {
+    // only reachable for a constant top-level constraint, encode with a fixed auxiliary variable
+    gate = new_variable(NULL);
+    dimacs_clause(&gate, 1);
+    return n->type == B_TRUE ? gate : -gate;
+  }
+  if (dimacs_tseitin_literals[node])
+    return dimacs_tseitin_literals[node];
+
+  // gates are encoded in post-order with an explicit stack, as disjunctions of selects can be very deep
+  stack = grow_array(stack, size, &stack_capacity, sizeof(int));
+  stack[size++] = node;
+  while (size > 0) {
+    node = stack[size - 1];
+    n = &bool_nodes[node];
+    if (dimacs_tseitin_literals[node]) {
+      size--;
+      continue;
+    }
+    literals_size = 0;
+    collect_bool_operands(node, n->type, &literals, &literals_size, &literals_capacity);
+    // encode the gates of the operands first, from left to right
+    pending = size;
+    for (i = literals_size - 1; i >= 0; i--)
+      if ((gate = dimacs_pending_gate(literals[i])) != -1) {
+        stack = grow_array(stack, size, &stack_capacity, sizeof(int));
+        stack[size++] = gate;
+      }
+    if (size > pending)
+      continue;
+    size--;
+
+    // all operand gates are encoded, so this does not recurse any further
+    for (i = 0; i < literals_size; i++)
+      literals[i] = dimacs_literal(literals[i]);
+    gate = new_variable(NULL);
+    clause = malloc((literals_size + 1) * sizeof(int));
+    if (n->type == B_AND) {
+      // gate <-> (l1 & ... & ln)
+      clause[0] = gate;
+      for (i = 0; i < literals_size; i++) {
+        int binary_clause[] = { -gate, literals[i] };
+        dimacs_clause(binary_clause, 2);
+        clause[i + 1] = -literals[i];
+      }
+    } else {
+      // gate <-> (l1 | ... | ln)
+      clause[0] = -gate;
+      for (i = 0; i < literals_size; i++) {
+        int binary_clause[] = { gate, -literals[i] };
+        dimacs_clause(binary_clause, 2);
+        clause[i + 1] = literals[i];
+      }
+    }
+    dimacs_clause(clause, literals_size + 1);
+    free(clause);
+    dimacs_tseitin_literals[node] = gate;
+  }
+  return dimacs_tseitin_literals[root];
+}
+
+/* Add a top-level constraint, splitting conjunctions and writing disjunctions of literals as a single clause */
+void dimacs_constraint(int node)
+{
+  int *conjuncts = NULL, *literals = NULL, conjuncts_size = 0, conjuncts_capacity = 0, literals_size, literals_capacity = 0, i, j;
+
+  if (node == BOOL_TRUE)
+    return;
+  collect_bool_operands(node, B_AND, &conjuncts, &conjuncts_size, &conjuncts_capacity);
+  for (i = 0; i < conjuncts_size; i++) {
+    literals_size = 0;
+    collect_bool_operands(conjuncts[i], B_OR, &literals, &literals_size, &literals_capacity);
+    for (j = 0; j < literals_size; j++)
+      literals[j] = dimacs_literal(literals[j]);
+    dimacs_clause(literals, literals_size);
+  }
+  free(conjuncts);
+  free(literals);
+}
+
+/* Build the constraints of a configuration variable, analogous to the config, prompt, def_*, dep, and rev_dep lines of --extract */
+int symbol_constraints(struct symbol *sym)
+{
+  struct property *prop;
+  int variable, dep = BOOL_TRUE, rev_dep = BOOL_FALSE, visible = BOOL_FALSE, defaults = BOOL_FALSE, earlier_defaults = BOOL_FALSE;
+
+  if (!has_feature_variable(sym))
+    return BOOL_TRUE;
+  variable = symbol_to_bool(sym);
+#if HAS_dir_dep
+  if (sym->dir_dep.expr)
+    dep = expr_to_bool(sym->dir_dep.expr);
+#endif
+
+  // nonbooleans have a value exactly when their dependencies are satisfied
+  if (sym->type != S_BOOLEAN && sym->type != S_TRISTATE)
+    return bool_and(bool_implies(variable, dep), bool_implies(dep, variable));
+
+  if (enable_reverse_dependencies && sym->rev_dep.expr)
+    rev_dep = expr_to_bool(sym->rev_dep.expr);
+  for_all_prompts(sym, prop)
+    visible = bool_or(visible, expr_to_bool(prop->visible.expr));
+  // the first default whose condition is satisfied determines the value
+  for_all_defaults(sym, prop) {
+    int condition = expr_to_bool(prop->visible.expr);
+    defaults = bool_or(defaults, bool_and(bool_and(condition, expr_to_bool(prop->expr)), bool_not(earlier_defaults)));
+    earlier_defaults = bool_or(earlier_defaults, condition);
+  }
+
+  // selected variables are on, variables are off unless their dependencies are satisfied or they are selected,
+  // and invisible variables take their default value (unless selected)
+  return bool_and(bool_implies(rev_dep, variable),
+    bool_and(bool_implies(variable, bool_or(dep, rev_dep)),
+      bool_and(bool_or(visible, bool_implies(variable, bool_or(rev_dep, defaults))),
+        bool_or(visible, bool_implies(bool_or(rev_dep, defaults), variable)))));
+}
+
+/*
+ * At-most-one encodings of choices (--choice-encoding).
+ * The pairwise encoding needs quadratically many clauses in the number of members, while the sequential counter, commander,
+ * and product encodings need only linearly many, but introduce auxiliary variables (named k!<index>, so they are not projected onto).
+ * Each auxiliary variable is defined as the disjunction of the members it stands for, so even unprojected model counts are preserved.
+ */
+#define CHOICE_ENCODING_MIN_SIZE 5 // smaller choices are encoded pairwise, which needs no auxiliary variables
+#define COMMANDER_GROUP_SIZE 3
+
+int at_most_one(int *nodes, int size);
+
+int at_most_one_pairwise(int *nodes, int size)
+{
+  int constraint = BOOL_TRUE, i, j;
+
+  for (i = 0; i < size; i++)
+    for (j = i + 1; j < size; j++)
+      constraint = bool_and(constraint, bool_or(bool_not(nodes[i]), bool_not(nodes[j])));
+  return constraint;
+}
+
+/* Return a node that is equivalent to the disjunction of some nodes, adding the definition of its auxiliary variable to the constraint */
+int disjunction_variable(int *nodes, int size, int *constraint)
+{
+  int variable, disjunction = BOOL_FALSE, i;
+
+  if (size == 1)
+    return nodes[0];
+  variable = bool_var(new_variable(NULL));
+  for (i = 0; i < size; i++) {
+    *constraint = bool_and(*constraint, bool_implies(nodes[i], variable));
+    disjunction = bool_or(disjunction, nodes[i]);
+  }
+  *constraint = bool_and(*constraint, bool_implies(variable, disjunction));
+  return variable;
+}
+
+/* Sinz' sequential counter, where the i-th counter variable is set if any of the first i members is selected */
+int at_most_one_sequential(int *nodes, int size)
+{
+  int constraint = BOOL_TRUE, counter = nodes[0], i;
+
+  for (i = 1; i < size; i++) {
+    constraint = bool_and(constraint, bool_or(bool_not(counter), bool_not(nodes[i])));
+    if (i < size - 1) {
+      int operands[] = { counter, nodes[i] };
+      counter = disjunction_variable(operands, 2, &constraint);
+    }
+  }
+  return constraint;
+}
+
+/* Klieber and Kwon's commander encoding, where each group of members has a commander variable, of which at most one is set */
+int at_most_one_commander(int *nodes, int size)
+{
+  int constraint = BOOL_TRUE, *commanders = malloc(((size + COMMANDER_GROUP_SIZE - 1) / COMMANDER_GROUP_SIZE) * sizeof(int));
+  int commanders_size = 0, group_size, i;
+
+  for (i = 0; i < size; i += COMMANDER_GROUP_SIZE) {
+    group_size = size - i < COMMANDER_GROUP_SIZE ? size - i : COMMANDER_GROUP_SIZE;
+    constraint = bool_and(constraint, at_most_one_pairwise(nodes + i, group_size));
+    commanders[commanders_size++] = disjunction_variable(nodes + i, group_size, &constraint);
+  }
+  constraint = bool_and(constraint, at_most_one(commanders, commanders_size));
+  free(commanders);
+  return constraint;
+}
+
+/* Chen's product encoding, where the members are arranged in a grid, and at most one row and one column may be selected */
+int at_most_one_product(int *nodes, int size)
+{
+  int constraint = BOOL_TRUE, rows_size = 1, columns_size, *rows, *columns, *line, line_size, i, j;
+
+  while (rows_size * rows_size < size)
+    rows_size++;
+  columns_size = (size + rows_size - 1) / rows_size;
+  rows = malloc(rows_size * sizeof(int));
+  columns = malloc(columns_size * sizeof(int));
+  line = malloc(rows_size * sizeof(int));
+  // the members of row i are nodes[i * columns_size] to nodes[(i + 1) * columns_size - 1], the last row may be shorter
+  for (i = 0; i * columns_size < size; i++)
+    rows[i] = disjunction_variable(nodes + i * columns_size,
+                                   size - i * columns_size < columns_size ? size - i * columns_size : columns_size, &constraint);
+  rows_size = i;
+  for (j = 0; j < columns_size; j++) {
+    for (i = 0, line_size = 0; i * columns_size + j < size; i++)
+      line[line_size++] = nodes[i * columns_size + j];
+    columns[j] = disjunction_variable(line, line_size, &constraint);
+  }
+  constraint = bool_and(constraint, bool_and(at_most_one(rows, rows_size), at_most_one(columns, columns_size)));
+  free(rows);
+  free(columns);
+  free(line);
+  return constraint;
+}
+
+/* Build a constraint that is satisfied if at most one of some nodes is satisfied */
+int at_most_one(int *nodes, int size)
+{
+  if (!choice_encoding || size < CHOICE_ENCODING_MIN_SIZE)
+    return at_most_one_pairwise(nodes, size);
+  if (!strcmp(choice_encoding, "sequential"))
+    return at_most_one_sequential(nodes, size);
+  if (!strcmp(choice_encoding, "commander"))
+    return at_most_one_commander(nodes, size);
+  return at_most_one_product(nodes, size);
+}
+
+/* Build the constraints of a choice, analogous to the *choice lines of --extract */
+int choice_constraints(struct symbol *sym)
+{
+  struct property *prop;
+  struct symbol **member_symbols;
+  int condition = BOOL_TRUE, members = BOOL_FALSE, constraint = BOOL_TRUE, *member_nodes = NULL, size = 0, i, j;
+  bool pairwise;
+
+  if (!sym_is_choice(sym))
+    return BOOL_TRUE;
+  for_all_prompts(sym, prop) {
+    condition = expr_to_bool(prop->visible.expr); // only the first prompt counts, as in --extract
+    break;
+  }
+  member_symbols = choice_members(sym, &size);
+  member_nodes = malloc(size * sizeof(int));
+  for (i = 0; i < size; i++)
+    member_nodes[i] = symbol_to_bool(member_symbols[i]);
+  free(member_symbols);
+
+  // members require the choice to be visible, at most one member is selected, and exactly one unless the choice is optional
+  pairwise = !choice_encoding || size < CHOICE_ENCODING_MIN_SIZE;
+  for (i = 0; i < size; i++) {
+    constraint = bool_and(constraint, bool_implies(member_nodes[i], condition));
+    members = bool_or(members, member_nodes[i]);
+    for (j = i + 1; pairwise && j < size; j++)
+      constraint = bool_and(constraint, bool_or(bool_not(member_nodes[i]), bool_not(member_nodes[j])));
+  }
+  if (!pairwise)
+    constraint = bool_and(constraint, at_most_one(member_nodes, size));
+  if (!sym_is_optional(sym))
+    constraint = bool_and(constraint, bool_implies(condition, members));
+  free(member_nodes);
+  return constraint;
+}
+
+void order_feature_variables(void);
+
+/* Build the constraints of all configuration variables and choices (only once, as they are shared by all formula outputs) */
+void build_constraints(void)
+{
+  struct symbol *sym;
+  int capacity = 0, i;
+
+  if (bool_nodes_size > 0)
+    return;
+  bool_node(B_FALSE, 0, 0);
+  bool_node(B_TRUE, 0, 0);
+  number_symbols();
+  if (variable_order)
+    order_feature_variables(); // see --variable-order
+  _for_output_symbols(sym)
+    add_feature_variable(sym);
+  _for_output_symbols(sym) {
+    if (constraints_size + 2 > capacity) {
+      capacity = capacity ? 2 * capacity : 4096;
+      constraints = realloc(constraints, capacity * sizeof(int));
+    }
+    constraints[constraints_size++] = choice_constraints(sym);
+    constraints[constraints_size++] = symbol_constraints(sym);
+  }
+}
+
+/* Write all constraints as DIMACS, with a variable table and a projection onto all features */
+void print_dimacs(struct output *out)
+{
+  int i;
+
+  build_constraints();
+  dimacs_tseitin_literals = calloc(bool_nodes_size, sizeof(int));
+  for (i = 0; i < constraints_size; i++)
+    dimacs_constraint(constraints[i]);
+
+  for (i = 1; i <= variables_size; i++) {
+    out_str(out, "c ");
+    out_int(out, i);
+    if (variable_names[i]) {
+      out_str(out, " ");
+      out_line(out, variable_names[i]);
+    } else {
+      out_str(out, " k!");
+      out_int(out, i);
+      out_str(out, "\n");
+    }
+  }
+  out_str(out, "c p show");
+  for (i = 1; i <= features_size; i++) {
+    out_str(out, " ");
+    out_int(out, i);
+  }
+  out_str(out, " 0\n");
+  out_str(out, "p cnf ");
+  out_int(out, variables_size);
+  out_str(out, " ");
+  out_int(out, dimacs_clauses);
+  out_str(out, "\n");
+  output_append(out, &dimacs_clauses_out);
+  free(dimacs_tseitin_literals);
+}
+
+struct model_frame {
+  int node;
+  enum bool_type parent_type;
+  const char *text; // printed instead of a node, if not NULL
+};
+
+static struct model_frame *model_stack = NULL;
+static int model_stack_size = 0, model_stack_capacity = 0;
+
+void push_model_frame(int node, enum bool_type parent_type, const char *text)
+{
+  model_stack = grow_array(model_stack, model_stack_size, &model_stack_capacity, sizeof(struct model_frame));
+  model_stack[model_stack_size].node = node;
+  model_stack[model_stack_size].parent_type = parent_type;
+  model_stack[model_stack_size++].text = text;
+}
+
+/* Print a formula in KConfigReader's syntax, flattening nested conjunctions and disjunctions (with an explicit stack, as they can be very deep) */
+void print_model_formula(struct output *out, int node, enum bool_type parent_type)
+{
+  struct model_frame top;
+  struct bool_node *n;
+
+  push_model_frame(node, parent_type, NULL);
+  while (model_stack_size > 0) {
+    top = model_stack[--model_stack_size];
+    if (top.text) {
+      out_str(out, top.text);
+      continue;
+    }
+    n = &bool_nodes[top.node];
+    switch (n->type) {
+    case B_FALSE:
+      out_str(out, "0");
+      break;
+    case B_TRUE:
+      out_str(out, "1");
+      break;
+    case B_VAR:
+      model_literals++;
+      if (!model_variable_used[n->left]) {
+        model_variable_used[n->left] = true;
+        model_variables++;
+      }
+      out_str(out, "def(");
+      if (model_variable_name(n->left))
+        out_str(out, model_variable_name(n->left));
+      else {
+        // auxiliary variables of --choice-encoding have no #item line, so they are not projected onto
+        out_str(out, "k!");
+        out_int(out, n->left);
+      }
+      out_str(out, ")");
+      break;
+    case B_NOT:
+      out_str(out, "!");
+      push_model_frame(n->left, B_NOT, NULL);
+      break;
+    case B_AND:
+    case B_OR:
+      // the stack prints the left operand, the operator, the right operand, and the closing parenthesis in this order
+      if (top.parent_type != n->type) {
+        out_str(out, "(");
+        push_model_frame(-1, top.parent_type, ")");
+      }
+      push_model_frame(n->right, n->type, NULL);
+      push_model_frame(-1, n->type, n->type == B_AND ? "&" : "|");
+      push_model_frame(n->left, n->type, NULL);
+      break;
+    }
+  }
+}
+
+/* Print a top-level constraint, one line per conjunct */
+void print_model_constraint(struct output *out, int node)
+{
+  static int *conjuncts = NULL;
+  static int conjuncts_capacity = 0;
+  int conjuncts_size = 0, i;
+
+  if (node == BOOL_TRUE)
+    return;
+  collect_bool_operands(node, B_AND, &conjuncts, &conjuncts_size, &conjuncts_capacity);
+  for (i = 0; i < conjuncts_size; i++) {
+    print_model_formula(out, conjuncts[i], B_FALSE);
+    out_str(out, "\n");
+  }
+}
+
+/* Write all constraints in KConfigReader's .model format, with an #item line for every feature */
+void print_model(struct output *out)
+{
+  int i;
+
+  build_constraints();
+  model_variable_used = calloc(variables_size + 1, sizeof(bool));
+  for (i = 1; i <= features_size; i++) {
+    out_str(out, "#item ");
+    out_line(out, model_variable_name(i));
+  }
+  for (i = 0; i < constraints_size; i++)
+    print_model_constraint(out, constraints[i]);
+}
+
+/*
+ * Dependency index (--deps).
+ * We number all named, non-constant symbols and record the symbols each of them depends on in forward and reverse adjacency arrays.
+ * Each edge is labeled with the kinds of dependencies it stems from, so a single index answers all queries.
+ * The index is built once per parse, so that batches of queries can be answered without re-reading the extract output.
+ */
+enum dep_kind {
+  DEP_DIRECT = 1, // depends on (dir_dep)
+  DEP_REVERSE = 2, // selected by (the targets of selects)
+  DEP_VISIBLE = 4, // prompt visibility
+  DEP_DEFAULT = 8, // default values and their conditions
+  DEP_CHOICE = 16, // choice membership (only in --graph)
+  DEP_SELECT_CONDITION = 32, // conditions of selects (which LKC also records in rev_dep, next to the selecting symbols)
+};
+
+struct dep_edge {
+  int from, to, kinds;
+};
+
+struct dep_adjacency {
+  // the neighbors of symbol i are targets[offsets[i]] to targets[offsets[i + 1] - 1], sorted by index
+  int *offsets;
+  int *targets;
+  int *kinds;
+};
+
+static bool transitive_deps = false;
+static struct symbol **dep_symbols = NULL;
+static int dep_symbols_size = 0;
+static struct hash_map dep_symbol_ids;
+static struct dep_edge *dep_edges = NULL;
+static int dep_edges_size = 0, dep_edges_capacity = 0;
+static struct dep_adjacency dep_forward, dep_reverse; // forward: X depends on Y, reverse: Y is depended on by X
+
+bool is_dep_symbol(struct symbol *sym)
+{
+  return sym->name && strlen(sym->name) > 0 && !(sym->flags & SYMBOL_CONST) &&
+    sym != &symbol_yes && sym != &symbol_mod && sym != &symbol_no;
+}
+
+int dep_symbol_id(struct symbol *sym)
+{
+  return sym ? hash_map_get(&dep_symbol_ids, (uintptr_t) sym, 0, 0) : -1;
+}
+
+void add_dep_edge(int from, struct symbol *sym, int kind)
+{
+  int to = dep_symbol_id(sym);
+
+  if (to == -1 || to == from)
+    return;
+  if (dep_edges_size == dep_edges_capacity) {
+    dep_edges_capacity = dep_edges_capacity ? 2 * dep_edges_capacity : 4096;
+    dep_edges = realloc(dep_edges, dep_edges_capacity * sizeof(struct dep_edge));
+  }
+  dep_edges[dep_edges_size].from = from;
+  dep_edges[dep_edges_size].to = to;
+  dep_edges[dep_edges_size].kinds = kind;
+  dep_edges_size++;
+}
+
+struct symbol **expr_symbols(struct expr *e, int *symbols_size);
+
+/* Add an edge from the given symbol to every symbol mentioned in an expression */
+void add_dep_edges(int from, struct expr *e, int kind)
+{
+  struct symbol **symbols;
+  int size, i;
+
+  symbols = expr_symbols(e, &size);
+  for (i = 0; i < size; i++)
+    add_dep_edge(from, symbols[i], kind);
+}
+
+int compare_dep_edges(const void *a, const void *b)
+{
+  const struct dep_edge *x = a, *y = b;
+
+  if (x->from != y->from)
+    return x->from < y->from ? -1 : 1;
+  return x->to < y->to ? -1 : x->to > y->to;
+}
+
+/* Sort edges and merge parallel ones, so each pair of symbols is connected at most once, returning the new number of edges */
+int merge_dep_edges(struct dep_edge *edges, int size)
+{
+  int i, merged;
+
+  qsort(edges, size, sizeof(struct dep_edge), compare_dep_edges);
+  for (i = 0, merged = 0; i < size; i++)
+    if (merged > 0 && edges[merged - 1].from == edges[i].from && edges[merged - 1].to == edges[i].to)
+      edges[merged - 1].kinds |= edges[i].kinds;
+    else
+      edges[merged++] = edges[i];
+  return merged;
+}
+
+/* Store the (sorted and merged) edges as adjacency arrays, reversing them if requested */
+void build_adjacency(struct dep_adjacency *adjacency, struct dep_edge *edges, int edges_size, int nodes_size, bool reverse)
+{
+  int i, from;
+  int *next = calloc(nodes_size + 1, sizeof(int));
+
+  adjacency->offsets = calloc(nodes_size + 1, sizeof(int));
+  adjacency->targets = malloc((edges_size + 1) * sizeof(int));
+  adjacency->kinds = malloc((edges_size + 1) * sizeof(int));
+  for (i = 0; i < edges_size; i++)
+    adjacency->offsets[(reverse ? edges[i].to : edges[i].from) + 1]++;
+  for (i = 0; i < nodes_size; i++)
+    adjacency->offsets[i + 1] += adjacency->offsets[i];
+  memcpy(next, adjacency->offsets, (nodes_size + 1) * sizeof(int));
+  // edges are sorted by source, so the reversed edges end up sorted by target as well
+  for (i = 0; i < edges_size; i++) {
+    from = reverse ? edges[i].to : edges[i].from;
+    adjacency->targets[next[from]] = reverse ? edges[i].from : edges[i].to;
+    adjacency->kinds[next[from]++] = edges[i].kinds;
+  }
+  free(next);
+}
+
+void build_dep_index(void)
+{
+  struct symbol *sym;
+  struct property *prop;
+  int i, id, to;
+
+  if (dep_symbols)
+    return;
+  // the index follows the order of symbol IDs, so that its answers are stable as well
+  number_symbols();
+  dep_symbols = malloc((symbols_by_id_size + 1) * sizeof(struct symbol *));
+  for (i = 0; i < symbols_by_id_size; i++)
+    if (is_dep_symbol(symbols_by_id[i])) {
+      dep_symbols[dep_symbols_size] = symbols_by_id[i];
+      hash_map_put(&dep_symbol_ids, (uintptr_t) symbols_by_id[i], 0, 0, dep_symbols_size++);
+    }
+
+  for (id = 0; id < dep_symbols_size; id++) {
+    sym = dep_symbols[id];
+#if HAS_dir_dep
+    add_dep_edges(id, sym->dir_dep.expr, DEP_DIRECT);
+#endif
+    // rev_dep mixes selecting symbols with the conditions of their selects, so we take both from the select properties
+    for (prop = sym->prop; prop; prop = prop->next) {
+#if HAS_P_PROMPT
+      if (prop->type == P_PROMPT)
+        add_dep_edges(id, prop->visible.expr, DEP_VISIBLE);
+#endif
+#if HAS_P_DEFAULT
+      if (prop->type == P_DEFAULT) {
+        add_dep_edges(id, prop->expr, DEP_DEFAULT);
+        add_dep_edges(id, prop->visible.expr, DEP_DEFAULT);
+      }
+#endif
+#if HAS_P_SELECT
+      // the selected symbol is selected by this one, and depends on the condition of the select
+      if (prop->type == P_SELECT && prop->expr && prop->expr->type == E_SYMBOL && (to = dep_symbol_id(prop->expr->left.sym)) != -1) {
+        add_dep_edge(to, sym, DEP_REVERSE);
+        add_dep_edges(to, prop->visible.expr, DEP_SELECT_CONDITION);
+      }
+#endif
+    }
+  }
+
+  dep_edges_size = merge_dep_edges(dep_edges, dep_edges_size);
+  build_adjacency(&dep_forward, dep_edges, dep_edges_size, dep_symbols_size, false);
+  build_adjacency(&dep_reverse, dep_edges, dep_edges_size, dep_symbols_size, true);
+}
+
+int find_dep_symbol(const char *name)
+{
+  return dep_symbol_id(find_symbol(name));
+}
+
+/* Print all symbols reachable from a symbol over edges of the given kinds (directly or, with --transitive, transitively) */
+void print_dep_relation(struct output *out, int id, const char *relation, struct dep_adjacency *adjacency, int kinds)
+{
+  static int *visited = NULL, *queue = NULL, generation = 0;
+  int head = 0, tail = 0, from, i;
+
+  if (!visited) {
+    visited = calloc(dep_symbols_size + 1, sizeof(int));
+    queue = malloc((dep_symbols_size + 1) * sizeof(int));
+  }
+  generation++;
+  visited[id] = generation;
+  queue[tail++] = id;
+  out_name(out, dep_symbols[id]);
+  out_str(out, " ");
+  out_str(out, relation);
+  while (head < tail) {
+    from = queue[head++];
+    for (i = adjacency->offsets[from]; i < adjacency->offsets[from + 1]; i++)
+      if ((adjacency->kinds[i] & kinds) && visited[adjacency->targets[i]] != generation) {
+        visited[adjacency->targets[i]] = generation;
+        out_str(out, " ");
+        out_name(out, dep_symbols[adjacency->targets[i]]);
+        if (transitive_deps)
+          queue[tail++] = adjacency->targets[i];
+      }
+  }
+  out_str(out, "\n");
+}
+
+void print_deps_of(struct output *out, const char *name)
+{
+  int id = find_dep_symbol(name);
+  int kinds = DEP_DIRECT | DEP_VISIBLE | DEP_DEFAULT | DEP_SELECT_CONDITION;
+
+  if (id == -1) {
+    fprintf(stderr, "unknown symbol %s\n", name);
+    return;
+  }
+  print_dep_relation(out, id, transitive_deps ? "depends_on*" : "depends_on", &dep_forward, kinds);
+  print_dep_relation(out, id, transitive_deps ? "selected_by*" : "selected_by", &dep_forward, DEP_REVERSE);
+  print_dep_relation(out, id, transitive_deps ? "required_by*" : "required_by", &dep_reverse, kinds);
+  print_dep_relation(out, id, transitive_deps ? "selects*" : "selects", &dep_reverse, DEP_REVERSE);
+}
+
+/* Answer a dependency query for a single symbol, or for all symbols listed in a file given as @FILE */
+void print_deps(struct output *out, const char *query)
+{
+  FILE *fp;
+  char *line = NULL;
+  size_t len = 0;
+  ssize_t read;
+
+  build_dep_index();
+  if (query[0] != '@') {
+    print_deps_of(out, query);
+    return;
+  }
+  if ((fp = fopen(query + 1, "r")) == NULL) {
+    perror("fopen");
+    exit(1);
+  }
+  while ((read = getline(&line, &len, fp)) != -1) {
+    while (read > 0 && (line[read - 1] == '\n' || line[read - 1] == '\r'))
+      line[--read] = '\0';
+    if (read > 0)
+      print_deps_of(out, line);
+  }
+  free(line);
+  fclose(fp);
+}
+
+/*
+ * Dependency-cone slicing (--slice).
+ * Many analyses only concern a few features, so all symbol outputs can be restricted to the transitive cone of some seed symbols:
+ * each symbol mentioned in the dependencies, reverse dependencies, selects, prompt and default conditions, defaults, or ranges
+ * of a symbol in the cone is in the cone as well, and so are the choices of its members and all members of its choices.
+ * The constraints of the cone only mention symbols in the cone, so they can be analyzed on their own.
+ * Referenced symbols that are never declared have no constraints, so they remain free variables, which --free-variables reports.
+ */
+static bool *slice_members = NULL; // indexed by symbol ID
+static struct symbol **slice_queue = NULL;
+static int slice_queue_size = 0, slice_queue_capacity = 0;
+static struct hash_map slice_choices; // the choice of each choice member
+
+void slice_symbol(struct symbol *sym)
+{
+  int id = sym ? hash_map_get(&symbol_ids, (uintptr_t) sym, 0, 0) : -1;
+
+  // symbols outside of the symbol table (e.g., y, m, and n in some LKC versions) are never output
+  if (id == -1 || slice_members[id])
+    return;
+  slice_members[id] = true;
+  slice_queue = grow_array(slice_queue, slice_queue_size, &slice_queue_capacity, sizeof(struct symbol *));
+  slice_queue[slice_queue_size++] = sym;
+}
+
+/* Collect all symbols mentioned in an expression (the array is reused by the next call) */
+struct symbol **expr_symbols(struct expr *e, int *symbols_size)
+{
+  static struct expr **stack = NULL;
+  static struct symbol **symbols = NULL;
+  static int stack_capacity = 0, symbols_capacity = 0;
+  struct expr *left, *right;
+  uint32_t type;
+  int size = 0;
+
+  *symbols_size = 0;
+  if (!e)
+    return symbols;
+  stack = grow_array(stack, size, &stack_capacity, sizeof(struct expr *));
+  stack[size++] = e;
+  while (size > 0) {
+    e = stack[--size];
+    type = snapshot_expr_type(e, &left, &right);
+    if (type == SNAPSHOT_E_SYMBOL || (type >= SNAPSHOT_E_EQUAL && type <= SNAPSHOT_E_RANGE)) {
+      symbols = grow_array(symbols, *symbols_size, &symbols_capacity, sizeof(struct symbol *));
+      symbols[(*symbols_size)++] = e->left.sym;
+    }
+    if ((type >= SNAPSHOT_E_EQUAL && type <= SNAPSHOT_E_RANGE) || type == SNAPSHOT_E_LIST || type == SNAPSHOT_E_CHOICE) {
+      symbols = grow_array(symbols, *symbols_size, &symbols_capacity, sizeof(struct symbol *));
+      symbols[(*symbols_size)++] = e->right.sym;
+    }
+    stack = grow_array(stack, size + 1, &stack_capacity, sizeof(struct expr *));
+    if (right)
+      stack[size++] = right;
+    if (left)
+      stack[size++] = left;
+  }
+  return symbols;
+}
+
+/* Add all symbols mentioned in an expression to the cone */
+void slice_expr(struct expr *e)
+{
+  struct symbol **symbols;
+  int size, i;
+
+  symbols = expr_symbols(e, &size);
+  for (i = 0; i < size; i++)
+    slice_symbol(symbols[i]);
+}
+
+void slice_seed(const char *name)
+{
+  struct symbol *sym = find_symbol(name);
+
+  if (!sym) {
+    fprintf(stderr, "unknown symbol %s\n", name);
+    return;
+  }
+  slice_symbol(sym);
+}
+
+/* Add the seeds, given as a comma-separated list or as @FILE with one symbol per line */
+void slice_add_seeds(char *seeds)
+{
+  FILE *fp;
+  char *line = NULL, *name;
+  size_t len = 0;
+  ssize_t read;
+
+  if (seeds[0] != '@') {
+    for (name = strtok(seeds, ","); name; name = strtok(NULL, ","))
+      slice_seed(name);
+    return;
+  }
+  if ((fp = fopen(seeds + 1, "r")) == NULL) {
+    perror("fopen");
+    exit(1);
+  }
+  while ((read = getline(&line, &len, fp)) != -1) {
+    while (read > 0 && (line[read - 1] == '\n' || line[read - 1] == '\r'))
+      line[--read] = '\0';
+    if (read > 0)
+      slice_seed(line);
+  }
+  free(line);
+  fclose(fp);
+}
+
+/* Restrict the output symbols to the cone of the seeds, keeping their order */
+void slice_symbols(void)
+{
+  struct symbol *sym, **members;
+  struct property *prop;
+  int members_size, size = 0, id, i, j;
+
+  slice_members = calloc(symbols_by_id_size, sizeof(bool));
+  _for_output_symbols(sym) {
+    members = choice_members(sym, &members_size);
+    for (j = 0; j < members_size; j++)
+      hash_map_put(&slice_choices, (uintptr_t) members[j], 0, 0, symbol_id(sym));
+    free(members);
+  }
+
+  slice_add_seeds(slice_seeds);
+  while (slice_queue_size > 0) {
+    sym = slice_queue[--slice_queue_size];
+#if HAS_dir_dep
+    slice_expr(sym->dir_dep.expr);
+#endif
+    if (enable_reverse_dependencies)
+      slice_expr(sym->rev_dep.expr);
+    for (prop = sym->prop; prop; prop = prop->next) {
+#if HAS_P_IMPLY
+      if (prop->type == P_IMPLY)
+        continue; // imply is ignored by all outputs
+#endif
+#if HAS_P_SELECT
+      if (prop->type == P_SELECT && !enable_reverse_dependencies)
+        continue;
+#endif
+      slice_expr(prop->expr);
+      slice_expr(prop->visible.expr);
+    }
+    members = choice_members(sym, &members_size);
+    for (j = 0; j < members_size; j++)
+      slice_symbol(members[j]);
+    free(members);
+    if ((id = hash_map_get(&slice_choices, (uintptr_t) sym, 0, 0)) != -1)
+      slice_symbol(symbols_by_id[id]);
+  }
+
+  _for_output_symbols(sym)
+    if (slice_members[symbol_id(sym)])
+      output_symbols[size++] = sym;
+  output_symbols_size = size;
+}
+
+/* Print all referenced configuration variables without constraints of their own (e.g., because they are never declared) */
+void print_free_variables(struct output *out)
+{
+  struct symbol *sym;
+  int i;
+
+  number_symbols();
+  _for_output_symbols(sym)
+    if (is_dep_symbol(sym) && !has_feature_variable(sym))
+      out_line(out, sym->name);
+}
+
+/*
+ * Dependency graph (--graph and --graph-binary).
+ * We export the symbol-level dependency graph as a CSR (compressed sparse row) adjacency structure, so that analyses
+ * (e.g., variable orders or model partitioning) need not rebuild it from the textual constraints.
+ * The nodes are all named or choice symbols in the output (so --slice applies), in the order of their IDs (see --symbol-table).
+ * An edge from X to Y means that the constraints of X mention Y, and it is labeled with the kinds of the dependency index,
+ * plus choice membership (from each member to its choice).
+ * The strongly connected components are numbered in a topological order of their condensation, dependencies first,
+ * so each component only has edges to itself and to components with smaller numbers.
+ *
+ * The binary form consists of the header below, followed by sections of 32-bit integers in native byte order,
+ * each padded to 8 bytes and located by its offset in the header: the symbol ID and name (an offset into the string pool,
+ * 0 for none) of each node, the outgoing edges (nodes_size + 1 offsets, then the targets and kinds of edges_size edges),
+ * the incoming edges (offsets and sources), the component of each node, and the nodes of each component
+ * (components_size + 1 offsets into the node list), followed by the string pool.
+ */
+#define GRAPH_MAGIC "KXGRAPH1"
+#define GRAPH_VERSION 1
+
+struct graph_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t nodes_size, edges_size, components_size, strings_size;
+  uint32_t symbols_offset, names_offset;
+  uint32_t out_offsets_offset, out_targets_offset, out_kinds_offset;
+  uint32_t in_offsets_offset, in_sources_offset;
+  uint32_t components_offset, component_offsets_offset, component_nodes_offset;
+  uint32_t strings_offset;
+};
+
+static struct symbol **graph_symbols = NULL;
+static int graph_symbols_size = 0;
+static struct hash_map graph_symbol_ids;
+static struct dep_edge *graph_edges = NULL;
+static int graph_edges_size = 0, graph_edges_capacity = 0;
+static struct dep_adjacency graph_out, graph_in;
+static int *graph_components = NULL; // the component of each node
+static int *graph_component_offsets = NULL, *graph_component_nodes = NULL;
+static int graph_components_size = 0;
+
+bool is_graph_symbol(struct symbol *sym)
+{
+  return is_dep_symbol(sym) || (sym_is_choice(sym) && !(sym->flags & SYMBOL_CONST));
+}
+
+void add_graph_edge(int from, struct symbol *sym, int kind)
+{
+  int to = sym ? hash_map_get(&graph_symbol_ids, (uintptr_t) sym, 0, 0) : -1;
+
+  if (to == -1 || to == from)
+    return;
+  graph_edges = grow_array(graph_edges, graph_edges_size, &graph_edges_capacity, sizeof(struct dep_edge));
+  graph_edges[graph_edges_size].from = from;
+  graph_edges[graph_edges_size].to = to;
+  graph_edges[graph_edges_size].kinds = kind;
+  graph_edges_size++;
+}
+
+void add_graph_edges(int from, struct expr *e, int kind)
+{
+  struct symbol **symbols;
+  int size, i;
+
+  symbols = expr_symbols(e, &size);
+  for (i = 0; i < size; i++)
+    add_graph_edge(from, symbols[i], kind);
+}
+
+/* Number the strongly connected components with Tarjan's algorithm, which finds them in topological order (without recursion) */
+void find_graph_components(void)
+{
+  int *index = malloc((graph_symbols_size + 1) * sizeof(int)), *lowlink = malloc((graph_symbols_size + 1) * sizeof(int));
+  int *call_nodes = malloc((graph_symbols_size + 1) * sizeof(int)), *call_edges = malloc((graph_symbols_size + 1) * sizeof(int));
+  int *stack = malloc((graph_symbols_size + 1) * sizeof(int));
+  bool *on_stack = calloc(graph_symbols_size + 1, sizeof(bool));
+  int *next;
+  int calls_size = 0, stack_size = 0, counter = 0, root, node, target, i;
+
+  graph_components = malloc((graph_symbols_size + 1) * sizeof(int));
+  memset(index, -1, (graph_symbols_size + 1) * sizeof(int));
+  for (root = 0; root < graph_symbols_size; root++) {
+    if (index[root] != -1)
+      continue;
+    index[root] = lowlink[root] = counter++;
+    stack[stack_size++] = root;
+    on_stack[root] = true;
+    call_nodes[calls_size] = root;
+    call_edges[calls_size++] = graph_out.offsets[root];
+    while (calls_size > 0) {
+      node = call_nodes[calls_size - 1];
+      if (call_edges[calls_size - 1] < graph_out.offsets[node + 1]) {
+        target = graph_out.targets[call_edges[calls_size - 1]++];
+        if (index[target] == -1) {
+          index[target] = lowlink[target] = counter++;
+          stack[stack_size++] = target;
+          on_stack[target] = true;
+          call_nodes[calls_size] = target;
+          call_edges[calls_size++] = graph_out.offsets[target];
+        } else if (on_stack[target] && index[target] < lowlink[node])
+          lowlink[node] = index[target];
+        continue;
+      }
+      // all successors are done, so the node is the root of a component if it cannot reach an earlier node on the stack
+      calls_size--;
+      if (calls_size > 0 && lowlink[node] < lowlink[call_nodes[calls_size - 1]])
+        lowlink[call_nodes[calls_size - 1]] = lowlink[node];
+      if (lowlink[node] != index[node])
+        continue;
+      do {
+        target = stack[--stack_size];
+        on_stack[target] = false;
+        graph_components[target] = graph_components_size;
+      } while (target != node);
+      graph_components_size++;
+    }
+  }
+
+  // list the nodes of each component, ordered by their IDs
+  graph_component_offsets = calloc(graph_components_size + 1, sizeof(int));
+  graph_component_nodes = malloc((graph_symbols_size + 1) * sizeof(int));
+  next = malloc((graph_components_size + 1) * sizeof(int));
+  for (i = 0; i < graph_symbols_size; i++)
+    graph_component_offsets[graph_components[i] + 1]++;
+  for (i = 0; i < graph_components_size; i++)
+    graph_component_offsets[i + 1] += graph_component_offsets[i];
+  memcpy(next, graph_component_offsets, (graph_components_size + 1) * sizeof(int));
+  for (i = 0; i < graph_symbols_size; i++)
+    graph_component_nodes[next[graph_components[i]]++] = i;
+  free(index);
+  free(lowlink);
+  free(call_nodes);
+  free(call_edges);
+  free(stack);
+  free(on_stack);
+  free(next);
+}
+
+void build_graph(void)
+{
+  struct symbol *sym, **members;
+  struct property *prop;
+  int members_size, id, i;
+
+  if (graph_symbols)
+    return;
+  number_symbols();
+  graph_symbols = malloc((symbols_by_id_size + 1) * sizeof(struct symbol *));
+  for (id = 0; id < symbols_by_id_size; id++)
+    if (is_graph_symbol(symbols_by_id[id]) && (!slice_members || slice_members[id])) {
+      graph_symbols[graph_symbols_size] = symbols_by_id[id];
+      hash_map_put(&graph_symbol_ids, (uintptr_t) symbols_by_id[id], 0, 0, graph_symbols_size++);
+    }
+
+  for (id = 0; id < graph_symbols_size; id++) {
+    sym = graph_symbols[id];
+#if HAS_dir_dep
+    add_graph_edges(id, sym->dir_dep.expr, DEP_DIRECT);
+#endif
+    for (prop = sym->prop; prop; prop = prop->next) {
+#if HAS_P_PROMPT
+      if (prop->type == P_PROMPT)
+        add_graph_edges(id, prop->visible.expr, DEP_VISIBLE);
+#endif
+#if HAS_P_DEFAULT
+      if (prop->type == P_DEFAULT) {
+        add_graph_edges(id, prop->expr, DEP_DEFAULT);
+        add_graph_edges(id, prop->visible.expr, DEP_DEFAULT);
+      }
+#endif
+#if HAS_P_SELECT
+      // as in the dependency index, rev_dep is split into the selecting symbol and the condition of the select
+      if (prop->type == P_SELECT && enable_reverse_dependencies && prop->expr && prop->expr->type == E_SYMBOL &&
+          (i = hash_map_get(&graph_symbol_ids, (uintptr_t) prop->expr->left.sym, 0, 0)) != -1) {
+        add_graph_edge(i, sym, DEP_REVERSE);
+        add_graph_edges(i, prop->visible.expr, DEP_SELECT_CONDITION);
+      }
+#endif
+    }
+    members = choice_members(sym, &members_size);
+    for (i = 0; i < members_size; i++)
+      if (hash_map_get(&graph_symbol_ids, (uintptr_t) members[i], 0, 0) != -1)
+        add_graph_edge(hash_map_get(&graph_symbol_ids, (uintptr_t) members[i], 0, 0), sym, DEP_CHOICE);
+    free(members);
+  }
+
+  graph_edges_size = merge_dep_edges(graph_edges, graph_edges_size);
+  build_adjacency(&graph_out, graph_edges, graph_edges_size, graph_symbols_size, false);
+  build_adjacency(&graph_in, graph_edges, graph_edges_size, graph_symbols_size, true);
+  find_graph_components();
+}
+
+void out_graph_kinds(struct output *out, int kinds)
+{
+  static const char *names[] = { "depends", "selected_by", "visible", "default", "choice", "select_condition" };
+  const char *separator = "";
+  int i;
+
+  for (i = 0; i < (int) ARRAY_SIZE(names); i++)
+    if (kinds & (1 << i)) {
+      out_str(out, separator);
+      out_str(out, names[i]);
+      separator = ",";
+    }
+}
+
+/*
+ * Print the graph as text, with the sizes first, then one line per node
+ * (n ID SYMBOL-ID COMPONENT IN-DEGREE OUT-DEGREE NAME, - for unnamed choices), one line per edge in CSR order (e FROM TO KINDS),
+ * and one line per component in topological order (c ID NODES...).
+ */
+void print_graph(struct output *out)
+{
+  int i, j;
+
+  build_graph();
+  out_str(out, "graph ");
+  out_int(out, graph_symbols_size);
+  out_str(out, " ");
+  out_int(out, graph_edges_size);
+  out_str(out, " ");
+  out_int(out, graph_components_size);
+  out_str(out, "\n");
+  for (i = 0; i < graph_symbols_size; i++) {
+    out_str(out, "n ");
+    out_int(out, i);
+    out_str(out, " ");
+    out_int(out, symbol_id(graph_symbols[i]));
+    out_str(out, " ");
+    out_int(out, graph_components[i]);
+    out_str(out, " ");
+    out_int(out, graph_in.offsets[i + 1] - graph_in.offsets[i]);
+    out_str(out, " ");
+    out_int(out, graph_out.offsets[i + 1] - graph_out.offsets[i]);
+    out_str(out, " ");
+    if (graph_symbols[i]->name)
+      out_name(out, graph_symbols[i]);
+    else
+      out_str(out, "-");
+    out_str(out, "\n");
+  }
+  for (i = 0; i < graph_symbols_size; i++)
+    for (j = graph_out.offsets[i]; j < graph_out.offsets[i + 1]; j++) {
+      out_str(out, "e ");
+      out_int(out, i);
+      out_str(out, " ");
+      out_int(out, graph_out.targets[j]);
+      out_str(out, " ");
+      out_graph_kinds(out, graph_out.kinds[j]);
+      out_str(out, "\n");
+    }
+  for (i = 0; i < graph_components_size; i++) {
+    out_str(out, "c ");
+    out_int(out, i);
+    for (j = graph_component_offsets[i]; j < graph_component_offsets[i + 1]; j++) {
+      out_str(out, " ");
+      out_int(out, graph_component_nodes[j]);
+    }
+    out_str(out, "\n");
+  }
+}
+
+/* Print the graph in binary form (see above) */
+void print_graph_binary(struct output *out)
+{
+  struct graph_header header;
+  struct output strings = { NULL };
+  int32_t *symbols, *names;
+  uint32_t offset;
+  int i;
+
+  build_graph();
+  symbols = malloc((graph_symbols_size + 1) * sizeof(int32_t));
+  names = malloc((graph_symbols_size + 1) * sizeof(int32_t));
+  output_write(&strings, "", 1);
+  for (i = 0; i < graph_symbols_size; i++) {
+    symbols[i] = symbol_id(graph_symbols[i]);
+    names[i] = graph_symbols[i]->name ? strings.size : 0;
+    if (graph_symbols[i]->name) {
+      out_name(&strings, graph_symbols[i]);
+      output_write(&strings, "", 1);
+    }
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, GRAPH_MAGIC, sizeof(header.magic));
+  header.version = GRAPH_VERSION;
+  header.byte_order = SNAPSHOT_BYTE_ORDER;
+  header.nodes_size = graph_symbols_size;
+  header.edges_size = graph_edges_size;
+  header.components_size = graph_components_size;
+  header.strings_size = strings.size;
+  offset = snapshot_section_size(sizeof(header));
+#define GRAPH_SECTION(section, size) \
+  header.section##_offset = offset;  \
+  offset += snapshot_section_size((size_t) (size) * sizeof(int32_t));
+  GRAPH_SECTION(symbols, graph_symbols_size)
+  GRAPH_SECTION(names, graph_symbols_size)
+  GRAPH_SECTION(out_offsets, graph_symbols_size + 1)
+  GRAPH_SECTION(out_targets, graph_edges_size)
+  GRAPH_SECTION(out_kinds, graph_edges_size)
+  GRAPH_SECTION(in_offsets, graph_symbols_size + 1)
+  GRAPH_SECTION(in_sources, graph_edges_size)
+  GRAPH_SECTION(components, graph_symbols_size)
+  GRAPH_SECTION(component_offsets, graph_components_size + 1)
+  GRAPH_SECTION(component_nodes, graph_symbols_size)
+#undef GRAPH_SECTION
+  header.strings_offset = offset;
+
+  write_snapshot_section(out, &header, sizeof(header));
+  write_snapshot_section(out, symbols, graph_symbols_size * sizeof(int32_t));
+  write_snapshot_section(out, names, graph_symbols_size * sizeof(int32_t));
+  write_snapshot_section(out, graph_out.offsets, (graph_symbols_size + 1) * sizeof(int32_t));
+  write_snapshot_section(out, graph_out.targets, graph_edges_size * sizeof(int32_t));
+  write_snapshot_section(out, graph_out.kinds, graph_edges_size * sizeof(int32_t));
+  write_snapshot_section(out, graph_in.offsets, (graph_symbols_size + 1) * sizeof(int32_t));
+  write_snapshot_section(out, graph_in.targets, graph_edges_size * sizeof(int32_t));
+  write_snapshot_section(out, graph_components, graph_symbols_size * sizeof(int32_t));
+  write_snapshot_section(out, graph_component_offsets, (graph_components_size + 1) * sizeof(int32_t));
+  write_snapshot_section(out, graph_component_nodes, graph_symbols_size * sizeof(int32_t));
+  write_snapshot_section(out, strings.data, strings.size);
+  free(symbols);
+  free(names);
+  free(strings.data);
+}
+
+/*
+ * Variable orders (--variable-order).
+ * Solvers and knowledge compilers are sensitive to the numbering of variables, which otherwise follows the output order.
+ * So the feature variables of --dimacs and --model can be numbered along the dependency graph (see --graph, taken as undirected):
+ * menu (depth-first order of the menu tree, i.e., symbol IDs), bfs (breadth-first, from the first symbol of each
+ * connected component), rcm (reverse Cuthill-McKee, which keeps the bandwidth of the adjacency matrix small),
+ * or mincut (recursive bisection, so that few edges cross between the halves of each part).
+ * Comparison and Tseitin variables are numbered after the features as usual, and the c lines of --dimacs record the mapping.
+ */
+static int *order_visited = NULL, order_generation = 0;
+
+int graph_degree(int node)
+{
+  return graph_out.offsets[node + 1] - graph_out.offsets[node] + graph_in.offsets[node + 1] - graph_in.offsets[node];
+}
+
+/* Collect the neighbors of a node in either direction (the array is reused by the next call) */
+int *graph_neighbors(int node, int *size)
+{
+  static int *neighbors = NULL;
+  static int capacity = 0;
+  int i;
+
+  *size = 0;
+  for (i = graph_out.offsets[node]; i < graph_out.offsets[node + 1]; i++) {
+    neighbors = grow_array(neighbors, *size, &capacity, sizeof(int));
+    neighbors[(*size)++] = graph_out.targets[i];
+  }
+  for (i = graph_in.offsets[node]; i < graph_in.offsets[node + 1]; i++) {
+    neighbors = grow_array(neighbors, *size, &capacity, sizeof(int));
+    neighbors[(*size)++] = graph_in.targets[i];
+  }
+  return neighbors;
+}
+
+int compare_graph_degrees(const void *a, const void *b)
+{
+  int x = *(const int *) a, y = *(const int *) b;
+
+  if (graph_degree(x) != graph_degree(y))
+    return graph_degree(x) < graph_degree(y) ? -1 : 1;
+  return x < y ? -1 : x > y;
+}
+
+/*
+ * Append all nodes reachable from start (among those marked with the given generation) to the order in breadth-first order.
+ * With by_degree, the neighbors of each node are visited by ascending degree (as in Cuthill-McKee), otherwise by ID.
+ */
+int order_breadth_first(int *order, int size, int start, int generation, bool by_degree)
+{
+  int *neighbors, neighbors_size, head = size, i;
+
+  order_visited[start] = -generation;
+  order[size++] = start;
+  while (head < size) {
+    neighbors = graph_neighbors(order[head++], &neighbors_size);
+    if (by_degree)
+      qsort(neighbors, neighbors_size, sizeof(int), compare_graph_degrees);
+    for (i = 0; i < neighbors_size; i++)
+      if (order_visited[neighbors[i]] == generation) {
+        order_visited[neighbors[i]] = -generation;
+        order[size++] = neighbors[i];
+      }
+  }
+  return size;
+}
+
+/* Order the nodes breadth-first, visiting each connected component from its first node (or its node with minimum degree) */
+void order_graph_breadth_first(int *order, bool by_degree)
+{
+  int *starts = malloc((graph_symbols_size + 1) * sizeof(int)), size = 0, i;
+
+  order_generation++;
+  for (i = 0; i < graph_symbols_size; i++) {
+    order_visited[i] = order_generation;
+    starts[i] = i;
+  }
+  if (by_degree)
+    qsort(starts, graph_symbols_size, sizeof(int), compare_graph_degrees);
+  for (i = 0; i < graph_symbols_size; i++)
+    if (order_visited[starts[i]] == order_generation)
+      size = order_breadth_first(order, size, starts[i], order_generation, by_degree);
+  free(starts);
+}
+
+/*
+ * Order the nodes in order[lo..hi) by recursive bisection: a breadth-first search from a peripheral node splits the part
+ * into halves along its level structure, then nodes with more neighbors in the other half than in their own change sides,
+ * as long as both halves keep at least 45% of the nodes.
+ */
+void order_graph_mincut(int *order, int *scratch, bool *side, int lo, int hi)
+{
+  int *neighbors, neighbors_size, size = hi - lo, left_size, gain, i, j, k;
+
+  if (size <= 2)
+    return;
+  // mark the part, then search twice, as the last node of the first search is far from its start
+  order_generation++;
+  for (i = lo; i < hi; i++)
+    order_visited[order[i]] = order_generation;
+  k = lo;
+  for (i = lo; i < hi; i++)
+    if (order_visited[order[i]] == order_generation)
+      k = order_breadth_first(scratch, k, order[i], order_generation, false);
+  order_generation++;
+  for (i = lo; i < hi; i++)
+    order_visited[order[i]] = order_generation;
+  k = lo;
+  for (i = hi - 1; i >= lo; i--)
+    if (order_visited[scratch[i]] == order_generation)
+      k = order_breadth_first(order, k, scratch[i], order_generation, false);
+
+  left_size = size / 2;
+  for (i = lo; i < hi; i++)
+    side[order[i]] = i - lo >= left_size;
+  for (i = lo; i < hi; i++) {
+    gain = 0;
+    neighbors = graph_neighbors(order[i], &neighbors_size);
+    for (j = 0; j < neighbors_size; j++)
+      if (order_visited[neighbors[j]] == -order_generation)
+        gain += side[neighbors[j]] != side[order[i]] ? 1 : -1;
+    if (gain <= 0)
+      continue;
+    k = left_size + (side[order[i]] ? 1 : -1);
+    if (20 * k >= 9 * size && 20 * (size - k) >= 9 * size) {
+      side[order[i]] = !side[order[i]];
+      left_size = k;
+    }
+  }
+
+  // move the left half to the front, keeping the breadth-first order within both halves
+  k = lo;
+  for (i = lo; i < hi; i++)
+    if (!side[order[i]])
+      scratch[k++] = order[i];
+  for (i = lo; i < hi; i++)
+    if (side[order[i]])
+      scratch[k++] = order[i];
+  memcpy(order + lo, scratch + lo, size * sizeof(int));
+  order_graph_mincut(order, scratch, side, lo, lo + left_size);
+  order_graph_mincut(order, scratch, side, lo + left_size, hi);
+}
+
+/* Register the feature variables in the requested order (build_constraints then adds all remaining ones in output order) */
+void order_feature_variables(void)
+{
+  int *order, *scratch, i;
+  bool *side;
+
+  build_graph();
+  order = malloc((graph_symbols_size + 1) * sizeof(int));
+  order_visited = calloc(graph_symbols_size + 1, sizeof(int));
+  if (!strcmp(variable_order, "menu"))
+    for (i = 0; i < graph_symbols_size; i++)
+      order[i] = i;
+  else if (!strcmp(variable_order, "bfs"))
+    order_graph_breadth_first(order, false);
+  else if (!strcmp(variable_order, "rcm")) {
+    order_graph_breadth_first(order, true);
+    for (i = 0; i < graph_symbols_size / 2; i++) {
+      int node = order[i];
+      order[i] = order[graph_symbols_size - 1 - i];
+      order[graph_symbols_size - 1 - i] = node;
+    }
+  } else {
+    scratch = malloc((graph_symbols_size + 1) * sizeof(int));
+    side = calloc(graph_symbols_size + 1, sizeof(bool));
+    for (i = 0; i < graph_symbols_size; i++)
+      order[i] = i;
+    order_graph_mincut(order, scratch, side, 0, graph_symbols_size);
+    free(scratch);
+    free(side);
+  }
+  for (i = 0; i < graph_symbols_size; i++)
+    add_feature_variable(graph_symbols[order[i]]);
+  free(order);
+  free(order_visited);
+}
+
+/*
+ * Query server (--serve).
+ * Parses the Kconfig files once and then answers requests, one per line, until the input ends or "quit" is received.
+ * Each response consists of zero or more lines and is terminated by a line with a single dot.
+ * Requests are read from stdin (and answered on the output) or, with --serve=SOCKET, from each client of a Unix socket in turn.
+ */
+void serve_symbols(struct output *out, int list)
+{
+  struct symbol *sym;
+  int i;
+
+  _for_output_symbols(sym) {
+    if (!sym->name || strlen(sym->name) == 0)
+      continue;
+    if (list == A_CONFIGS || (list == A_DEFAULTS && is_default(sym)) || (list == A_KCONFIGS && is_symbol(sym)))
+      out_line(out, sym->name);
+  }
+}
+
+void serve_extract(struct output *out, const char *name)
+{
+  int id = find_dep_symbol(name);
+
+  if (id == -1) {
+    out_str(out, "error: unknown symbol ");
+    out_line(out, name);
+    return;
+  }
+  extract_symbol(out, dep_symbols[id]);
+  extract_dependencies(out, dep_symbols[id]);
+}
+
+void serve_default(struct output *out, const char *name)
+{
+  int id = find_dep_symbol(name);
+
+  if (id == -1) {
+    out_str(out, "error: unknown symbol ");
+    out_line(out, name);
+    return;
+  }
+  out_line(out, is_default(dep_symbols[id]) ? "y" : "n");
+}
+
+void serve_deps(struct output *out, const char *name, bool transitive)
+{
+  if (find_dep_symbol(name) == -1) {
+    out_str(out, "error: unknown symbol ");
+    out_line(out, name);
+    return;
+  }
+  transitive_deps = transitive;
+  print_deps_of(out, name);
+}
+
+/* Answer a single request, returning false if the client asked to quit */
+bool serve_request(struct output *out, char *request)
+{
+  char *argument = strchr(request, ' ');
+
+  if (argument) {
+    *argument++ = '\0';
+    while (*argument == ' ')
+      argument++;
+  }
+  if (!strcmp(request, "quit"))
+    return false;
+  if (!strcmp(request, "configs"))
+    serve_symbols(out, A_CONFIGS);
+  else if (!strcmp(request, "kconfigs"))
+    serve_symbols(out, A_KCONFIGS);
+  else if (!strcmp(request, "defaults"))
+    serve_symbols(out, A_DEFAULTS);
+  else if (!strcmp(request, "menusyms"))
+    print_menusyms(out, rootmenu.list);
+  else if (!strcmp(request, "default") && argument && *argument)
+    serve_default(out, argument);
+  else if (!strcmp(request, "extract") && argument && *argument)
+    serve_extract(out, argument);
+  else if (!strcmp(request, "deps") && argument && *argument)
+    serve_deps(out, argument, false);
+  else if (!strcmp(request, "deps*") && argument && *argument)
+    serve_deps(out, argument, true);
+  else if (*request) {
+    out_str(out, "error: unknown request ");
+    out_line(out, request);
+  }
+  out_str(out, ".\n");
+  output_flush(out);
+  return true;
+}
+
+/* Answer requests from an input stream, returning false if the client asked to quit */
+bool serve_stream(FILE *in, struct output *out)
+{
+  char *line = NULL;
+  size_t len = 0;
+  ssize_t read;
+  bool more = true;
+
+  while (more && (read = getline(&line, &len, in)) != -1) {
+    while (read > 0 && (line[read - 1] == '\n' || line[read - 1] == '\r'))
+      line[--read] = '\0';
+    more = serve_request(out, line);
+  }
+  free(line);
+  return more;
+}
+
+void serve_socket(const char *path)
+{
+  struct sockaddr_un address;
+  int server, client;
+  FILE *in;
+  struct output out = { NULL };
+  bool more = true;
+
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "socket path too long: %s\n", path);
+    exit(1);
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+  unlink(path);
+  if ((server = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+      bind(server, (struct sockaddr *) &address, sizeof(address)) < 0 ||
+      listen(server, 16) < 0) {
+    perror("socket");
+    exit(1);
+  }
+  signal(SIGPIPE, SIG_IGN); // clients may hang up at any time
+  if (verbose)
+    printf("serving on %s\n", path);
+  while (more) {
+    if ((client = accept(server, NULL, NULL)) < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("accept");
+      exit(1);
+    }
+    in = fdopen(client, "r");
+    out.fp = fdopen(dup(client), "w");
+    more = serve_stream(in, &out);
+    output_flush(&out);
+    fclose(out.fp);
+    fclose(in);
+  }
+  free(out.data);
+  close(server);
+  unlink(path);
+}
+
+void serve(struct output *out, const char *path)
+{
+  build_dep_index();
+  if (path)
+    serve_socket(path);
+  else
+    serve_stream(stdin, out);
+}
+
+/*
+ * Compressed output files (--compress).
+ * Output files ending in .gz or .zst (or all output files with --compress) are piped through gzip or zstd,
+ * so they are never written to disk uncompressed. We run the compressor as a separate process,
+ * as the binding is built by each system's own makefiles, which do not link against zlib or libzstd.
+ */
+static char *compression = NULL;
+
+static const char *output_compressor(const char *path)
+{
+  size_t size = strlen(path);
+
+  if (compression)
+    return compression;
+  if (size > strlen(".gz") && !strcmp(path + size - strlen(".gz"), ".gz"))
+    return "gzip";
+  if (size > strlen(".zst") && !strcmp(path + size - strlen(".zst"), ".zst"))
+    return "zstd";
+  return NULL;
+}
+
+/* Open an output file, compressing it if requested */
+bool open_output_file(struct output *out, const char *path)
+{
+  const char *compressor = output_compressor(path);
+  int fd, pipe_fds[2];
+
+  out->compressor = 0;
+  if (!compressor)
+    return (out->fp = fopen(path, "w")) != NULL;
+  if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+    return false;
+  if (pipe(pipe_fds) < 0) {
+    close(fd);
+    return false;
+  }
+  // compressors started later must not inherit our end of this pipe, or this compressor would never see its end
+  fcntl(pipe_fds[1], F_SETFD, FD_CLOEXEC);
+  fflush(NULL);
+  if ((out->compressor = fork()) < 0)
+    return false;
+  if (out->compressor == 0) {
+    dup2(pipe_fds[0], STDIN_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    close(fd);
+    execlp(compressor, compressor, "-q", "-c", (char *) NULL);
+    perror(compressor);
+    _exit(127);
+  }
+  close(pipe_fds[0]);
+  close(fd);
+  return (out->fp = fdopen(pipe_fds[1], "w")) != NULL;
+}
+
+/* Close an output file and wait for its compressor, if any */
+void close_output_file(struct output *out)
+{
+  int status;
+
+  fclose(out->fp);
+  if (out->compressor > 0) {
+    if (waitpid(out->compressor, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "compressing output failed\n");
+      exit(1);
+    }
+  }
+}
+
+/* Open the output file of each requested action, sharing outputs between actions with the same file */
+void open_action_outputs(char *default_output)
+{
+  int a, b;
+
+  stdout_output.fp = stdout;
+  for (a = 0; a < A_COUNT; a++) {
+    if (!action_enabled[a])
+      continue;
+    if (!action_output[a])
+      action_output[a] = default_output;
+    if (!action_output[a] || !strcmp(action_output[a], "-")) {
+      action_out[a] = &stdout_output;
+      continue;
+    }
+    for (b = 0; b < a; b++)
+      if (action_out[b] && action_output[b] && !strcmp(action_output[a], action_output[b]))
+        action_out[a] = action_out[b];
+    if (!action_out[a]) {
+      action_out[a] = calloc(1, sizeof(struct output));
+      if (!open_output_file(action_out[a], action_output[a])) {
+        fprintf(stderr, "can't open %s for writing\n", action_output[a]);
+        exit(1);
+      }
+    }
+  }
+}
+
+/* Flush and close all output files, each shared output only once */
+void close_action_outputs(void)
+{
+  int a, b;
+  struct output *out;
+
+  for (a = 0; a < A_COUNT; a++) {
+    if (!(out = action_out[a]))
+      continue;
+    for (b = a; b < A_COUNT; b++)
+      if (action_out[b] == out)
+        action_out[b] = NULL;
+    output_flush(out);
+    fflush(out->fp);
+    output_bytes += out->bytes;
+    if (out == &stdout_output)
+      continue;
+    close_output_file(out);
+    free(out->data);
+    free(out);
+  }
+}
+
+void print_usage(void)
+{
+  printf("USAGE\n");
+  printf("%s [options] --ACTION[=FILE]... Kconfig\n", progname);
+  printf("\n");
   printf("OPTIONS\n");
-  printf("-f, --forceoff var\tturn off var (only for --every* actions)\n");
+  printf("-f, --forceoff var\tturn off var (for --every* actions and --propagate-forceoff)\n");
   printf("-a, --forceoffall file\tturn off all vars in file\n");
+  printf("--propagate-forceoff\ttreat forced-off vars as constant n and simplify all emitted expressions\n");
+  printf("--simplify\t\tfold constants, flatten conjunctions and disjunctions, and remove duplicate and absorbed operands\n");
   printf("-p, --no-prefix\t\tdon't add the CONFIG_ prefix to vars\n");
   printf("-P, --set-prefix PREFIX\tuse a custom prefix instead of the CONFIG_ prefix for var names\n");
+  printf("--model-prefix PREFIX\tuse PREFIX (which may be empty) instead for var names in --model output only\n");
   printf("-D, --direct-dependencies-only\tno reverse dependencies in extract output\n");
-  printf("-o, --output\t\tfile to write extract to.  otherwise stdout.\n");
+  printf("--shared-expressions\tprint repeated subexpressions once as E@<id> definitions in extract output\n");
+  printf("--canonical\tsort symbols, selects, and choice members by name, so semantically identical inputs yield identical outputs\n");
+  printf("--stdio\t\twrite output through stdio instead of the buffered output layer (for comparison)\n");
+  printf("--transitive\tprint transitive instead of direct dependencies in --deps output\n");
+  printf("--slice VARS\trestrict all symbol outputs to the transitive dependency cone of the comma-separated VARS\n"
+         "\t\t(or of the vars listed in @FILE)\n");
+  printf("--variable-order output|menu|bfs|rcm|mincut\n"
+         "\t\tnumber the features in --dimacs and --model in output order (default), menu-tree order,\n"
+         "\t\tor along the dependency graph (breadth-first, reverse Cuthill-McKee, or recursive min-cut bisection)\n");
+  printf("--choice-encoding pairwise|sequential|commander|product\n"
+         "\t\tencode that at most one member of a choice with at least %d members is selected in --dimacs and --model\n"
+         "\t\tpairwise (default) or with auxiliary variables k!<index> (sequential counter, commander, or product encoding)\n",
+         CHOICE_ENCODING_MIN_SIZE);
+  printf("-o, --output\t\tfile to write actions without =FILE to.  otherwise stdout.\n");
+  printf("--stats FILE\twrite symbol, property, and expression counts, output bytes, phase times, and peak RSS\n"
+         "\t\tas CSV (or as JSON if FILE ends in .json)\n");
+  printf("--compress gzip|zstd\tcompress all output files (otherwise, only those ending in .gz or .zst are compressed).\n"
+         "\t\tsnapshots should stay uncompressed, as they are read with mmap\n");
   printf("-v, --verbose\t\tverbose output\n");
   printf("-h, --help\t\tdisplay this help message\n");
   printf("\n");
@@ -639,16 +5040,35 @@ void print_usage(void)
   printf("--defaults\tprint all configuration variables that are defaults\n");
   printf("--extract\t"
          "extract constraints in kclause format\n");
-  printf("--deps VAR\tprint direct and reverse dependencies for VAR\n");
+  printf("--deps VAR\tprint what VAR depends on (including the conditions of selects), what selects it, what requires it,\n"
+         "\t\tand what it selects.\n"
+         "\t\tVAR can also be @FILE to answer the query for each var listed in FILE\n");
   printf("--dump\t\tdump configuration variables\n");
+  printf("--dimacs\tTseitin-transform constraints into DIMACS (Boolean semantics)\n");
+  printf("--model\t\tprint constraints in KConfigReader's .model format (Boolean semantics)\n");
+  printf("--symbol-table\tprint a dense, stable ID (in menu-tree order) and the name of each symbol\n");
+  printf("--snapshot\twrite a binary, mmap-able snapshot of all symbols, properties, menus, and expressions\n"
+         "\t\t(see kextractor-snapshot.h and snapshot2text)\n");
+  printf("--manifest\tprint the git blob ID of each parsed Kconfig file and the value of each environment variable read\n");
+  printf("--free-variables\tprint all referenced config vars without constraints of their own (e.g., undeclared ones)\n");
+  printf("--graph\t\tprint the symbol dependency graph with its strongly connected components in topological order\n");
+  printf("--graph-binary\twrite the symbol dependency graph as binary CSR arrays (see --graph)\n");
+  printf("--serve[=SOCKET]\tparse once, then answer requests line by line on stdin (or a Unix socket):\n"
+         "\t\tconfigs, kconfigs, defaults, menusyms, default VAR, extract VAR, deps VAR, deps* VAR, quit.\n"
+         "\t\teach response is terminated by a line with a single dot\n");
+  printf("\n");
+  printf("Several actions can be combined to parse the Kconfig files only once,\n");
+  printf("e.g., --extract=model.kextractor --configs=model.features Kconfig\n");
   printf("\n");
   exit(0);
 }
 
+
 int main(int argc, char **argv)
 {
   int opt;
   char *kconfig;
+  char *output = NULL;
   struct symbol *sym;
   int i;
 
@@ -662,25 +5082,43 @@ int main(int argc, char **argv)
 	/* bindtextdomain(PACKAGE, LOCALEDIR); */
 	/* textdomain(PACKAGE); */
 
-  FILE *output_fp = stdout;
-  bool output_file_arg = false;
-  
   opterr = 0;
   while (1) {
     static struct option long_options[] = {
-      {"configs", no_argument, &action, A_CONFIGS},
-      {"kconfigs", no_argument, &action, A_KCONFIGS},
-      {"menusyms", no_argument, &action, A_MENUSYMS},
-      {"defaults", no_argument, &action, A_DEFAULTS},
+      {"configs", optional_argument, &action, A_CONFIGS},
+      {"kconfigs", optional_argument, &action, A_KCONFIGS},
+      {"menusyms", optional_argument, &action, A_MENUSYMS},
+      {"defaults", optional_argument, &action, A_DEFAULTS},
       {"forceoff", required_argument, 0, 'f'},
       {"forceoffall", required_argument, 0, 'a'},
-      {"extract", no_argument, &action, A_EXTRACT},
+      {"extract", optional_argument, &action, A_EXTRACT},
       {"deps", required_argument, &action ,A_DEPS},
-      {"dump", no_argument, &action ,A_DUMP},
+      {"dump", optional_argument, &action ,A_DUMP},
+      {"dimacs", optional_argument, &action ,A_DIMACS},
+      {"model", optional_argument, &action ,A_MODEL},
+      {"serve", optional_argument, &action ,A_SERVE},
+      {"symbol-table", optional_argument, &action ,A_SYMBOL_TABLE},
+      {"snapshot", optional_argument, &action ,A_SNAPSHOT},
+      {"manifest", optional_argument, &action ,A_MANIFEST},
+      {"free-variables", optional_argument, &action ,A_FREE_VARIABLES},
+      {"graph", optional_argument, &action ,A_GRAPH},
+      {"graph-binary", optional_argument, &action ,A_GRAPH_BINARY},
       {"Configure", no_argument, 0, 'C'},
       {"no-prefix", no_argument, 0, 'p'},
       {"set-prefix", required_argument, 0, 'P'},
+      {"model-prefix", required_argument, 0, 'M'},
       {"direct-dependencies-only", no_argument, 0, 'D'},
+      {"shared-expressions", no_argument, 0, 'S'},
+      {"stdio", no_argument, 0, 'I'},
+      {"compress", required_argument, 0, 'z'},
+      {"canonical", no_argument, 0, 'c'},
+      {"stats", required_argument, 0, 's'},
+      {"slice", required_argument, 0, 'l'},
+      {"variable-order", required_argument, 0, 'V'},
+      {"choice-encoding", required_argument, 0, 'X'},
+      {"transitive", no_argument, 0, 'T'},
+      {"propagate-forceoff", no_argument, 0, 'F'},
+      {"simplify", no_argument, 0, 'Z'},
       {"output", required_argument, 0, 'o'},
       {"verbose", no_argument, 0, 'v'},
       {"help", no_argument, 0, 'h'},
@@ -702,7 +5140,13 @@ int main(int argc, char **argv)
 
     switch (opt) {
     case 0:
-      action_arg = optarg;
+      action_enabled[action] = true;
+      if (A_DEPS == action)
+        action_arg = optarg;
+      else if (A_SERVE == action)
+        serve_path = optarg;
+      else
+        action_output[action] = optarg;
       break;
     case 'f':
       forceoff = optarg;
@@ -747,15 +5191,61 @@ int main(int argc, char **argv)
     case 'P':
       config_prefix = optarg;
       break;
+    case 'M':
+      model_prefix = optarg;
+      break;
     case 'D':
       enable_reverse_dependencies = false;
       break;
-    case 'o':
-      if ((output_fp = fopen(optarg, "w")) == NULL) {
-        fprintf(stderr, "can't open %s for writing\n", optarg);
+    case 'S':
+      shared_expressions = true;
+      break;
+    case 'I':
+      stdio_output = true;
+      break;
+    case 'c':
+      canonical_output = true;
+      break;
+    case 's':
+      stats_file = optarg;
+      break;
+    case 'l':
+      slice_seeds = optarg;
+      break;
+    case 'V':
+      if (strcmp(optarg, "output") && strcmp(optarg, "menu") && strcmp(optarg, "bfs") && strcmp(optarg, "rcm") &&
+          strcmp(optarg, "mincut")) {
+        fprintf(stderr, "Unknown variable order %s.  For help use -h\n", optarg);
+        exit(1);
+      }
+      variable_order = strcmp(optarg, "output") ? optarg : NULL;
+      break;
+    case 'X':
+      if (strcmp(optarg, "pairwise") && strcmp(optarg, "sequential") && strcmp(optarg, "commander") &&
+          strcmp(optarg, "product")) {
+        fprintf(stderr, "Unknown choice encoding %s.  For help use -h\n", optarg);
+        exit(1);
+      }
+      choice_encoding = strcmp(optarg, "pairwise") ? optarg : NULL;
+      break;
+    case 'z':
+      if (strcmp(optarg, "gzip") && strcmp(optarg, "zstd")) {
+        fprintf(stderr, "Unknown compression %s.  For help use -h\n", optarg);
         exit(1);
       }
-      output_file_arg = true;
+      compression = optarg;
+      break;
+    case 'T':
+      transitive_deps = true;
+      break;
+    case 'F':
+      propagate_forceoff_symbols = true;
+      break;
+    case 'Z':
+      simplify_expressions_enabled = true;
+      break;
+    case 'o':
+      output = optarg;
       break;
     case 'v':
       verbose = true;
@@ -781,323 +5271,119 @@ int main(int argc, char **argv)
   else
     kconfig = "Kconfig";
 
-  conf_parse(kconfig);
-
-  switch (action) {
-  case A_DEFAULTS:
-  _for_all_symbols(sym) {
-      static bool def;
-
-      if (!sym->name || strlen(sym->name) == 0)
-        continue;
-
-      def = is_default(sym);
-      if (def)
-        printf("%s\n", sym->name);
-    }
-    break;
-  case A_CONFIGS:
-    _for_all_symbols(sym) {
-      if (!sym->name || strlen(sym->name) == 0)
-        continue;
-
-      printf("%s\n", sym->name);
-    }
-    break;
-  case A_KCONFIGS:
-    _for_all_symbols(sym) {
-      if (!sym->name || strlen(sym->name) == 0)
-        continue;
-
-      if (is_symbol(sym))
-        printf("%s\n", sym->name);
-    }
-    break;
-  case A_MENUSYMS:
-    print_menusyms(rootmenu.list);
-    break;
-  case A_EXTRACT:
-    _for_all_symbols(sym) {
-      if (!sym->name || strlen(sym->name) == 0)
-        continue;
-
-      struct property *prop;
-      char *typename;
-      int is_string;
-      int is_bool;
-
-      switch (sym->type) {
-      case S_BOOLEAN:
-        // fall through
-      case S_TRISTATE:
-
-        switch (sym->type) {
-        case S_BOOLEAN:
-          is_bool = true;
-          break;
-        case S_TRISTATE:
-          is_bool = false;
-          break;
-        default:
-          is_bool = true;
-          // should not reach here
-          break;
-        }
-
-        typename = is_bool ? "bool" : "tristate";
-        fprintf(output_fp, "config %s%s %s\n", config_prefix, sym->name, typename);
-        // print prompt conditions, if any
-        prop = NULL;
-        for_all_prompts(sym, prop) {
-          if ((NULL != prop)) {
-            fprintf(output_fp, "prompt %s%s", config_prefix, sym->name);
-            fprintf(output_fp, " (");
-            if (NULL != prop->visible.expr) {
-              print_python_expr(prop->visible.expr, output_fp, E_NONE);
-            } else {
-              fprintf(output_fp, "1");
-            }
-            fprintf(output_fp, ")");
-            fprintf(output_fp, "\n");
-          }
-        }
-        // print default values
-        prop = NULL;
-        for_all_defaults(sym, prop) {
-          if ((NULL != prop) && (NULL != (prop->expr))) {
-            fprintf(output_fp, "def_bool %s%s ", config_prefix, sym->name);
-            print_python_expr(prop->expr, output_fp, E_NONE);
-            fprintf(output_fp, "|(");
-            if (NULL != prop->visible.expr) {
-              print_python_expr(prop->visible.expr, output_fp, E_NONE);
-            } else {
-              fprintf(output_fp, "1");
-            }
-            fprintf(output_fp, ")");
-            fprintf(output_fp, "\n");
-          }
-        }
-        break;
-      case S_INT:
-        // fall through
-      case S_HEX:
-        // fall through
-      case S_STRING:
-
-        switch (sym->type) {
-        case S_INT:
-          is_string = false;
-          break;
-        case S_HEX:
-          is_string = false;
-          break;
-        case S_STRING:
-          is_string = true;
-          break;
-        default:
-          is_string = true;
-          // should not reach here
-          break;
-        }
-
-        typename = is_string ? "string" : "number";
-        
-        fprintf(output_fp, "config %s%s %s\n", config_prefix, sym->name, typename);
-        // print prompt conditions, if any
-        prop = NULL;
-        for_all_prompts(sym, prop) {
-          if ((NULL != prop)) {
-            fprintf(output_fp, "prompt %s%s", config_prefix, sym->name);
-            fprintf(output_fp, " (");
-            if (NULL != prop->visible.expr) {
-              print_python_expr(prop->visible.expr, output_fp, E_NONE);
-            } else {
-              fprintf(output_fp, "1");
-            }
-            fprintf(output_fp, ")");
-            fprintf(output_fp, "\n");
-          }
-        }
-        // print default values
-        prop = NULL;
-        for_all_defaults(sym, prop) {
-          if ((NULL != prop) && (NULL != (prop->expr))) {
-            fprintf(output_fp, "def_nonbool %s%s ", config_prefix, sym->name);
-            /* if (is_string) fprintf(output_fp, "\""); */
-            print_python_expr(prop->expr, output_fp, E_NONE);
-            /* if (is_string) fprintf(output_fp, "\""); */
-            fprintf(output_fp, "|(");
-            if (NULL != prop->visible.expr) {
-              print_python_expr(prop->visible.expr, output_fp, E_NONE);
-            } else {
-              fprintf(output_fp, "1");
-            }
-            fprintf(output_fp, ")");
-            fprintf(output_fp, "\n");
-          }
-        }
-        break;
-      case S_UNKNOWN:
-        // fall through
-      default:
-        // can't deal with this
-        break;
-      }
-    }
+  PHASE_BEGIN(PHASE_KEXTRACTOR);
+  open_action_outputs(output);
 
-    // print all dependent config vars
-    _for_all_symbols(sym) {
-      if (sym_is_choice(sym)) {
-        struct property *prop;
-        struct choice_type *choice;
-        struct symbol *def_sym;
-        struct expr *e;
+  gettimeofday(&phase_start, NULL);
+  PHASE_BEGIN(PHASE_PARSE);
+  conf_parse(kconfig);
+  PHASE_END(PHASE_PARSE);
+  add_phase_stat("parse_time");
+  PHASE_BEGIN(PHASE_PREPARE);
+  load_forceoff();
+  if (propagate_forceoff_symbols || simplify_expressions_enabled)
+    simplify_symbols();
+  number_symbols();
+  PHASE_END(PHASE_PREPARE);
+  add_phase_stat("prepare_time");
+  PHASE_BEGIN(PHASE_EMIT);
 
-        choice = choice_function(sym);
-	
-	// print choice type, depending on config type and optional statement
-	switch(sym->type) {
-          case S_BOOLEAN:
-            sym_is_optional(sym) ? fprintf(output_fp, "bool_opt_choice") : fprintf(output_fp, "bool_choice");
-            break;
-          case S_TRISTATE:
-            sym_is_optional(sym) ? fprintf(output_fp, "tristate_opt_choice") : fprintf(output_fp, "tristate_choice");
-            break;
-          default:
-            fprintf(stderr, "fatal: choice type can only be bool or tristate, otherwise is impossible due to the parser.\n");
-            exit(1);
-        }
-        
-        choice_loop
-          if (def_sym) {
-            fprintf(output_fp, " %s%s", config_prefix, def_sym->name);  // any dependencies should be handled below with 'dep'
-          }
-        }
-        fprintf(output_fp, "|(");
+  // the extract output lists all choices and dependencies after all configuration variables
+  // so we collect them separately, which allows us to serve all actions in a single walk over the symbols
+  struct output extract_dependencies_out = { NULL };
 
-	// Both depends on and visibility shoul be satisfied for 
-	// the choice to be selectable.
-	// Kconfig conjuncts depends on constraint to the 
-	// visibility constraint, so that for choice, looking at
-	// only the visibility is sufficient.
-	// rev_dep of choice copies the visibility to prevent
-	// non-optional choices have no selection (menu.c, l854) 
-	// Thus, rev_dep is the same as visibiltiy except conjoing
-	// 'm' which is currently not needed for kclause.
-	// In sum, only visibility is needed as the condition of
-	// choice.
+  if (action_enabled[A_EXTRACT] && shared_expressions) {
+    _for_output_symbols(sym)
+      share_symbol_expressions(sym);
+    print_shared_definitions(action_out[A_EXTRACT]);
+  }
 
-        // for formatting
-        int printed_expr = 0;
-	prop = NULL;
-        for_all_prompts(sym, prop) {
-          if ((NULL != prop)) {
+  _for_output_symbols(sym) {
+    if (action_enabled[A_EXTRACT])
+      extract_dependencies(&extract_dependencies_out, sym);
 
-	    if (printed_expr) {
-	      fprintf(stderr, "warning: encountered multiple prompts, ignoring.");
-	      break;
-	      // commented code below can handle the case where multiple
-	      // prompts are defined, where satisfying any of them makes
-	      // the config option visible. However, multiple prompts 
-	      // raises a warning by Kconfig and we consider it as an 
-	      // invalid use of Kconfig language. Thus, this code is 
-              // commented for now. Note that, using this code here
-              // means the code for prompt keyword should also reflect
-              // this case.
-	      //fprintf(output_fp, " or ");
-	    }
-	    
-	    printed_expr = 1;
-	    fprintf(output_fp, "(");
-            if (NULL != prop->visible.expr) {
-              print_python_expr(prop->visible.expr, output_fp, E_NONE);
-            } else {
-              fprintf(output_fp, "1");
-            }
-            fprintf(output_fp, ")");
-          }
-        }
+    if (!sym->name || strlen(sym->name) == 0)
+      continue;
 
-        if (!printed_expr)
-          fprintf(output_fp, "1");
-        
-        fprintf(output_fp, ")\n");
-      }
-      
-      if (!sym->name || strlen(sym->name) == 0)
-        continue;
+    PHASE_BEGIN(PHASE_SYMBOLS);
+    if (action_enabled[A_DEFAULTS] && is_default(sym))
+      out_line(action_out[A_DEFAULTS], sym->name);
+    if (action_enabled[A_CONFIGS])
+      out_line(action_out[A_CONFIGS], sym->name);
+    if (action_enabled[A_KCONFIGS] && is_symbol(sym))
+      out_line(action_out[A_KCONFIGS], sym->name);
+    if (action_enabled[A_EXTRACT])
+      extract_symbol(action_out[A_EXTRACT], sym);
+    PHASE_END(PHASE_SYMBOLS);
+  }
 
-      if (sym->type == S_TRISTATE ||
-          sym->type == S_BOOLEAN ||
-          sym->type == S_INT ||
-          sym->type == S_HEX ||
-          sym->type == S_STRING) {
-        bool no_dependencies = true;
-#if HAS_dir_dep
-        if (sym->dir_dep.expr) {
-          no_dependencies = false;
-          fprintf(output_fp, "dep %s%s (", config_prefix, sym->name);
-          print_python_expr(sym->dir_dep.expr, output_fp, E_NONE);
-          fprintf(output_fp, ")\n");
-        }
-#endif
+  if (action_enabled[A_EXTRACT])
+    output_append(action_out[A_EXTRACT], &extract_dependencies_out);
+  if (action_enabled[A_MENUSYMS])
+    print_menusyms(action_out[A_MENUSYMS], rootmenu.list);
+  if (action_enabled[A_DUMP])
+  {
+    output_flush(action_out[A_DUMP]); // zconfdump writes to the stream directly
+    zconfdump(action_out[A_DUMP]->fp);
+  }
+  if (action_enabled[A_DIMACS]) {
+    PHASE_BEGIN(PHASE_DIMACS);
+    print_dimacs(action_out[A_DIMACS]);
+    PHASE_END(PHASE_DIMACS);
+  }
+  if (action_enabled[A_MODEL]) {
+    PHASE_BEGIN(PHASE_MODEL);
+    print_model(action_out[A_MODEL]);
+    PHASE_END(PHASE_MODEL);
+  }
+  if (action_enabled[A_SYMBOL_TABLE])
+    print_symbol_table(action_out[A_SYMBOL_TABLE]);
+  if (action_enabled[A_SNAPSHOT]) {
+    PHASE_BEGIN(PHASE_SNAPSHOT);
+    print_snapshot(action_out[A_SNAPSHOT]);
+    PHASE_END(PHASE_SNAPSHOT);
+  }
+  if (action_enabled[A_MANIFEST])
+    print_manifest(action_out[A_MANIFEST]);
+  if (action_enabled[A_FREE_VARIABLES])
+    print_free_variables(action_out[A_FREE_VARIABLES]);
+  if (action_enabled[A_GRAPH] || action_enabled[A_GRAPH_BINARY]) {
+    PHASE_BEGIN(PHASE_GRAPH);
+    if (action_enabled[A_GRAPH])
+      print_graph(action_out[A_GRAPH]);
+    if (action_enabled[A_GRAPH_BINARY])
+      print_graph_binary(action_out[A_GRAPH_BINARY]);
+    PHASE_END(PHASE_GRAPH);
+  }
+  if (action_enabled[A_DEPS])
+    print_deps(action_out[A_DEPS], action_arg);
+  if (action_enabled[A_SERVE]) {
+    output_flush(action_out[A_SERVE]); // answers must not be held back by earlier actions
+    serve(action_out[A_SERVE], serve_path);
+  }
 
-        if (enable_reverse_dependencies) {
-          // print all the variables selected by this variable
-          struct property *prop;
-          for_all_properties(sym, prop, P_SELECT) {
-            // the current var itself is the var doing the select
-            // prop->expr is the variable being selected
-            // prop->visible.expr is And(sym->dir_dept, select_dep) where select_dep
-            // is the dependency for select defined as "select 'selected' if 'select_dep'"
-            fprintf(output_fp, "select ");
-            // note: this assumes that prop->expr is only a single
-            // variable name, which zconf.y guarantees
-            print_python_expr(prop->expr, output_fp, E_NONE);
-            fprintf(output_fp, " %s%s (", config_prefix, sym->name);
-            if (NULL != prop->visible.expr) {
-              print_python_expr(prop->visible.expr, output_fp, E_NONE);
-            } else {
-              fprintf(output_fp, "1");
-            }
-            fprintf(output_fp, ")\n");
-          }
+  PHASE_END(PHASE_EMIT);
+  PHASE_BEGIN(PHASE_FLUSH);
+  close_action_outputs();
+  PHASE_END(PHASE_FLUSH);
+  add_phase_stat("emit_time");
 
-          // print the reverse dependency for this variable
-          if (sym->rev_dep.expr) {
-            no_dependencies = false;
-            fprintf(output_fp, "rev_dep %s%s (", config_prefix, sym->name);
-            print_python_expr(sym->rev_dep.expr, output_fp, E_NONE);
-            fprintf(output_fp, ")\n");
-          }
-        }
+  if (stats_file) {
+    struct output stats_out = { NULL };
 
-        // nonbools without dependencies should depend on true
-        if (sym->type == S_INT ||
-            sym->type == S_HEX ||
-            sym->type == S_STRING) {
-          if (no_dependencies) {
-            fprintf(output_fp, "dep %s%s (1)\n", config_prefix, sym->name);
-          }
-        }
-      } else {
-        /* ffprintf(output_fp, stderr, "skipping %s\n", sym->name); */
-      }
+    if (!open_output_file(&stats_out, stats_file)) {
+      fprintf(stderr, "can't open %s for writing\n", stats_file);
+      exit(1);
     }
-    break;
-  case A_DUMP:
-    zconfdump(stdout);
-    break;
-  default:
-    fprintf(stderr, "fatal error: unsupported action\n");
-    exit(1);
-    break;
+    collect_stats();
+    print_stats(&stats_out, strlen(stats_file) > strlen(".json") &&
+                !strcmp(stats_file + strlen(stats_file) - strlen(".json"), ".json"));
+    output_flush(&stats_out);
+    close_output_file(&stats_out);
+    free(stats_out.data);
   }
 
-  if (output_file_arg) {
-    fflush(output_fp);
-    fclose(output_fp);
-  }    
-
+  PHASE_END(PHASE_KEXTRACTOR);
+  PHASE_REPORT();
   return 0;
 }
@@ -3,5 +3,33 @@ lkc_binding_file=$1
 kclause_file=$2
 features_file=$3
 kconfig_file=$4
-"$lkc_binding_file" --extract -o "$kclause_file" "$kconfig_file" >&2
-"$lkc_binding_file" --configs "$kconfig_file" > "$features_file"
\ No newline at end of file
+dimacs_file=$5
+kconfig_model=$6
+snapshot_file=$7
+canonical=$8
+stats_file=$9
+graph_file=${10}
+variable_order=${11}
+choice_encoding=${12}
+manifest_file=${13}
+# extract the constraints and the list of features with a single parse of the Kconfig files
+# optionally, the binding also Tseitin-transforms the constraints into a DIMACS file
+# and writes the .model file natively (only its names without the CONFIG_ prefix, so that KClause and kclause2model.py are not needed)
+# it can also store a binary snapshot of the parsed model, from which snapshot2text regenerates the text outputs without parsing again
+# in canonical mode, all outputs are sorted by name, so they do not depend on the hash function of the LKC version
+# the statistics (e.g., symbol counts, phase times, and peak RSS) are recorded alongside the model, so no output has to be reparsed
+# the symbol dependency graph (with its strongly connected components) can be stored in binary CSR form for ordering and partitioning heuristics
+# the features in the DIMACS and .model files can be numbered along the menu tree or the dependency graph, which solvers and knowledge compilers may profit from
+# large choices can be encoded with auxiliary variables in these files, which avoids quadratically many at-most-one clauses
+# the manifest of the parsed Kconfig files (the cache key of the model, see extraction.sh) is written by the same parse
+"$lkc_binding_file" --extract="$kclause_file" --configs="$features_file" \
+    ${dimacs_file:+--dimacs="$dimacs_file"} \
+    ${snapshot_file:+--snapshot="$snapshot_file"} \
+    ${kconfig_model:+--model="$kconfig_model" --model-prefix=} \
+    ${canonical:+--canonical} \
+    ${stats_file:+--stats="$stats_file"} \
+    ${graph_file:+--graph-binary="$graph_file"} \
+    ${variable_order:+--variable-order="$variable_order"} \
+    ${choice_encoding:+--choice-encoding="$choice_encoding"} \
+    ${manifest_file:+--manifest="$manifest_file"} \
+    "$kconfig_file" >&2
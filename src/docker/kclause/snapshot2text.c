@@ -0,0 +1,544 @@
+/*
+ * Regenerates the text outputs of kextractor from a binary snapshot (see kextractor --snapshot),
+ * so that a Kconfig model has to be parsed only once, even if several of its text formats are needed later on.
+ * The output is the same as kextractor's output for the same options (without --shared-expressions).
+ *
+ * usage: snapshot2text [--no-prefix] [--set-prefix PREFIX] [--direct-dependencies-only] [--canonical] --ACTION[=FILE]... SNAPSHOT
+ * with the actions --configs, --kconfigs, --defaults, --menusyms, --extract, and --symbol-table
+ */
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kextractor-snapshot.h"
+
+enum {
+  A_NONE,
+  A_CONFIGS,
+  A_KCONFIGS,
+  A_MENUSYMS,
+  A_DEFAULTS,
+  A_EXTRACT,
+  A_SYMBOL_TABLE,
+  A_COUNT,
+};
+static int action = A_NONE;
+static bool action_enabled[A_COUNT];
+static char *action_output[A_COUNT];
+
+static struct snapshot snapshot;
+static const char *config_prefix = "CONFIG_";
+static bool enable_reverse_dependencies = true;
+static bool canonical_output = false;
+
+static void print_name(FILE *out, int32_t id)
+{
+  fputs(config_prefix, out);
+  fputs(snapshot_name(&snapshot, id), out);
+}
+
+/* Print a symbol in an expression, like print_python_symbol_detail in kextractor.c */
+static void print_symbol(FILE *out, int32_t id)
+{
+  const char *name = snapshot_name(&snapshot, id), *p;
+
+  if (!name)
+    fputs("1", out);
+  else if (!strcmp(name, "y") || !strcmp(name, "m"))
+    fputs("1", out);
+  else if (!strcmp(name, "n"))
+    fputs("0", out);
+  else if (snapshot.symbols[id].type == SNAPSHOT_S_UNKNOWN) {
+    fputc('"', out);
+    for (p = name; *p; p++) {
+      if (*p == '"' || *p == '\\')
+        fputc('\\', out);
+      fputc(*p, out);
+    }
+    fputc('"', out);
+  } else
+    print_name(out, id);
+}
+
+/* The binding precedence of an operator, which decides where parentheses are needed (see _expr_compare_type) */
+static int precedence(uint32_t type)
+{
+  switch (type) {
+  case SNAPSHOT_E_LTH:
+  case SNAPSHOT_E_LEQ:
+  case SNAPSHOT_E_GTH:
+  case SNAPSHOT_E_GEQ:
+    return 1;
+  case SNAPSHOT_E_EQUAL:
+  case SNAPSHOT_E_UNEQUAL:
+    return 2;
+  case SNAPSHOT_E_NOT:
+    return 3;
+  case SNAPSHOT_E_AND:
+    return 4;
+  case SNAPSHOT_E_OR:
+    return 5;
+  case SNAPSHOT_E_LIST:
+    return 6;
+  case SNAPSHOT_E_NONE:
+    return 7;
+  default:
+    return 0;
+  }
+}
+
+static bool needs_parentheses(uint32_t prevtoken, uint32_t type)
+{
+  int p = precedence(prevtoken);
+  return prevtoken != type && p > 0 && p < precedence(SNAPSHOT_E_NONE) && precedence(type) > p;
+}
+
+/*
+ * Print an expression in KClause's Python-like syntax, like print_python_expr in kextractor.c.
+ * As in kextractor.c, we use an explicit stack, as reverse dependencies can be nested very deeply.
+ */
+struct expr_task {
+  int32_t node; // -1 for text
+  uint32_t prevtoken;
+  const char *text;
+};
+
+static struct expr_task *expr_tasks = NULL;
+static int expr_tasks_size = 0, expr_tasks_capacity = 0;
+
+static void push_expr_task(int32_t node, uint32_t prevtoken, const char *text)
+{
+  if (expr_tasks_size == expr_tasks_capacity) {
+    expr_tasks_capacity = expr_tasks_capacity ? 2 * expr_tasks_capacity : 256;
+    expr_tasks = realloc(expr_tasks, expr_tasks_capacity * sizeof(struct expr_task));
+  }
+  expr_tasks[expr_tasks_size].node = node;
+  expr_tasks[expr_tasks_size].prevtoken = prevtoken;
+  expr_tasks[expr_tasks_size].text = text;
+  expr_tasks_size++;
+}
+
+static void print_comparison(FILE *out, const struct snapshot_node *n, const char *operator)
+{
+  print_symbol(out, n->left);
+  fputs(operator, out);
+  print_symbol(out, n->right);
+}
+
+static void print_expr_step(FILE *out, int32_t node, uint32_t prevtoken)
+{
+  const struct snapshot_node *n = &snapshot.nodes[node];
+  const char *right = n->type == SNAPSHOT_E_EQUAL || n->type == SNAPSHOT_E_UNEQUAL ? snapshot_name(&snapshot, n->right) : NULL;
+
+  if (needs_parentheses(prevtoken, n->type)) {
+    fputs("(", out);
+    push_expr_task(-1, SNAPSHOT_E_NONE, ")");
+  }
+  switch (n->type) {
+  case SNAPSHOT_E_SYMBOL:
+    print_symbol(out, n->left);
+    break;
+  case SNAPSHOT_E_NOT:
+    fputs(" not ", out);
+    push_expr_task(n->left, SNAPSHOT_E_NOT, NULL);
+    break;
+  case SNAPSHOT_E_EQUAL:
+    if (!strcmp(right, "y") || !strcmp(right, "m")) {
+      print_symbol(out, n->left);
+      fputs(!strcmp(right, "y") ? "==y" : "==m", out);
+    } else if (!strcmp(right, "n")) {
+      fputs(" not ", out);
+      print_symbol(out, n->left);
+    } else
+      print_comparison(out, n, "==");
+    break;
+  case SNAPSHOT_E_UNEQUAL:
+    if (!strcmp(right, "y") || !strcmp(right, "m")) {
+      fputs(" not ", out);
+      print_symbol(out, n->left);
+      fputs(!strcmp(right, "y") ? "==y" : "==m", out);
+    } else if (!strcmp(right, "n"))
+      print_symbol(out, n->left);
+    else
+      print_comparison(out, n, "!=");
+    break;
+  case SNAPSHOT_E_OR:
+    push_expr_task(n->right, SNAPSHOT_E_OR, NULL);
+    push_expr_task(-1, SNAPSHOT_E_NONE, " or ");
+    push_expr_task(n->left, SNAPSHOT_E_OR, NULL);
+    break;
+  case SNAPSHOT_E_AND:
+    push_expr_task(n->right, SNAPSHOT_E_AND, NULL);
+    push_expr_task(-1, SNAPSHOT_E_NONE, " and ");
+    push_expr_task(n->left, SNAPSHOT_E_AND, NULL);
+    break;
+  case SNAPSHOT_E_LTH:
+    print_comparison(out, n, " < ");
+    break;
+  case SNAPSHOT_E_LEQ:
+    print_comparison(out, n, " <= ");
+    break;
+  case SNAPSHOT_E_GTH:
+    print_comparison(out, n, " > ");
+    break;
+  case SNAPSHOT_E_GEQ:
+    print_comparison(out, n, " >= ");
+    break;
+  case SNAPSHOT_E_LIST:
+  case SNAPSHOT_E_CHOICE:
+    print_symbol(out, n->right);
+    fputs(" ", out);
+    if (n->left != -1) {
+      fputs("^ ", out);
+      push_expr_task(n->left, n->type, NULL);
+    }
+    break;
+  case SNAPSHOT_E_RANGE:
+    fputs("[", out);
+    print_symbol(out, n->left);
+    print_symbol(out, n->right);
+    fputs("]", out);
+    break;
+  }
+}
+
+static void print_expr(FILE *out, int32_t node)
+{
+  struct expr_task task;
+  int base = expr_tasks_size;
+
+  push_expr_task(node, SNAPSHOT_E_NONE, NULL);
+  while (expr_tasks_size > base) {
+    task = expr_tasks[--expr_tasks_size];
+    if (task.node != -1)
+      print_expr_step(out, task.node, task.prevtoken);
+    else
+      fputs(task.text, out);
+  }
+}
+
+/* Print an optional condition in parentheses, which is 1 if absent */
+static void print_condition(FILE *out, int32_t node)
+{
+  fputs("(", out);
+  if (node != -1)
+    print_expr(out, node);
+  else
+    fputs("1", out);
+  fputs(")", out);
+}
+
+static bool has_name(int32_t id)
+{
+  const char *name = snapshot_name(&snapshot, id);
+  return name && strlen(name) > 0;
+}
+
+/* See is_default in kextractor.c */
+static bool is_default(int32_t id)
+{
+  const struct snapshot_symbol *sym = &snapshot.symbols[id];
+  const struct snapshot_property *prop;
+  uint32_t i;
+
+  for (i = 0; i < sym->properties_size; i++)
+    if (snapshot.properties[sym->properties + i].type == SNAPSHOT_P_PROMPT)
+      return false;
+  if (sym->rev_dep != -1 && !snapshot_expr_is(&snapshot, sym->rev_dep, snapshot.header->symbol_yes))
+    return false;
+  for (i = 0; i < sym->properties_size; i++) {
+    prop = &snapshot.properties[sym->properties + i];
+    if (prop->type == SNAPSHOT_P_DEFAULT && snapshot_expr_is(&snapshot, prop->visible, snapshot.header->symbol_yes))
+      if (snapshot_expr_is(&snapshot, prop->expr, snapshot.header->symbol_yes) ||
+          snapshot_expr_is(&snapshot, prop->expr, snapshot.header->symbol_mod))
+        return true;
+  }
+  return false;
+}
+
+/* See extract_symbol in kextractor.c */
+static void extract_symbol(FILE *out, int32_t id)
+{
+  const struct snapshot_symbol *sym = &snapshot.symbols[id];
+  const struct snapshot_property *prop;
+  const char *typename;
+  uint32_t i;
+
+  switch (sym->type) {
+  case SNAPSHOT_S_BOOLEAN: typename = "bool"; break;
+  case SNAPSHOT_S_TRISTATE: typename = "tristate"; break;
+  case SNAPSHOT_S_INT: typename = "number"; break;
+  case SNAPSHOT_S_HEX: typename = "number"; break;
+  case SNAPSHOT_S_STRING: typename = "string"; break;
+  default: return;
+  }
+
+  fputs("config ", out);
+  print_name(out, id);
+  fprintf(out, " %s\n", typename);
+  for (i = 0; i < sym->properties_size; i++) {
+    prop = &snapshot.properties[sym->properties + i];
+    if (prop->type == SNAPSHOT_P_PROMPT) {
+      fputs("prompt ", out);
+      print_name(out, id);
+      fputs(" ", out);
+      print_condition(out, prop->visible);
+      fputs("\n", out);
+    }
+  }
+  for (i = 0; i < sym->properties_size; i++) {
+    prop = &snapshot.properties[sym->properties + i];
+    if (prop->type == SNAPSHOT_P_DEFAULT && prop->expr != -1) {
+      fputs(sym->type == SNAPSHOT_S_BOOLEAN || sym->type == SNAPSHOT_S_TRISTATE ? "def_bool " : "def_nonbool ", out);
+      print_name(out, id);
+      fputs(" ", out);
+      print_expr(out, prop->expr);
+      fputs("|", out);
+      print_condition(out, prop->visible);
+      fputs("\n", out);
+    }
+  }
+}
+
+/*
+ * Selects are sorted by the symbol they select in kextractor's canonical mode (--canonical),
+ * which we mirror here (symbols and choice members are already stored in canonical order).
+ */
+static int compare_selects(const void *a, const void *b)
+{
+  const struct snapshot_property *x = *(const struct snapshot_property **) a, *y = *(const struct snapshot_property **) b;
+  int32_t sx = x->expr != -1 && snapshot.nodes[x->expr].type == SNAPSHOT_E_SYMBOL ? snapshot.nodes[x->expr].left : -1;
+  int32_t sy = y->expr != -1 && snapshot.nodes[y->expr].type == SNAPSHOT_E_SYMBOL ? snapshot.nodes[y->expr].left : -1;
+  const char *nx = sx != -1 ? snapshot_name(&snapshot, sx) : NULL, *ny = sy != -1 ? snapshot_name(&snapshot, sy) : NULL;
+  int cx = sx != -1 && (snapshot.symbols[sx].flags & SNAPSHOT_CONST), cy = sy != -1 && (snapshot.symbols[sy].flags & SNAPSHOT_CONST);
+  int result;
+
+  if (!nx != !ny)
+    return nx ? 1 : -1;
+  if (nx && (result = strcmp(nx, ny)))
+    return result;
+  if (cx != cy)
+    return cx - cy;
+  if (sx != sy)
+    return sx < sy ? -1 : 1;
+  return x < y ? -1 : x > y;
+}
+
+/* See extract_dependencies in kextractor.c */
+static void extract_dependencies(FILE *out, int32_t id)
+{
+  const struct snapshot_symbol *sym = &snapshot.symbols[id];
+  const struct snapshot_property *prop;
+  bool no_dependencies = true;
+  uint32_t i;
+
+  if (sym->flags & SNAPSHOT_CHOICE) {
+    bool printed_expr = false;
+
+    if (sym->type != SNAPSHOT_S_BOOLEAN && sym->type != SNAPSHOT_S_TRISTATE) {
+      fprintf(stderr, "fatal: choice type can only be bool or tristate, otherwise is impossible due to the parser.\n");
+      exit(1);
+    }
+    fprintf(out, "%s%s", sym->type == SNAPSHOT_S_BOOLEAN ? "bool" : "tristate",
+            sym->flags & SNAPSHOT_OPTIONAL ? "_opt_choice" : "_choice");
+    for (i = 0; i < sym->members_size; i++) {
+      fputs(" ", out);
+      print_name(out, snapshot.members[sym->members + i]);
+    }
+    fputs("|(", out);
+    for (i = 0; i < sym->properties_size && !printed_expr; i++) {
+      prop = &snapshot.properties[sym->properties + i];
+      if (prop->type == SNAPSHOT_P_PROMPT) {
+        printed_expr = true;
+        print_condition(out, prop->visible);
+      }
+    }
+    if (!printed_expr)
+      fputs("1", out);
+    fputs(")\n", out);
+  }
+
+  if (!has_name(id) || sym->type == SNAPSHOT_S_UNKNOWN)
+    return;
+
+  if (sym->dir_dep != -1) {
+    no_dependencies = false;
+    fputs("dep ", out);
+    print_name(out, id);
+    fputs(" ", out);
+    print_condition(out, sym->dir_dep);
+    fputs("\n", out);
+  }
+
+  if (enable_reverse_dependencies) {
+    const struct snapshot_property **selects = malloc(sym->properties_size * sizeof(struct snapshot_property *));
+    uint32_t selects_size = 0;
+    for (i = 0; i < sym->properties_size; i++)
+      if (snapshot.properties[sym->properties + i].type == SNAPSHOT_P_SELECT)
+        selects[selects_size++] = &snapshot.properties[sym->properties + i];
+    if (canonical_output)
+      qsort(selects, selects_size, sizeof(struct snapshot_property *), compare_selects);
+    for (i = 0; i < selects_size; i++) {
+      prop = selects[i];
+      fputs("select ", out);
+      print_expr(out, prop->expr);
+      fputs(" ", out);
+      print_name(out, id);
+      fputs(" ", out);
+      print_condition(out, prop->visible);
+      fputs("\n", out);
+    }
+    free(selects);
+    if (sym->rev_dep != -1) {
+      no_dependencies = false;
+      fputs("rev_dep ", out);
+      print_name(out, id);
+      fputs(" ", out);
+      print_condition(out, sym->rev_dep);
+      fputs("\n", out);
+    }
+  }
+
+  if (no_dependencies && sym->type != SNAPSHOT_S_BOOLEAN && sym->type != SNAPSHOT_S_TRISTATE) {
+    fputs("dep ", out);
+    print_name(out, id);
+    fputs(" (1)\n", out);
+  }
+}
+
+static void print_usage(const char *progname)
+{
+  printf("usage: %s [options] --ACTION[=FILE]... SNAPSHOT\n", progname);
+  printf("\n");
+  printf("OPTIONS\n");
+  printf("-p, --no-prefix\t\tdon't add the CONFIG_ prefix to vars\n");
+  printf("-P, --set-prefix PREFIX\tuse a custom prefix instead of the CONFIG_ prefix for var names\n");
+  printf("-D, --direct-dependencies-only\tno reverse dependencies in extract output\n");
+  printf("--canonical\t\tsort selects as kextractor --canonical does (for snapshots written with --canonical)\n");
+  printf("\n");
+  printf("ACTIONS (as in kextractor)\n");
+  printf("--configs, --kconfigs, --defaults, --menusyms, --extract, --symbol-table\n");
+  exit(0);
+}
+
+int main(int argc, char **argv)
+{
+  static struct option long_options[] = {
+    {"configs", optional_argument, &action, A_CONFIGS},
+    {"kconfigs", optional_argument, &action, A_KCONFIGS},
+    {"menusyms", optional_argument, &action, A_MENUSYMS},
+    {"defaults", optional_argument, &action, A_DEFAULTS},
+    {"extract", optional_argument, &action, A_EXTRACT},
+    {"symbol-table", optional_argument, &action, A_SYMBOL_TABLE},
+    {"no-prefix", no_argument, 0, 'p'},
+    {"set-prefix", required_argument, 0, 'P'},
+    {"direct-dependencies-only", no_argument, 0, 'D'},
+    {"canonical", no_argument, 0, 'c'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  FILE *out[A_COUNT] = { NULL };
+  const struct snapshot_header *header;
+  int32_t id;
+  uint32_t i;
+  int opt, a, b;
+
+  while ((opt = getopt_long(argc, argv, "pP:Dh", long_options, NULL)) != -1) {
+    switch (opt) {
+    case 0:
+      action_enabled[action] = true;
+      action_output[action] = optarg;
+      break;
+    case 'p':
+      config_prefix = "";
+      break;
+    case 'P':
+      config_prefix = optarg;
+      break;
+    case 'D':
+      enable_reverse_dependencies = false;
+      break;
+    case 'c':
+      canonical_output = true;
+      break;
+    case 'h':
+      print_usage(argv[0]);
+      break;
+    default:
+      fprintf(stderr, "Invalid option or missing argument.  For help use -h\n");
+      exit(1);
+    }
+  }
+  if (A_NONE == action || optind != argc - 1) {
+    fprintf(stderr, "Please specify an action and a snapshot.  For help use -h.\n");
+    exit(1);
+  }
+
+  if (snapshot_open(&snapshot, argv[optind]) < 0) {
+    perror(argv[optind]);
+    exit(1);
+  }
+  header = snapshot.header;
+
+  for (a = 0; a < A_COUNT; a++) {
+    if (!action_enabled[a])
+      continue;
+    if (!action_output[a] || !strcmp(action_output[a], "-"))
+      out[a] = stdout;
+    for (b = 0; b < a && !out[a]; b++)
+      if (out[b] && action_output[b] && !strcmp(action_output[a], action_output[b]))
+        out[a] = out[b];
+    if (!out[a] && (out[a] = fopen(action_output[a], "w")) == NULL) {
+      fprintf(stderr, "can't open %s for writing\n", action_output[a]);
+      exit(1);
+    }
+  }
+
+  // as in kextractor, the extract output lists all choices and dependencies after all configuration variables
+  for (i = 0; i < header->order_size; i++) {
+    id = snapshot.order[i];
+    if (!has_name(id))
+      continue;
+    if (action_enabled[A_DEFAULTS] && is_default(id))
+      fprintf(out[A_DEFAULTS], "%s\n", snapshot_name(&snapshot, id));
+    if (action_enabled[A_CONFIGS])
+      fprintf(out[A_CONFIGS], "%s\n", snapshot_name(&snapshot, id));
+    if (action_enabled[A_KCONFIGS] && snapshot.symbols[id].flags & SNAPSHOT_DECLARED)
+      fprintf(out[A_KCONFIGS], "%s\n", snapshot_name(&snapshot, id));
+    if (action_enabled[A_EXTRACT])
+      extract_symbol(out[A_EXTRACT], id);
+  }
+  if (action_enabled[A_EXTRACT])
+    for (i = 0; i < header->order_size; i++)
+      extract_dependencies(out[A_EXTRACT], snapshot.order[i]);
+  if (action_enabled[A_MENUSYMS])
+    for (i = 0; i < header->menus_size; i++)
+      if (snapshot.menus[i].symbol != -1 && has_name(snapshot.menus[i].symbol))
+        fprintf(out[A_MENUSYMS], "%s\n", snapshot_name(&snapshot, snapshot.menus[i].symbol));
+  if (action_enabled[A_SYMBOL_TABLE]) {
+    // kextractor only numbers the symbols in the menu tree and the symbol table, not constants like y (which come last)
+    int32_t symbols_size = 0;
+    for (i = 0; i < header->order_size; i++)
+      if (snapshot.order[i] >= symbols_size)
+        symbols_size = snapshot.order[i] + 1;
+    for (i = 0; i < header->menus_size; i++)
+      if (snapshot.menus[i].symbol >= symbols_size)
+        symbols_size = snapshot.menus[i].symbol + 1;
+    for (id = 0; id < symbols_size; id++)
+      fprintf(out[A_SYMBOL_TABLE], "%d %s\n", id, has_name(id) ? snapshot_name(&snapshot, id) : "");
+  }
+
+  for (a = 0; a < A_COUNT; a++) {
+    if (!out[a])
+      continue;
+    for (b = a + 1; b < A_COUNT; b++)
+      if (out[b] == out[a])
+        out[b] = NULL;
+    if (out[a] != stdout)
+      fclose(out[a]);
+  }
+  snapshot_close(&snapshot);
+  return 0;
+}
@@ -8,20 +8,28 @@
 #include <locale.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <stdint.h>
 
 #define LKC_DIRECT_LINK
 #include "lkc.h"
 
 // relevant macros were moved to internal.h in Linux 6.9:
 // https://github.com/torvalds/linux/commit/91b69454f93d1c905f3a56bb39856db9a220c791
-#ifndef for_all_symbols
+#ifdef for_all_symbols
+#define _for_all_symbols(sym) for_all_symbols(i, sym)
+#else
 #include "internal.h"
+#define _for_all_symbols(sym) for_all_symbols(sym)
 #endif
 
 char* getSymType(enum symbol_type t) {
@@ -103,28 +111,749 @@ char* replace_char(char* str, char find, char replace){
     return str;
 }
 
-void dumpsymref(FILE *out, struct symbol *s) {
+struct hash_map {
+	uintptr_t (*keys)[3];
+	int *values; // -1 marks empty slots
+	size_t capacity;
+	size_t size;
+};
+
+static size_t hash_map_slot(struct hash_map *map, uintptr_t a, uintptr_t b, uintptr_t c) {
+	uint64_t hash = (a * 0x9E3779B97F4A7C15ULL) ^ (b * 0xC2B2AE3D27D4EB4FULL) ^ (c * 0x165667B19E3779F9ULL);
+	size_t slot = (hash ^ (hash >> 29)) & (map->capacity - 1);
+	while (map->values[slot] != -1 &&
+			(map->keys[slot][0] != a || map->keys[slot][1] != b || map->keys[slot][2] != c))
+		slot = (slot + 1) & (map->capacity - 1);
+	return slot;
+}
+
+int hash_map_get(struct hash_map *map, uintptr_t a, uintptr_t b, uintptr_t c) {
+	if (!map->capacity)
+		return -1;
+	return map->values[hash_map_slot(map, a, b, c)];
+}
+
+void hash_map_put(struct hash_map *map, uintptr_t a, uintptr_t b, uintptr_t c, int value) {
+	size_t slot, i;
+	if (2 * (map->size + 1) > map->capacity) {
+		struct hash_map grown = { .capacity = map->capacity ? 2 * map->capacity : 1024 };
+		grown.keys = malloc(grown.capacity * sizeof(*grown.keys));
+		grown.values = malloc(grown.capacity * sizeof(*grown.values));
+		memset(grown.values, 0xff, grown.capacity * sizeof(*grown.values));
+		for (i = 0; i < map->capacity; i++)
+			if (map->values[i] != -1)
+				hash_map_put(&grown, map->keys[i][0], map->keys[i][1], map->keys[i][2], map->values[i]);
+		free(map->keys);
+		free(map->values);
+		*map = grown;
+	}
+	slot = hash_map_slot(map, a, b, c);
+	if (map->values[slot] == -1)
+		map->size++;
+	map->keys[slot][0] = a;
+	map->keys[slot][1] = b;
+	map->keys[slot][2] = c;
+	map->values[slot] = value;
+}
+
+/*
+ * Phase timers for the torte profiler.
+ * When torte profiles an experiment, compile-lkc-binding compiles in timers around parsing, each part of the dump, and output flushing.
+ * The timings are appended to $PROFILE_FILE in the format of record-function-call, nested under $PROFILE_STACK (see kextractor.c).
+ */
+enum phase {
+	PHASE_DUMPCONF,
+	PHASE_PARSE,
+	PHASE_PREPARE,
+	PHASE_EMIT,
+	PHASE_EXPRESSIONS,
+	PHASE_SYMBOLS,
+	PHASE_MENUS,
+	PHASE_FLUSH,
+	PHASE_COUNT
+};
+
+#if PROFILE_PHASES
+struct phase_timer {
+	const char *stack; // the phase and its enclosing phases, innermost first (like FUNCNAME in Bash)
+	long long calls;
+	long long total_time_us;
+	struct timeval start;
+};
+
+static struct phase_timer phase_timers[PHASE_COUNT] = {
+	{ "dumpconf" },
+	{ "conf_parse;dumpconf" },
+	{ "prepare;dumpconf" },
+	{ "emit;dumpconf" },
+	{ "expressions;emit;dumpconf" },
+	{ "symbols;emit;dumpconf" },
+	{ "menus;emit;dumpconf" },
+	{ "flush;dumpconf" },
+};
+
+void end_phase(struct phase_timer *timer) {
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	timer->calls++;
+	timer->total_time_us += (long long) (now.tv_sec - timer->start.tv_sec) * 1000000 + (now.tv_usec - timer->start.tv_usec);
+}
+
+// appends the timed phases to the profile, if torte requested one
+void dumpphases(void) {
+	char *file = getenv("PROFILE_FILE"), *stage = getenv("PROFILE_STAGE"), *stack = getenv("PROFILE_STACK");
+	struct phase_timer *timer;
+	FILE *fp;
+	if (!file || !(fp = fopen(file, "a")))
+		return;
+	for (timer = phase_timers; timer < phase_timers + PHASE_COUNT; timer++)
+		if (timer->calls > 0)
+			fprintf(fp, "%s,%.*s,%s%s%s,%lld,%lld\n", stage ? stage : "", (int) strcspn(timer->stack, ";"), timer->stack,
+				timer->stack, stack && *stack ? ";" : "", stack ? stack : "", timer->calls, timer->total_time_us);
+	fclose(fp);
+}
+
+#define PHASE_BEGIN(phase) gettimeofday(&phase_timers[phase].start, NULL)
+#define PHASE_END(phase) end_phase(&phase_timers[phase])
+#define PHASE_REPORT() dumpphases()
+#else
+#define PHASE_BEGIN(phase)
+#define PHASE_END(phase)
+#define PHASE_REPORT()
+#endif
+
+/*
+ * Buffered output.
+ * The dump is collected in a buffer and handed to write(2) in large chunks, which is much faster than many small fprintf calls.
+ * An output without a file is kept in memory, which we use to compute the length of fields in the line format.
+ * With --stdio, the dump is written through stdio instead, so both paths can be compared byte for byte.
+ */
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+
+struct output {
+	FILE *fp; // NULL for in-memory outputs
+	char *data;
+	size_t size;
+	size_t capacity;
+	size_t bytes; // written in total (before compression), for --stats
+	pid_t compressor; // the process compressing this output, if any
+};
+
+static int stdio_output = 0;
+
+void output_flush(struct output *out) {
+	size_t written = 0;
+	ssize_t result;
+	if (!out->fp)
+		return;
+	fflush(out->fp);
+	while (written < out->size) {
+		result = write(fileno(out->fp), out->data + written, out->size - written);
+		if (result < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("write");
+			exit(EXIT_FAILURE);
+		}
+		written += result;
+	}
+	out->size = 0;
+}
+
+void output_write(struct output *out, const char *data, size_t size) {
+	out->bytes += size;
+	if (stdio_output && out->fp) {
+		fwrite(data, 1, size, out->fp);
+		return;
+	}
+	if (out->fp && out->size + size > OUTPUT_BUFFER_SIZE)
+		output_flush(out);
+	if (out->size + size > out->capacity) {
+		while (out->size + size > out->capacity)
+			out->capacity = out->capacity ? 2 * out->capacity : OUTPUT_BUFFER_SIZE;
+		out->data = realloc(out->data, out->capacity);
+	}
+	memcpy(out->data + out->size, data, size);
+	out->size += size;
+}
+
+static inline void out_str(struct output *out, const char *str) {
+	output_write(out, str, strlen(str));
+}
+
+void out_int(struct output *out, int value) {
+	char buffer[12], *p = buffer + sizeof(buffer);
+	unsigned int magnitude = value < 0 ? -(unsigned int) value : (unsigned int) value;
+	do {
+		*--p = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude);
+	if (value < 0)
+		*--p = '-';
+	output_write(out, p, buffer + sizeof(buffer) - p);
+}
+
+/*
+ * Compressed output files (--compress).
+ * Output files ending in .gz or .zst (or all output files with --compress) are piped through gzip or zstd,
+ * so they are never written to disk uncompressed. The compressor runs as a separate process,
+ * as we are built by each system's own makefiles, which do not link against zlib or libzstd.
+ * Our Docker image (Ubuntu 14.04) does not ship zstd, so it is built from source in its Dockerfile.
+ */
+static char *compression = NULL;
+
+const char *output_compressor(const char *path) {
+	size_t size = strlen(path);
+	if (compression)
+		return compression;
+	if (size > strlen(".gz") && !strcmp(path + size - strlen(".gz"), ".gz"))
+		return "gzip";
+	if (size > strlen(".zst") && !strcmp(path + size - strlen(".zst"), ".zst"))
+		return "zstd";
+	return NULL;
+}
+
+int open_output_file(struct output *out, const char *path) {
+	const char *compressor = output_compressor(path);
+	int fd, pipe_fds[2];
+	out->compressor = 0;
+	if (!compressor)
+		return (out->fp = fopen(path, "w")) != NULL;
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+		return 0;
+	if (pipe(pipe_fds) < 0) {
+		close(fd);
+		return 0;
+	}
+	// compressors started later must not inherit our end of this pipe, or this compressor would never see its end
+	fcntl(pipe_fds[1], F_SETFD, FD_CLOEXEC);
+	fflush(NULL);
+	if ((out->compressor = fork()) < 0)
+		return 0;
+	if (out->compressor == 0) {
+		dup2(pipe_fds[0], STDIN_FILENO);
+		dup2(fd, STDOUT_FILENO);
+		close(pipe_fds[0]);
+		close(pipe_fds[1]);
+		close(fd);
+		execlp(compressor, compressor, "-q", "-c", (char *) NULL);
+		perror(compressor);
+		_exit(127);
+	}
+	close(pipe_fds[0]);
+	close(fd);
+	return (out->fp = fdopen(pipe_fds[1], "w")) != NULL;
+}
+
+void close_output_file(struct output *out) {
+	int status;
+	output_flush(out);
+	fclose(out->fp);
+	if (out->compressor > 0 &&
+			(waitpid(out->compressor, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+		fprintf(stderr, "compressing output failed\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Dense symbol IDs.
+ * Symbols are numbered in menu-tree order, followed by all remaining symbols in symbol-table order,
+ * so that identical Kconfig trees always yield identical dumps (unlike the addresses we used before).
+ */
+static struct hash_map symbol_ids;
+static struct symbol **symbols_by_id = NULL;
+static int symbols_by_id_size = 0, symbols_by_id_capacity = 0;
+static int menu_symbols_size = 0; // symbols with IDs below this are referenced by some menu entry
+
+int symbol_id(struct symbol *s) {
+	int id = hash_map_get(&symbol_ids, (uintptr_t) s, 0, 0);
+	if (id != -1)
+		return id;
+	if (symbols_by_id_size == symbols_by_id_capacity) {
+		symbols_by_id_capacity = symbols_by_id_capacity ? 2 * symbols_by_id_capacity : 1024;
+		symbols_by_id = realloc(symbols_by_id, symbols_by_id_capacity * sizeof(struct symbol *));
+	}
+	symbols_by_id[symbols_by_id_size] = s;
+	hash_map_put(&symbol_ids, (uintptr_t) s, 0, 0, symbols_by_id_size);
+	return symbols_by_id_size++;
+}
+
+void number_symbols(void) {
+	struct menu *menu;
+	struct symbol *sym;
+	int i;
+	for (menu = rootmenu.list; menu; ) {
+		if (menu->sym)
+			symbol_id(menu->sym);
+		if (menu->list)
+			menu = menu->list;
+		else if (menu->next)
+			menu = menu->next;
+		else while ((menu = menu->parent)) {
+			if (menu->next) {
+				menu = menu->next;
+				break;
+			}
+		}
+	}
+	menu_symbols_size = symbols_by_id_size;
+	_for_all_symbols(sym)
+		symbol_id(sym);
+}
+
+// writes the ID and name of each symbol in a line (unnamed symbols, such as choices, have an empty name)
+void dumpsymboltable(struct output *out) {
+	int id;
+	for (id = 0; id < symbols_by_id_size; id++) {
+		out_int(out, id);
+		out_str(out, " ");
+		if (symbols_by_id[id]->name)
+			out_str(out, symbols_by_id[id]->name);
+		out_str(out, "\n");
+	}
+}
+
+/*
+ * Parsed-file manifest (--manifest=FILE, or the DUMPCONF_MANIFEST environment variable).
+ * Lists each Kconfig file LKC has opened with its git blob ID ("file <ID or -> <path>") and each environment variable
+ * LKC has read with its value ("env <name> <value>"), so extraction can use it as a cache key (see extraction.sh).
+ * Both lists are taken from the dependency file LKC writes for make (file_write_dep).
+ * Without --output and --symbol-table, --manifest only writes the manifest, which skips dumping the model.
+ * KConfigReader runs us without our options, so it gets the manifest along with the model via DUMPCONF_MANIFEST instead.
+ */
+#define MANIFEST_DEPENDENCY_FILE ".dumpconf-manifest.d"
+
+struct sha1 {
+	uint32_t state[5];
+	uint64_t size;
+	unsigned char block[64];
+};
+
+static inline uint32_t sha1_rotate(uint32_t value, int bits) {
+	return value << bits | value >> (32 - bits);
+}
+
+static void sha1_transform(struct sha1 *ctx) {
+	uint32_t w[80], a, b, c, d, e, f, k, temp;
+	int t;
+	for (t = 0; t < 16; t++)
+		w[t] = (uint32_t) ctx->block[4 * t] << 24 | (uint32_t) ctx->block[4 * t + 1] << 16 |
+			(uint32_t) ctx->block[4 * t + 2] << 8 | (uint32_t) ctx->block[4 * t + 3];
+	for (; t < 80; t++)
+		w[t] = sha1_rotate(w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1);
+	a = ctx->state[0];
+	b = ctx->state[1];
+	c = ctx->state[2];
+	d = ctx->state[3];
+	e = ctx->state[4];
+	for (t = 0; t < 80; t++) {
+		if (t < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5a827999;
+		} else if (t < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		} else if (t < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8f1bbcdc;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+		temp = sha1_rotate(a, 5) + f + e + k + w[t];
+		e = d;
+		d = c;
+		c = sha1_rotate(b, 30);
+		b = a;
+		a = temp;
+	}
+	ctx->state[0] += a;
+	ctx->state[1] += b;
+	ctx->state[2] += c;
+	ctx->state[3] += d;
+	ctx->state[4] += e;
+}
+
+static void sha1_init(struct sha1 *ctx) {
+	ctx->state[0] = 0x67452301;
+	ctx->state[1] = 0xefcdab89;
+	ctx->state[2] = 0x98badcfe;
+	ctx->state[3] = 0x10325476;
+	ctx->state[4] = 0xc3d2e1f0;
+	ctx->size = 0;
+}
+
+static void sha1_update(struct sha1 *ctx, const void *data, size_t size) {
+	const unsigned char *bytes = data;
+	while (size-- > 0) {
+		ctx->block[ctx->size++ % 64] = *bytes++;
+		if (ctx->size % 64 == 0)
+			sha1_transform(ctx);
+	}
+}
+
+static void sha1_final(struct sha1 *ctx, char hex[41]) {
+	uint64_t bits = ctx->size * 8;
+	unsigned char byte = 0x80;
+	int i;
+	sha1_update(ctx, &byte, 1);
+	byte = 0;
+	while (ctx->size % 64 != 56)
+		sha1_update(ctx, &byte, 1);
+	for (i = 7; i >= 0; i--) {
+		byte = bits >> (8 * i);
+		sha1_update(ctx, &byte, 1);
+	}
+	for (i = 0; i < 20; i++)
+		sprintf(hex + 2 * i, "%02x", (ctx->state[i / 4] >> (24 - 8 * (i % 4))) & 0xff);
+}
+
+// computes the git blob ID of a file (as git hash-object does), returning 0 if it cannot be read
+int file_blob_id(const char *path, char hex[41]) {
+	struct sha1 ctx;
+	struct stat st;
+	char buffer[8192];
+	size_t size;
+	FILE *fp;
+	if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) || !(fp = fopen(path, "rb")))
+		return 0;
+	sha1_init(&ctx);
+	size = sprintf(buffer, "blob %lu", (unsigned long) st.st_size);
+	sha1_update(&ctx, buffer, size + 1);
+	while ((size = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+		sha1_update(&ctx, buffer, size);
+	fclose(fp);
+	sha1_final(&ctx, hex);
+	return 1;
+}
+
+void dumpmanifestfile(struct output *out, const char *path) {
+	char hex[41], *srctree = getenv("srctree"), *source_path;
+	int found = file_blob_id(path, hex);
+	// newer versions of LKC look up relative paths in $srctree as well
+	if (!found && srctree && path[0] != '/') {
+		source_path = malloc(strlen(srctree) + strlen(path) + 2);
+		sprintf(source_path, "%s/%s", srctree, path);
+		found = file_blob_id(source_path, hex);
+		free(source_path);
+	}
+	out_str(out, "file ");
+	out_str(out, found ? hex : "-");
+	out_str(out, " ");
+	out_str(out, path);
+	out_str(out, "\n");
+}
+
+void dumpmanifest(struct output *out) {
+	// these variables select the architecture, so we record them even if LKC does not (e.g., in old versions)
+	static const char *architecture_variables[] = { "ARCH", "SRCARCH", "SUBARCH", NULL };
+	int architecture_dumped[3] = { 0, 0, 0 }, i;
+#if HAS_file_write_dep
+	char *line = NULL, *name, *value, *p;
+	size_t len = 0;
+	FILE *fp;
+	// LKC lists the opened files as "\t<path> \" (the last one without a backslash in old versions),
+	// and the environment variables read as 'ifneq "$(<name>)" "<value>"'
+	if (file_write_dep(MANIFEST_DEPENDENCY_FILE) != 0 || !(fp = fopen(MANIFEST_DEPENDENCY_FILE, "r"))) {
+		fprintf(stderr, "could not list the parsed files\n");
+		exit(EXIT_FAILURE);
+	}
+	while (getline(&line, &len, fp) != -1) {
+		line[strcspn(line, "\n")] = '\0';
+		if (line[0] == '\t' && line[1] != '$' && line[1] != '\0') {
+			p = line + strlen(line);
+			if (p - line > 2 && !strcmp(p - 2, " \\"))
+				p[-2] = '\0';
+			dumpmanifestfile(out, line + 1);
+		} else if (!strncmp(line, "ifneq \"$(", strlen("ifneq \"$("))) {
+			name = line + strlen("ifneq \"$(");
+			if (!(p = strstr(name, ")\" \"")))
+				continue;
+			*p = '\0';
+			value = p + strlen(")\" \"");
+			if ((p = strrchr(value, '"')))
+				*p = '\0';
+			for (i = 0; architecture_variables[i]; i++)
+				if (!strcmp(name, architecture_variables[i]))
+					architecture_dumped[i] = 1;
+			out_str(out, "env ");
+			out_str(out, name);
+			out_str(out, " ");
+			out_str(out, value);
+			out_str(out, "\n");
+		}
+	}
+	free(line);
+	fclose(fp);
+	unlink(MANIFEST_DEPENDENCY_FILE);
+#else
+	// without a file list, the manifest cannot serve as a cache key, which extraction.sh detects by the missing file lines
+	fprintf(stderr, "this LKC implementation does not list the parsed files\n");
+#endif
+	for (i = 0; architecture_variables[i]; i++)
+		if (!architecture_dumped[i] && getenv(architecture_variables[i])) {
+			out_str(out, "env ");
+			out_str(out, architecture_variables[i]);
+			out_str(out, " ");
+			out_str(out, getenv(architecture_variables[i]));
+			out_str(out, "\n");
+		}
+}
+
+static char **symrefs = NULL;
+static int symrefs_size = 0, symrefs_capacity = 0;
+static struct hash_map symref_ids;
+
+// symbol references are dumped many times, so we compute each of them only once
+char *symref(struct symbol *s) {
+	char *ref;
+	int id = hash_map_get(&symref_ids, (uintptr_t) s, 0, 0);
+	if (id != -1)
+		return symrefs[id];
 	replace_char(s->name, '&', '_'); // necessary to parse freetz-ng, which uses & characters in feature names
 	if (s==&symbol_mod) 
-		fprintf(out, "m");
+		ref = strdup("m");
 	else if (s==&symbol_yes) 
-		fprintf(out, "y");
+		ref = strdup("y");
 	else if (s==&symbol_no) 
-		fprintf(out, "n");
-	else if ((s->flags & SYMBOL_CONST)) 
-		fprintf(out, "'%s'", s->name);
-	else if (s->type==S_UNKNOWN)
-		fprintf(out, "'%s'", s->name);
+		ref = strdup("n");
+	else if ((s->flags & SYMBOL_CONST) || s->type==S_UNKNOWN) {
+		ref = malloc(strlen(s->name) + 3);
+		sprintf(ref, "'%s'", s->name);
+	}
 #ifdef SYMBOL_AUTO
 	else if (s->flags & SYMBOL_AUTO && !(s->flags & SYMBOL_CHOICE) && !(s->name)) //IGNORE
-		fprintf(out, "IGNORE");
+		ref = strdup("IGNORE");
+#endif
+	else {
+		ref = malloc(16);
+		sprintf(ref, "S@%d", symbol_id(s));
+	}
+	if (symrefs_size == symrefs_capacity) {
+		symrefs_capacity = symrefs_capacity ? 2 * symrefs_capacity : 1024;
+		symrefs = realloc(symrefs, symrefs_capacity * sizeof(char *));
+	}
+	symrefs[symrefs_size] = ref;
+	hash_map_put(&symref_ids, (uintptr_t) s, 0, 0, symrefs_size++);
+	return ref;
+}
+
+void dumpsymref(struct output *out, struct symbol *s) {
+	out_str(out, symref(s));
+}
+
+/*
+ * Shared subexpressions (--shared-expressions).
+ * LKC propagates menu dependencies into every property, so the same subexpressions are dumped over and over.
+ * We intern expressions by their operator and the IDs of their children, so structurally identical subexpressions get the same ID.
+ * Conjunctions and disjunctions that are referenced more than once are dumped once in an <expressions> section and referenced as E@<id>.
+ */
+struct shared_expr {
+	struct expr *expr; // representative expression
+	int references;
+};
+
+static int shared_expressions = 0;
+static int deduplicate_symbols = 0;
+static int line_format = 0;
+static struct shared_expr *shared_exprs = NULL;
+static int shared_exprs_size = 0, shared_exprs_capacity = 0;
+static struct hash_map shared_expr_ids, shared_expr_pointers;
+static struct expr *shared_definition = NULL; // the expression whose definition is currently dumped
+
+// splits an expression into its subexpressions and its symbol operands (which are identified by their address)
+void intern_operands(struct expr *e, struct expr **left_expr, struct expr **right_expr, uintptr_t *left, uintptr_t *right) {
+	*left_expr = *right_expr = NULL;
+	*left = *right = 0;
+	switch (e->type) {
+#if HAS_E_NOT
+	case E_NOT:
+		*left_expr = e->left.expr;
+		break;
+#endif
+#if HAS_E_AND
+	case E_AND:
+		*left_expr = e->left.expr;
+		*right_expr = e->right.expr;
+		break;
+#endif
+#if HAS_E_OR
+	case E_OR:
+		*left_expr = e->left.expr;
+		*right_expr = e->right.expr;
+		break;
 #endif
+#if HAS_E_LIST
+	case E_LIST:
+		*left_expr = e->left.expr;
+		*right = (uintptr_t) e->right.sym;
+		break;
+#endif
+#if HAS_E_CHOICE
+	case E_CHOICE:
+		*left_expr = e->left.expr;
+		*right = (uintptr_t) e->right.sym;
+		break;
+#endif
+#if HAS_E_SYMBOL
+	case E_SYMBOL:
+		*left = (uintptr_t) e->left.sym;
+		break;
+#endif
+	default:
+		// comparisons and ranges
+		*left = (uintptr_t) e->left.sym;
+		*right = (uintptr_t) e->right.sym;
+		break;
+	}
+}
+
+// interns an expression and all its subexpressions in post-order (with an explicit stack, as long select chains are deep)
+int intern_expr(struct expr *e) {
+	static struct expr **stack = NULL;
+	static int stack_capacity = 0;
+	struct expr *top, *left_expr, *right_expr;
+	uintptr_t left, right;
+	int size = 0, id;
+	if (!e)
+		return -1;
+	if ((id = hash_map_get(&shared_expr_pointers, (uintptr_t) e, 0, 0)) != -1)
+		return id;
+	if (!stack) {
+		stack_capacity = 256;
+		stack = malloc(stack_capacity * sizeof(struct expr *));
+	}
+	stack[size++] = e;
+	while (size > 0) {
+		top = stack[size - 1];
+		if (hash_map_get(&shared_expr_pointers, (uintptr_t) top, 0, 0) != -1) {
+			size--;
+			continue;
+		}
+		// children are interned first, so we postpone this expression until they are
+		intern_operands(top, &left_expr, &right_expr, &left, &right);
+		if (size + 2 > stack_capacity) {
+			stack_capacity *= 2;
+			stack = realloc(stack, stack_capacity * sizeof(struct expr *));
+		}
+		if (right_expr && hash_map_get(&shared_expr_pointers, (uintptr_t) right_expr, 0, 0) == -1)
+			stack[size++] = right_expr;
+		if (left_expr && hash_map_get(&shared_expr_pointers, (uintptr_t) left_expr, 0, 0) == -1)
+			stack[size++] = left_expr;
+		if (stack[size - 1] != top)
+			continue;
+		size--;
+		// child expressions are identified by their ID (shifted by one, so that missing children are 0)
+		if (left_expr)
+			left = hash_map_get(&shared_expr_pointers, (uintptr_t) left_expr, 0, 0) + 1;
+		if (right_expr)
+			right = hash_map_get(&shared_expr_pointers, (uintptr_t) right_expr, 0, 0) + 1;
+		if ((id = hash_map_get(&shared_expr_ids, top->type, left, right)) == -1) {
+			if (shared_exprs_size == shared_exprs_capacity) {
+				shared_exprs_capacity = shared_exprs_capacity ? 2 * shared_exprs_capacity : 4096;
+				shared_exprs = realloc(shared_exprs, shared_exprs_capacity * sizeof(struct shared_expr));
+			}
+			id = shared_exprs_size++;
+			shared_exprs[id].expr = top;
+			shared_exprs[id].references = 0;
+			hash_map_put(&shared_expr_ids, top->type, left, right, id);
+			// each distinct parent references its children once
+			if (left && (top->type == E_NOT || top->type == E_AND || top->type == E_OR))
+				shared_exprs[left - 1].references++;
+			if (right && (top->type == E_AND || top->type == E_OR))
+				shared_exprs[right - 1].references++;
+		}
+		hash_map_put(&shared_expr_pointers, (uintptr_t) top, 0, 0, id);
+	}
+	return hash_map_get(&shared_expr_pointers, (uintptr_t) e, 0, 0);
+}
+
+// registers a top-level use of an expression
+void share_expr(struct expr *e) {
+	int id;
+	if (e) {
+		id = intern_expr(e); // may grow shared_exprs
+		shared_exprs[id].references++;
+	}
+}
+
+// returns the ID of a shared expression, or -1 if the expression should be dumped inline
+int shared_expr_id(struct expr *e) {
+	int id;
+	if (!shared_expressions || e == shared_definition || (e->type != E_AND && e->type != E_OR))
+		return -1;
+	id = hash_map_get(&shared_expr_pointers, (uintptr_t) e, 0, 0);
+	return id != -1 && shared_exprs[id].references > 1 ? id : -1;
+}
+
+/*
+ * Expressions are dumped with an explicit stack instead of recursion, as reverse dependencies of heavily selected symbols
+ * are chains of hundreds of operands. Each step dumps the leading part of an expression and pushes the rest as tasks,
+ * which are either subexpressions or text. Tasks are pushed in reverse order.
+ */
+struct expr_task {
+	struct expr *expr; // NULL for text
+	const char *text;
+};
+
+static struct expr_task *expr_tasks = NULL;
+static int expr_tasks_size = 0, expr_tasks_capacity = 0;
+
+void push_expr_task(struct expr *e, const char *text) {
+	if (expr_tasks_size == expr_tasks_capacity) {
+		expr_tasks_capacity = expr_tasks_capacity ? 2 * expr_tasks_capacity : 256;
+		expr_tasks = realloc(expr_tasks, expr_tasks_capacity * sizeof(struct expr_task));
+	}
+	expr_tasks[expr_tasks_size].expr = e;
+	expr_tasks[expr_tasks_size].text = text;
+	expr_tasks_size++;
+}
+
+static inline void push_expr(struct expr *e) {
+	push_expr_task(e, NULL);
+}
+
+static inline void push_text(const char *text) {
+	push_expr_task(NULL, text);
+}
+
+void dumpexpr_step(struct output *out, struct expr *e);
+
+void dumpexpr(struct output *out, struct expr *e) {
+	struct expr_task task;
+	int base = expr_tasks_size;
+	if (!e) {out_str(out, "ERROR"); return;}
+	push_expr(e);
+	while (expr_tasks_size > base) {
+		task = expr_tasks[--expr_tasks_size];
+		if (task.expr)
+			dumpexpr_step(out, task.expr);
+		else
+			out_str(out, task.text);
+	}
+}
+
+// pushes both operands of a binary expression, dumping missing operands as ERROR like dumpexpr does
+void push_binary_operands(struct expr *e, const char *operator) {
+	if (e->right.expr)
+		push_expr(e->right.expr);
+	else
+		push_text("ERROR");
+	push_text(operator);
+	if (e->left.expr)
+		push_expr(e->left.expr);
 	else
-		fprintf(out, "S@%d", s);
+		push_text("ERROR");
 }
 
-void dumpexpr(FILE *out, struct expr *e) {
-	if (!e) {fprintf(out, "ERROR"); return;}
+void dumpexpr_step(struct output *out, struct expr *e) {
+	int id = shared_expr_id(e);
+	if (id != -1) {
+		out_str(out, "E@");
+		out_int(out, id);
+		return;
+	}
 	enum expr_type t = e->type;
 	switch (t) {
 #if HAS_E_SYMBOL
@@ -134,104 +863,103 @@ void dumpexpr(FILE *out, struct expr *e) {
 #endif
 #if HAS_E_NOT
 	case E_NOT:
-		fprintf(out, "!");
-		dumpexpr(out, e->left.expr);
+		out_str(out, "!");
+		if (e->left.expr)
+			push_expr(e->left.expr);
+		else
+			out_str(out, "ERROR");
 		break;
 #endif
 #if HAS_E_EQUAL
 	case E_EQUAL:
-		fprintf(out, "(");
+		out_str(out, "(");
 		dumpsymref(out, e->left.sym);
-		fprintf(out, "=");
+		out_str(out, "=");
 		dumpsymref(out, e->right.sym);
-		fprintf(out, ")");
+		out_str(out, ")");
 		break;
 #endif
 #if HAS_E_UNEQUAL
 	case E_UNEQUAL:
-		fprintf(out, "(");
+		out_str(out, "(");
 		dumpsymref(out, e->left.sym);
-		fprintf(out, "!=");
+		out_str(out, "!=");
 		dumpsymref(out, e->right.sym);
-		fprintf(out, ")");
+		out_str(out, ")");
 		break;
 #endif
 #if HAS_E_OR
 	case E_OR:
-		fprintf(out, "(");
-		dumpexpr(out, e->left.expr);
-		fprintf(out, " || ");
-		dumpexpr(out, e->right.expr);
-		fprintf(out, ")");
+		out_str(out, "(");
+		push_text(")");
+		push_binary_operands(e, " || ");
 		break;
 #endif
 #if HAS_E_AND
 	case E_AND:
-		fprintf(out, "(");
-		dumpexpr(out, e->left.expr);
-		fprintf(out, " &amp;&amp; ");
-		dumpexpr(out, e->right.expr);
-		fprintf(out, ")");
+		out_str(out, "(");
+		push_text(")");
+		push_binary_operands(e, line_format ? " && " : " &amp;&amp; ");
 		break;
 #endif
 #if HAS_E_LIST
 	case E_LIST:
-		fprintf(out, "(");
+		out_str(out, "(");
 		dumpsymref(out, e->right.sym);
+		push_text(")");
 		if (e->left.expr) {
-			fprintf(out, " ^ ");
-			dumpexpr(out, e->left.expr);
+			push_expr(e->left.expr);
+			push_text(" ^ ");
 		}
-		fprintf(out, ")");
 		break;
 #endif
 #if HAS_E_RANGE
 	case E_RANGE:
-		fprintf(out, "[");
+		out_str(out, "[");
 		dumpsymref(out, e->left.sym);
-		fprintf(out, ",");
+		out_str(out, ",");
 		dumpsymref(out, e->right.sym);
-		fprintf(out, "]");
+		out_str(out, "]");
 		break;
 #endif
 #if HAS_E_CHOICE
 	case E_CHOICE:
-		fprintf(out, "(");
+		out_str(out, "(");
 		dumpsymref(out, e->right.sym);
+		push_text(")");
 		if (e->left.expr) {
-			fprintf(out, " ^ ");
-			dumpexpr(out, e->left.expr);
+			push_expr(e->left.expr);
+			push_text(" ^ ");
 		}
-		fprintf(out, ")");
 		break;
 #endif
 #if HAS_E_NONE
 	case E_NONE:
-		fprintf(out, "y");
+		out_str(out, "y");
 		fprintf(stderr, "Ignoring E_NONE expression\n");
 		break;
 #endif
 #if HAS_E_LTH
 	case E_LTH:
-		fprintf(out, "y");
+		out_str(out, "y");
 		fprintf(stderr, "Ignoring E_LTH expression\n");
 		break;
 #endif
 #if HAS_E_LEQ
 	case E_LEQ:
-		fprintf(out, "y");
+		out_str(out, "y");
 		fprintf(stderr, "Ignoring E_LEQ expression\n");
 		break;
 #endif
 #if HAS_E_GTH
 	case E_GTH:
-		fprintf(out, "y");
+		out_str(out, "y");
 		fprintf(stderr, "Ignoring E_GTH expression\n");
 		break;
 #endif
 #if HAS_E_GEQ
 	case E_GEQ:
-		fprintf(out, "y");
+		out_str(out, "y");
 		fprintf(stderr, "Ignoring E_GEQ expression\n");
 		break;
 #endif
@@ -239,38 +967,116 @@ void dumpexpr(FILE *out, struct expr *e) {
 }
 
 
-void dumpprop(FILE *out, struct property *prop) {
+/*
+ * Line format (--format=lines).
+ * Instead of pseudo-XML, the dump consists of one record per line, which can be read in a single forward scan.
+ * No consumer reads this format yet (KConfigReader only reads the XML format), so it may still change.
+ * Like the XML format, the dump starts with an empty line and the line ".", after which it is structured as follows:
+ *   dump     = expr-record* symbol-record* "{" NL menu* "}" NL
+ *   menu     = "M" SP <flags> SP <symbol id or -1> SP dep NL [symbol-record] ["{" NL menu* "}" NL]
+ *   symbol-record = "S" SP <id> SP <type> SP <flags> SP name NL prop-record*
+ *   prop-record   = "P" SP <type> SP text SP expr SP visible NL
+ *   expr-record   = "E" SP <id> SP expr NL
+ * - expression records are only written with --shared-expressions, and each follows the records it references (as E@<id>)
+ * - top-level symbol records are only written with --deduplicate-symbols, otherwise each symbol follows its menu entry
+ * - <type> is a symbol type (boolean, tristate, ...) or property type (prompt, default, select, ...) as in the XML format,
+ *   but imply properties are omitted, and a choice's members are given by a property "P choice - <members> <visible>"
+ * - <flags> are LKC's symbol or menu flags as a decimal number
+ * - name, text, expr, dep, and visible are fields written as <length>:<bytes> (so they may contain any character),
+ *   or as - if absent, where <length> counts the bytes in decimal
+ * - expressions use the syntax of the XML format without escaping, i.e., S@<id> (symbol), E@<id> (shared expression),
+ *   y, m, n, '<constant>', !e, (e || e), (e && e), (s=s), (s!=s), [s,s] (range), and (s ^ (s ^ ...)) (choice members)
+ */
+static struct output field_buffer;
+
+void out_field(struct output *out, const char *data, size_t size) {
+	out_str(out, " ");
+	out_int(out, (int) size);
+	out_str(out, ":");
+	output_write(out, data, size);
+}
+
+void out_text_field(struct output *out, const char *text) {
+	if (text)
+		out_field(out, text, strlen(text));
+	else
+		out_str(out, " -");
+}
+
+void out_expr_field(struct output *out, struct expr *e) {
+	if (!e) {
+		out_str(out, " -");
+		return;
+	}
+	field_buffer.size = 0;
+	dumpexpr(&field_buffer, e);
+	out_field(out, field_buffer.data, field_buffer.size);
+}
+
+void dumpprop(struct output *out, struct property *prop) {
 	const char *type = getPropType(prop->type);
 	// we explicitly ignore "imply" properties here, as documented in the README file
 	// this improves comparability with the other extractors (which also ignore imply)
-	if (strcmp(type, "imply") != 0) {
-		fprintf(out, "<property type=\"%s\">", type);
-		if (prop->text)
-			fprintf(out, "<text><![CDATA[%s]]></text>", prop->text);
+	if (strcmp(type, "imply") != 0 && line_format) {
+		out_str(out, "P ");
+		out_str(out, type);
+		out_text_field(out, prop->text);
+		out_expr_field(out, prop->expr);
+		out_expr_field(out, prop->visible.expr);
+		out_str(out, "\n");
+	} else if (strcmp(type, "imply") != 0) {
+		out_str(out, "<property type=\"");
+		out_str(out, type);
+		out_str(out, "\">");
+		if (prop->text) {
+			out_str(out, "<text><![CDATA[");
+			out_str(out, prop->text);
+			out_str(out, "]]></text>");
+		}
 		if (prop->expr)	{
-			fprintf(out, "<expr>");
+			out_str(out, "<expr>");
 			dumpexpr(out, prop->expr);
-			fprintf(out, "</expr>");
+			out_str(out, "</expr>");
 		}
 		if (prop->visible.expr)	{
-			fprintf(out, "<visible><expr>");
+			out_str(out, "<visible><expr>");
 			dumpexpr(out, prop->visible.expr);
-			fprintf(out, "</expr></visible>");
+			out_str(out, "</expr></visible>");
 		}
 
-		fprintf(out, "</property>\n");
+		out_str(out, "</property>\n");
 	}
 }
 
 
-void dumpsymbol(FILE *out, struct symbol *sym) {
+void dumpsymbol(struct output *out, struct symbol *sym) {
 	struct property *prop;
 	struct property *symbol_prop = NULL;
 	//while (sym) {
-		fprintf(out, "<symbol type=\"%s\" flags=\"%d\" id=\"%d\">\n", getSymType(sym->type), sym->flags, sym);
+		if (line_format) {
+			out_str(out, "S ");
+			out_int(out, symbol_id(sym));
+			out_str(out, " ");
+			out_str(out, getSymType(sym->type));
+			out_str(out, " ");
+			out_int(out, sym->flags);
+			out_text_field(out, sym->name);
+			out_str(out, "\n");
+		} else {
+			out_str(out, "<symbol type=\"");
+			out_str(out, getSymType(sym->type));
+			out_str(out, "\" flags=\"");
+			out_int(out, sym->flags);
+			out_str(out, "\" id=\"");
+			out_int(out, symbol_id(sym));
+			out_str(out, "\">\n");
+		}
 
-		if (sym->name)	
-       		fprintf(out, "<name>%s</name>\n", sym->name);
+		if (sym->name && !line_format) {
+			out_str(out, "<name>");
+			out_str(out, sym->name);
+			out_str(out, "</name>\n");
+		}
 
        	for (prop = sym->prop; prop; prop = prop->next) {
 #if HAS_P_SYMBOL
@@ -287,92 +1093,491 @@ void dumpsymbol(FILE *out, struct symbol *sym) {
 		if (sym_is_choice(sym)) {
 			struct menu *choice;
 			struct symbol *def_sym;
+			// in the line format, the choice members are collected first, so the length of the field is known
+			struct output *members = line_format ? &field_buffer : out;
 			choice = list_first_entry(&sym->menus, struct menu, link);
-			fprintf(out, "<property type=\"choice\">");
-			fprintf(out, "<expr>");
+			if (line_format) {
+				out_str(out, "P choice -");
+				field_buffer.size = 0;
+			} else {
+				out_str(out, "<property type=\"choice\">");
+				out_str(out, "<expr>");
+			}
 			int i = 0;
 			list_for_each_entry(def_sym, &choice->choice_members, choice_link) {
 				if (i > 0)
-					fprintf(out, " ^ ");
-				fprintf(out, "(");
-				dumpsymref(out, def_sym);
+					out_str(members, " ^ ");
+				out_str(members, "(");
+				dumpsymref(members, def_sym);
 				i++;
 			}
 			for (; i > 0; i--)
-				fprintf(out, ")");
-			fprintf(out, "</expr>");
-			if (symbol_prop && symbol_prop->visible.expr) {
-				fprintf(out, "<visible><expr>");
-				dumpexpr(out, symbol_prop->visible.expr);
-				fprintf(out, "</expr></visible>");
+				out_str(members, ")");
+			if (line_format) {
+				out_field(out, field_buffer.data, field_buffer.size);
+				out_expr_field(out, symbol_prop ? symbol_prop->visible.expr : NULL);
+				out_str(out, "\n");
+			} else {
+				out_str(out, "</expr>");
+				if (symbol_prop && symbol_prop->visible.expr) {
+					out_str(out, "<visible><expr>");
+					dumpexpr(out, symbol_prop->visible.expr);
+					out_str(out, "</expr></visible>");
+				}
+				out_str(out, "</property>\n");
 			}
-			fprintf(out, "</property>\n");
 		}
 #endif
 
-		fprintf(out, "</symbol>\n");
+		if (!line_format)
+			out_str(out, "</symbol>\n");
 		//sym = sym->next;
 	//}
 }
 
-void dumpmenu(FILE *out, struct menu *menu) {
+void dumpmenu(struct output *out, struct menu *menu) {
 //	struct property *prop;
 	struct symbol *sym;
 
-	fprintf(out, "<menu flags=\"%d\">\n", menu->flags);
-	if ((sym = menu->sym))
+	if (line_format) {
+		out_str(out, "M ");
+		out_int(out, menu->flags);
+		out_str(out, " ");
+		out_int(out, menu->sym ? symbol_id(menu->sym) : -1);
+		out_expr_field(out, menu->dep);
+		out_str(out, "\n");
+		if (menu->sym && !deduplicate_symbols)
+			dumpsymbol(out, menu->sym);
+		return;
+	}
+
+	out_str(out, "<menu flags=\"");
+	out_int(out, menu->flags);
+	if (deduplicate_symbols && menu->sym) {
+		// the symbol itself is dumped in the <symbols> section
+		out_str(out, "\" symbol=\"");
+		out_int(out, symbol_id(menu->sym));
+	}
+	out_str(out, "\">\n");
+	if ((sym = menu->sym) && !deduplicate_symbols)
 			dumpsymbol(out, sym);
 //	if ((prop = menu->prompt)) {
 //			dumpprop(out, prop);
 //	}
 	if (menu->dep) {
-		fprintf(out, "<dep>");
+		out_str(out, "<dep>");
 		dumpexpr(out, menu->dep);
-		fprintf(out, "</dep>");
+		out_str(out, "</dep>");
+	}
+
+	out_str(out, "</menu>\n");
+}
+
+// registers all expressions that dumpsymbol dumps for a symbol
+void sharesymbol(struct symbol *sym) {
+	struct property *prop;
+	for (prop = sym->prop; prop; prop = prop->next) {
+		share_expr(prop->expr);
+		share_expr(prop->visible.expr);
+	}
+}
+
+// registers all expressions that dumpmenu dumps for a menu entry
+void sharemenu(struct menu *menu) {
+	if (menu->sym && !deduplicate_symbols)
+		sharesymbol(menu->sym);
+	share_expr(menu->dep);
+}
+
+// dumps all shared expressions, each after the expressions it references
+void dumpshared(struct output *out) {
+	struct menu *menu;
+	int id;
+	if (deduplicate_symbols)
+		for (id = 0; id < menu_symbols_size; id++)
+			sharesymbol(symbols_by_id[id]);
+	for (menu = rootmenu.list; menu; ) {
+		sharemenu(menu);
+		if (menu->list)
+			menu = menu->list;
+		else if (menu->next)
+			menu = menu->next;
+		else while ((menu = menu->parent)) {
+			if (menu->next) {
+				menu = menu->next;
+				break;
+			}
+		}
 	}
+	if (!line_format)
+		out_str(out, "<expressions>\n");
+	for (id = 0; id < shared_exprs_size; id++) {
+		shared_definition = shared_exprs[id].expr;
+		if (shared_expr_id(shared_definition) == -1 && shared_exprs[id].references > 1 &&
+				(shared_definition->type == E_AND || shared_definition->type == E_OR) && line_format) {
+			out_str(out, "E ");
+			out_int(out, id);
+			out_expr_field(out, shared_definition);
+			out_str(out, "\n");
+		} else if (shared_expr_id(shared_definition) == -1 && shared_exprs[id].references > 1 &&
+				(shared_definition->type == E_AND || shared_definition->type == E_OR)) {
+			out_str(out, "<expression id=\"");
+			out_int(out, id);
+			out_str(out, "\">");
+			dumpexpr(out, shared_definition);
+			out_str(out, "</expression>\n");
+		}
+	}
+	shared_definition = NULL;
+	if (!line_format)
+		out_str(out, "</expressions>\n");
+}
 
-	fprintf(out, "</menu>\n");
+// dumps each symbol that is referenced by a menu entry exactly once (for --deduplicate-symbols)
+void dumpsymbols(struct output *out) {
+	int id;
+	if (!line_format)
+		out_str(out, "<symbols>\n");
+	for (id = 0; id < menu_symbols_size; id++)
+		dumpsymbol(out, symbols_by_id[id]);
+	if (!line_format)
+		out_str(out, "</symbols>\n");
 }
 
-void myconfdump(FILE *out)
+void myconfdump(struct output *out)
 {
 	struct menu *menu;
 
 	menu = rootmenu.list;
-	fprintf(out, "<submenu>\n");
+	out_str(out, line_format ? "{\n" : "<submenu>\n");
 	while (menu) {
 		dumpmenu(out, menu);
 
 		if (menu->list) {
-			fprintf(out, "<submenu>\n");
+			out_str(out, line_format ? "{\n" : "<submenu>\n");
 			menu = menu->list;
 		}
 		else if (menu->next) {
 			menu = menu->next;
 		}
 		else while ((menu = menu->parent)) {
-			fprintf(out, "</submenu>\n");
+			out_str(out, line_format ? "}\n" : "</submenu>\n");
+			if (menu->next) {
+				menu = menu->next;
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * Extraction statistics (--stats=FILE, or the DUMPCONF_STATS environment variable).
+ * KConfigReader runs us without any options, but passes on its environment, so the variable is how torte requests them.
+ * The statistics have the same names as those of kextractor --stats and are written as a CSV header and row,
+ * or as a JSON object if FILE ends in .json.
+ */
+static const char *stats_names[] = {
+	"parse_time", "prepare_time", "emit_time",
+	"symbols_unknown", "symbols_boolean", "symbols_tristate", "symbols_int", "symbols_hex", "symbols_string", "choices",
+	"properties_unknown", "properties_prompt", "properties_comment", "properties_menu", "properties_default",
+	"properties_choice", "properties_select", "properties_imply", "properties_range", "properties_env", "properties_symbol",
+	"expression_nodes", "expression_max_depth", "output_bytes", "peak_rss", NULL
+};
+static long long stats_values[sizeof(stats_names) / sizeof(*stats_names)];
+static struct timeval phase_start;
+static long long expression_max_depth = 0;
+
+void add_stat(const char *name, long long value) {
+	int i;
+	for (i = 0; stats_names[i]; i++)
+		if (!strcmp(stats_names[i], name))
+			stats_values[i] += value;
+}
+
+// records the time since the last phase ended (or since the start) in nanoseconds, like measure in torte
+void add_phase_stat(const char *name) {
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	add_stat(name, ((long long) (now.tv_sec - phase_start.tv_sec) * 1000000 + (now.tv_usec - phase_start.tv_usec)) * 1000);
+	phase_start = now;
+}
+
+// like getSymType, but distinguishes unknown symbols (which KConfigReader treats as integers)
+const char *getStatsSymType(enum symbol_type t) {
+	switch (t) {
+#if HAS_S_BOOLEAN
+		case S_BOOLEAN: return "symbols_boolean";
+#endif
+#if HAS_S_TRISTATE
+		case S_TRISTATE: return "symbols_tristate";
+#endif
+#if HAS_S_INT
+		case S_INT: return "symbols_int";
+#endif
+#if HAS_S_HEX
+		case S_HEX: return "symbols_hex";
+#endif
+#if HAS_S_STRING
+		case S_STRING: return "symbols_string";
+#endif
+		default: return "symbols_unknown";
+	}
+}
+
+// counts the nodes of an expression and its depth, with an explicit stack for long reverse dependencies
+void count_expr(struct expr *e) {
+	static struct expr **stack = NULL;
+	static int *depths = NULL;
+	static int capacity = 0;
+	struct expr *children[2];
+	int size = 0, depth, i;
+	if (!e)
+		return;
+	if (!capacity) {
+		capacity = 256;
+		stack = malloc(capacity * sizeof(struct expr *));
+		depths = malloc(capacity * sizeof(int));
+	}
+	stack[size] = e;
+	depths[size++] = 1;
+	while (size > 0) {
+		e = stack[--size];
+		depth = depths[size];
+		add_stat("expression_nodes", 1);
+		if (depth > expression_max_depth)
+			expression_max_depth = depth;
+		children[0] = children[1] = NULL;
+		switch (e->type) {
+#if HAS_E_NOT
+		case E_NOT:
+			children[0] = e->left.expr;
+			break;
+#endif
+#if HAS_E_AND
+		case E_AND:
+			children[0] = e->left.expr;
+			children[1] = e->right.expr;
+			break;
+#endif
+#if HAS_E_OR
+		case E_OR:
+			children[0] = e->left.expr;
+			children[1] = e->right.expr;
+			break;
+#endif
+#if HAS_E_LIST
+		case E_LIST:
+			children[0] = e->left.expr;
+			break;
+#endif
+#if HAS_E_CHOICE
+		case E_CHOICE:
+			children[0] = e->left.expr;
+			break;
+#endif
+		default:
+			break;
+		}
+		if (size + 2 > capacity) {
+			capacity *= 2;
+			stack = realloc(stack, capacity * sizeof(struct expr *));
+			depths = realloc(depths, capacity * sizeof(int));
+		}
+		for (i = 0; i < 2; i++)
+			if (children[i]) {
+				stack[size] = children[i];
+				depths[size++] = depth + 1;
+			}
+	}
+}
+
+// counts the symbols, properties, and expressions that we dump
+void collectstats(struct output *out) {
+	char name[64];
+	struct property *prop;
+	struct symbol *sym;
+	struct menu *menu;
+	struct rusage usage;
+	int id;
+	for (id = 0; id < symbols_by_id_size; id++) {
+		sym = symbols_by_id[id];
+		if (sym->flags & SYMBOL_CONST)
+			continue;
+		add_stat(getStatsSymType(sym->type), 1);
+		if (sym_is_choice(sym))
+			add_stat("choices", 1);
+		for (prop = sym->prop; prop; prop = prop->next) {
+			snprintf(name, sizeof(name), "properties_%s",
+				strcmp(getPropType(prop->type), "?") ? getPropType(prop->type) : "unknown");
+			add_stat(name, 1);
+			count_expr(prop->expr);
+			count_expr(prop->visible.expr);
+		}
+	}
+	for (menu = rootmenu.list; menu; ) {
+		count_expr(menu->dep);
+		if (menu->list)
+			menu = menu->list;
+		else if (menu->next)
+			menu = menu->next;
+		else while ((menu = menu->parent)) {
 			if (menu->next) {
 				menu = menu->next;
 				break;
 			}
 		}
 	}
+	add_stat("expression_max_depth", expression_max_depth);
+	add_stat("output_bytes", out->bytes);
+	getrusage(RUSAGE_SELF, &usage);
+	add_stat("peak_rss", (long long) usage.ru_maxrss * 1024);
+}
+
+void dumpstats(struct output *out, int json) {
+	char buffer[32];
+	int i;
+	if (json)
+		out_str(out, "{");
+	for (i = 0; stats_names[i]; i++) {
+		if (i > 0)
+			out_str(out, json ? ", " : ",");
+		if (json)
+			out_str(out, "\"");
+		out_str(out, stats_names[i]);
+		if (json) {
+			sprintf(buffer, "\": %lld", stats_values[i]);
+			out_str(out, buffer);
+		}
+	}
+	if (!json) {
+		out_str(out, "\n");
+		for (i = 0; stats_names[i]; i++) {
+			sprintf(buffer, i == 0 ? "%lld" : ",%lld", stats_values[i]);
+			out_str(out, buffer);
+		}
+	}
+	out_str(out, json ? "}\n" : "\n");
 }
 
 int main(int ac, char **av)
 {
 	struct stat tmpstat;
+	struct output out = { stdout };
+	char *symbol_table_file = NULL, *output_file = NULL, *manifest_file = getenv("DUMPCONF_MANIFEST"), *stats_file = getenv("DUMPCONF_STATS");
+	int manifest_only = 0;
 
+	PHASE_BEGIN(PHASE_DUMPCONF);
 	setlocale(LC_ALL, "");
 
+	// usage: dumpconf [--shared-expressions] [--deduplicate-symbols] [--format=xml|lines] [--stdio] [--symbol-table=FILE]
+	//                 [--output=FILE] [--compress=gzip|zstd] [--manifest=FILE] [--stats=FILE] Kconfig
+	for (; ac > 2 && !strncmp(av[1], "--", 2); ac--, av++) {
+		if (!strcmp(av[1], "--shared-expressions"))
+			shared_expressions = 1;
+		else if (!strcmp(av[1], "--deduplicate-symbols"))
+			deduplicate_symbols = 1;
+		else if (!strcmp(av[1], "--format=xml"))
+			line_format = 0;
+		else if (!strcmp(av[1], "--format=lines"))
+			line_format = 1;
+		else if (!strcmp(av[1], "--stdio"))
+			stdio_output = 1;
+		else if (!strncmp(av[1], "--symbol-table=", strlen("--symbol-table=")))
+			symbol_table_file = av[1] + strlen("--symbol-table=");
+		else if (!strncmp(av[1], "--output=", strlen("--output=")))
+			output_file = av[1] + strlen("--output=");
+		else if (!strncmp(av[1], "--manifest=", strlen("--manifest="))) {
+			manifest_file = av[1] + strlen("--manifest=");
+			manifest_only = 1;
+		} else if (!strncmp(av[1], "--stats=", strlen("--stats=")))
+			stats_file = av[1] + strlen("--stats=");
+		else if (!strcmp(av[1], "--compress=gzip") || !strcmp(av[1], "--compress=zstd"))
+			compression = av[1] + strlen("--compress=");
+		else {
+			fprintf(stderr, "unknown option %s\n", av[1]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
 	if (stat(av[1], &tmpstat) != 0) {
 		fprintf(stderr, "could not open %s\n", av[1]);
 		exit(EXIT_FAILURE);
 	}
 
+	if (output_file && !open_output_file(&out, output_file)) {
+		fprintf(stderr, "could not open %s for writing\n", output_file);
+		exit(EXIT_FAILURE);
+	}
+
+	gettimeofday(&phase_start, NULL);
+	PHASE_BEGIN(PHASE_PARSE);
 	conf_parse(av[1]);
-	fprintf(stdout, "\n.\n");
-	myconfdump(stdout);
+	PHASE_END(PHASE_PARSE);
+	add_phase_stat("parse_time");
+	PHASE_BEGIN(PHASE_PREPARE);
+	number_symbols();
+	PHASE_END(PHASE_PREPARE);
+	add_phase_stat("prepare_time");
+	PHASE_BEGIN(PHASE_EMIT);
+	if (symbol_table_file) {
+		struct output table = { NULL };
+		if (!open_output_file(&table, symbol_table_file)) {
+			fprintf(stderr, "could not open %s for writing\n", symbol_table_file);
+			exit(EXIT_FAILURE);
+		}
+		dumpsymboltable(&table);
+		close_output_file(&table);
+	}
+	if (manifest_file && *manifest_file) {
+		struct output manifest = { NULL };
+		if (!open_output_file(&manifest, manifest_file)) {
+			fprintf(stderr, "could not open %s for writing\n", manifest_file);
+			exit(EXIT_FAILURE);
+		}
+		dumpmanifest(&manifest);
+		close_output_file(&manifest);
+		if (manifest_only && !output_file && !symbol_table_file) {
+			PHASE_END(PHASE_EMIT);
+			PHASE_END(PHASE_DUMPCONF);
+			PHASE_REPORT();
+			return 0;
+		}
+	}
+	out_str(&out, "\n.\n");
+	if (shared_expressions) {
+		PHASE_BEGIN(PHASE_EXPRESSIONS);
+		dumpshared(&out);
+		PHASE_END(PHASE_EXPRESSIONS);
+	}
+	if (deduplicate_symbols) {
+		PHASE_BEGIN(PHASE_SYMBOLS);
+		dumpsymbols(&out);
+		PHASE_END(PHASE_SYMBOLS);
+	}
+	// without --deduplicate-symbols, the symbols are dumped with their menu entries
+	PHASE_BEGIN(PHASE_MENUS);
+	myconfdump(&out);
+	PHASE_END(PHASE_MENUS);
+	PHASE_END(PHASE_EMIT);
+	PHASE_BEGIN(PHASE_FLUSH);
+	if (output_file)
+		close_output_file(&out);
+	else
+		output_flush(&out);
+	PHASE_END(PHASE_FLUSH);
+	add_phase_stat("emit_time");
+	if (stats_file && *stats_file) {
+		struct output stats = { NULL };
+		size_t size = strlen(stats_file);
+		if (!open_output_file(&stats, stats_file)) {
+			fprintf(stderr, "could not open %s for writing\n", stats_file);
+			exit(EXIT_FAILURE);
+		}
+		collectstats(&out);
+		dumpstats(&stats, size > strlen(".json") && !strcmp(stats_file + size - strlen(".json"), ".json"));
+		close_output_file(&stats);
+	}
+	PHASE_END(PHASE_DUMPCONF);
+	PHASE_REPORT();
 	return 0;
 }
@@ -0,0 +1,820 @@
+/*
+ * Transforms KConfigReader's .model files into DIMACS, one constraint at a time, so memory is bounded by the longest
+ * constraint and the number of named variables (unlike TransformIntoDIMACS.scala, which keeps all constraints on the heap).
+ * Each line either declares a feature (#item NAME) or is a constraint over def(NAME), !, &, |, =>, <=>, 0, 1, and parentheses.
+ *
+ * Each constraint is converted into negation normal form and split into its top-level conjuncts, which are then encoded
+ * - distributively, which needs no auxiliary variables, but may yield exponentially many clauses,
+ * - with Plaisted and Greenbaum's encoding, which introduces an auxiliary variable for each nested subformula,
+ *   but only needs one direction of its definition (this preserves satisfiability, as in KConfigReader), or
+ * - with Tseitin's encoding, which defines auxiliary variables by equivalences (this also preserves the model count).
+ * By default, each conjunct is distributed if that predicts no more clauses than the auxiliary encoding (--distributive auto).
+ * Only named variables get a c line, as the names of .model files may look like auxiliary variables (e.g., k!<index> from
+ * kextractor --choice-encoding), and only features (#item) are projected onto (c p show), as in kextractor --dimacs.
+ * Unparseable lines are reported and skipped, and the exit status is nonzero if there are any.
+ *
+ * usage: model2dimacs [--encoding plaisted-greenbaum|tseitin] [--distributive auto|always|never] MODEL DIMACS
+ */
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum expr_type {
+  E_VAR,
+  E_NOT,
+  E_AND,
+  E_OR,
+  E_IMPLIES,
+  E_EQUIV,
+  E_TRUE,
+  E_FALSE,
+};
+
+/* A parsed constraint, where conjunctions and disjunctions have any number of operands */
+struct expr {
+  enum expr_type type;
+  int variable;
+  int operands, operands_size; // into expr_operands
+};
+
+/* A formula in negation normal form, which consists of literals, conjunctions, disjunctions, and constants */
+struct nnf {
+  enum expr_type type; // E_VAR (a literal), E_AND, E_OR, E_TRUE, or E_FALSE
+  int literal;
+  int children, children_size; // into nnf_children
+};
+
+enum distributive_mode {
+  DISTRIBUTIVE_AUTO,
+  DISTRIBUTIVE_ALWAYS,
+  DISTRIBUTIVE_NEVER,
+};
+
+static bool tseitin = false;
+static enum distributive_mode distributive = DISTRIBUTIVE_AUTO;
+
+// all arrays below grow to the size of the longest constraint and are reused for every line
+static struct expr *exprs = NULL;
+static int exprs_size = 0, exprs_capacity = 0;
+static int *expr_operands = NULL, expr_operands_size = 0, expr_operands_capacity = 0;
+static int *operand_stack = NULL, operand_stack_size = 0, operand_stack_capacity = 0;
+static struct nnf *nnfs = NULL;
+static int nnfs_size = 0, nnfs_capacity = 0;
+static int *nnf_children = NULL, nnf_children_size = 0, nnf_children_capacity = 0;
+static int *nnf_stack = NULL, nnf_stack_size = 0, nnf_stack_capacity = 0;
+static int *literals = NULL, literals_size = 0, literals_capacity = 0;
+static int *pending = NULL, pending_size = 0, pending_capacity = 0;
+static int *trail = NULL, trail_size = 0, trail_capacity = 0;
+static signed char *marks = NULL; // the sign of each variable in the clause that is currently distributed
+static int marks_capacity = 0;
+
+// variables are numbered from 1, only the names of named variables are kept (in the order of their indices)
+static int variables_size = 0;
+static char **names = NULL;
+static int *named_variables = NULL, names_size = 0, names_capacity = 0;
+static bool *items = NULL; // whether each name has been declared as a feature
+static int *name_slots = NULL; // hashed names (open addressing, indices into names, -1 marks a free slot)
+static size_t name_slots_size = 0;
+
+static FILE *clauses_file;
+static long long clauses = 0, distributed = 0, auxiliary = 0, errors = 0;
+
+/* Make room for one more element in a growing array */
+static void *grow_array(void *array, int size, int *capacity, size_t element_size)
+{
+  if (size == *capacity) {
+    *capacity = *capacity ? 2 * *capacity : 1024;
+    array = realloc(array, *capacity * element_size);
+    if (!array) {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+  }
+  return array;
+}
+
+static size_t hash_name(const char *name, size_t size)
+{
+  size_t hash = 5381;
+
+  while (size--)
+    hash = hash * 33 + (unsigned char) *name++;
+  return hash;
+}
+
+/* Return the variable with the given name, adding it if needed */
+static int named_variable(const char *name, size_t size, bool item)
+{
+  size_t slot, i;
+  int *slots;
+
+  if (2 * (size_t) names_size >= name_slots_size) {
+    slots = name_slots;
+    name_slots_size = name_slots_size ? 2 * name_slots_size : 4096;
+    name_slots = malloc(name_slots_size * sizeof(int));
+    memset(name_slots, -1, name_slots_size * sizeof(int));
+    for (i = 0; slots && i < name_slots_size / 2; i++)
+      if (slots[i] != -1) {
+        for (slot = hash_name(names[slots[i]], strlen(names[slots[i]])) & (name_slots_size - 1); name_slots[slot] != -1;
+             slot = (slot + 1) & (name_slots_size - 1))
+          ;
+        name_slots[slot] = slots[i];
+      }
+    free(slots);
+  }
+  for (slot = hash_name(name, size) & (name_slots_size - 1); name_slots[slot] != -1; slot = (slot + 1) & (name_slots_size - 1))
+    if (!strncmp(names[name_slots[slot]], name, size) && names[name_slots[slot]][size] == '\0') {
+      items[name_slots[slot]] |= item;
+      return named_variables[name_slots[slot]];
+    }
+  if (names_size == names_capacity) {
+    names = grow_array(names, names_size, &names_capacity, sizeof(char *));
+    named_variables = realloc(named_variables, names_capacity * sizeof(int));
+    items = realloc(items, names_capacity * sizeof(bool));
+  }
+  names[names_size] = strndup(name, size);
+  named_variables[names_size] = ++variables_size;
+  items[names_size] = item;
+  name_slots[slot] = names_size++;
+  return variables_size;
+}
+
+static int auxiliary_variable(void)
+{
+  return ++variables_size;
+}
+
+static void write_int(FILE *out, long long value)
+{
+  char buffer[24], *p = buffer + sizeof(buffer);
+  unsigned long long magnitude = value < 0 ? -(unsigned long long) value : (unsigned long long) value;
+
+  do {
+    *--p = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude);
+  if (value < 0)
+    *--p = '-';
+  fwrite(p, 1, buffer + sizeof(buffer) - p, out);
+}
+
+static void write_clause(const int *clause, int size)
+{
+  int i;
+
+  for (i = 0; i < size; i++) {
+    write_int(clauses_file, clause[i]);
+    putc(' ', clauses_file);
+  }
+  fputs("0\n", clauses_file);
+  clauses++;
+}
+
+/*
+ * Parsing.
+ * Conjunctions and disjunctions are collected into a single node, so only parentheses and negations nest the parser.
+ */
+struct parser {
+  const char *p;
+  bool failed;
+};
+
+static int new_expr(enum expr_type type, int variable)
+{
+  exprs = grow_array(exprs, exprs_size, &exprs_capacity, sizeof(struct expr));
+  exprs[exprs_size].type = type;
+  exprs[exprs_size].variable = variable;
+  exprs[exprs_size].operands = exprs[exprs_size].operands_size = 0;
+  return exprs_size++;
+}
+
+static void push_operand(int e)
+{
+  operand_stack = grow_array(operand_stack, operand_stack_size, &operand_stack_capacity, sizeof(int));
+  operand_stack[operand_stack_size++] = e;
+}
+
+/* Turn the operands pushed since base into a single node */
+static int pop_operands(enum expr_type type, int base)
+{
+  int e, i;
+
+  if (operand_stack_size - base == 1)
+    return operand_stack[--operand_stack_size];
+  e = new_expr(type, 0);
+  exprs[e].operands = expr_operands_size;
+  exprs[e].operands_size = operand_stack_size - base;
+  for (i = base; i < operand_stack_size; i++) {
+    expr_operands = grow_array(expr_operands, expr_operands_size, &expr_operands_capacity, sizeof(int));
+    expr_operands[expr_operands_size++] = operand_stack[i];
+  }
+  operand_stack_size = base;
+  return e;
+}
+
+static void skip_space(struct parser *parser)
+{
+  while (*parser->p == ' ' || *parser->p == '\t' || *parser->p == '\r' || *parser->p == '\n')
+    parser->p++;
+}
+
+/* Consume the given token, if it comes next */
+static bool accept(struct parser *parser, const char *token)
+{
+  skip_space(parser);
+  if (strncmp(parser->p, token, strlen(token)))
+    return false;
+  parser->p += strlen(token);
+  return true;
+}
+
+static int parse_equivalence(struct parser *parser);
+
+static int parse_unary(struct parser *parser)
+{
+  const char *name;
+  int e, negation;
+
+  if (parser->failed)
+    return new_expr(E_FALSE, 0);
+  if (accept(parser, "!")) {
+    e = parse_unary(parser);
+    negation = new_expr(E_NOT, 0);
+    exprs[negation].operands = e;
+    return negation;
+  }
+  if (accept(parser, "(")) {
+    e = parse_equivalence(parser);
+    if (!accept(parser, ")"))
+      parser->failed = true;
+    return e;
+  }
+  if (accept(parser, "def(") || accept(parser, "defined(")) {
+    skip_space(parser);
+    name = parser->p;
+    while (*parser->p && *parser->p != ')')
+      parser->p++;
+    if (*parser->p != ')' || parser->p == name) {
+      parser->failed = true;
+      return new_expr(E_FALSE, 0);
+    }
+    e = new_expr(E_VAR, named_variable(name, parser->p - name, false));
+    parser->p++;
+    return e;
+  }
+  if (accept(parser, "1"))
+    return new_expr(E_TRUE, 0);
+  if (accept(parser, "0"))
+    return new_expr(E_FALSE, 0);
+  parser->failed = true;
+  return new_expr(E_FALSE, 0);
+}
+
+static int parse_conjunction(struct parser *parser)
+{
+  int base = operand_stack_size;
+
+  push_operand(parse_unary(parser));
+  while (!parser->failed && (accept(parser, "&&") || accept(parser, "&")))
+    push_operand(parse_unary(parser));
+  return pop_operands(E_AND, base);
+}
+
+static int parse_disjunction(struct parser *parser)
+{
+  int base = operand_stack_size;
+
+  push_operand(parse_conjunction(parser));
+  while (!parser->failed && (accept(parser, "||") || accept(parser, "|")))
+    push_operand(parse_conjunction(parser));
+  return pop_operands(E_OR, base);
+}
+
+static int parse_implication(struct parser *parser)
+{
+  int base = operand_stack_size;
+
+  push_operand(parse_disjunction(parser));
+  if (parser->failed || !accept(parser, "=>"))
+    return operand_stack[--operand_stack_size];
+  push_operand(parse_implication(parser));
+  return pop_operands(E_IMPLIES, base);
+}
+
+static int parse_equivalence(struct parser *parser)
+{
+  int base = operand_stack_size, e;
+
+  e = parse_implication(parser);
+  while (!parser->failed && accept(parser, "<=>")) {
+    push_operand(e);
+    push_operand(parse_implication(parser));
+    e = pop_operands(E_EQUIV, base);
+  }
+  return e;
+}
+
+/*
+ * Negation normal form.
+ * Negations are pushed down to the variables, and nested conjunctions (or disjunctions) are merged into their parents,
+ * whose operands are pushed onto nnf_stack directly, so that merging takes linear time.
+ */
+static int new_nnf(enum expr_type type, int literal)
+{
+  nnfs = grow_array(nnfs, nnfs_size, &nnfs_capacity, sizeof(struct nnf));
+  nnfs[nnfs_size].type = type;
+  nnfs[nnfs_size].literal = literal;
+  nnfs[nnfs_size].children = nnfs[nnfs_size].children_size = 0;
+  return nnfs_size++;
+}
+
+static void push_nnf(int n)
+{
+  nnf_stack = grow_array(nnf_stack, nnf_stack_size, &nnf_stack_capacity, sizeof(int));
+  nnf_stack[nnf_stack_size++] = n;
+}
+
+/* Combine the formulas pushed since base into a conjunction or disjunction, folding constants */
+static int combine_nnfs(enum expr_type type, int base)
+{
+  enum expr_type absorbing = type == E_AND ? E_FALSE : E_TRUE, neutral = type == E_AND ? E_TRUE : E_FALSE;
+  int n, i, size = 0;
+
+  for (i = base; i < nnf_stack_size; i++) {
+    if (nnfs[nnf_stack[i]].type == absorbing) {
+      nnf_stack_size = base;
+      return new_nnf(absorbing, 0);
+    }
+    if (nnfs[nnf_stack[i]].type != neutral)
+      nnf_stack[base + size++] = nnf_stack[i];
+  }
+  nnf_stack_size = base + size;
+  if (size == 0)
+    n = new_nnf(neutral, 0);
+  else if (size == 1)
+    n = nnf_stack[base];
+  else {
+    n = new_nnf(type, 0);
+    nnfs[n].children = nnf_children_size;
+    nnfs[n].children_size = size;
+    for (i = base; i < nnf_stack_size; i++) {
+      nnf_children = grow_array(nnf_children, nnf_children_size, &nnf_children_capacity, sizeof(int));
+      nnf_children[nnf_children_size++] = nnf_stack[i];
+    }
+  }
+  nnf_stack_size = base;
+  return n;
+}
+
+static void push_nnf_of(int e, bool negated, enum expr_type parent_type);
+
+/* Push the operands of a conjunction or disjunction, which are merged into the parent if it has the same type */
+static void push_junction(enum expr_type type, const int *operands, const bool *negated, int size, enum expr_type parent_type)
+{
+  int base = nnf_stack_size, i;
+
+  for (i = 0; i < size; i++)
+    push_nnf_of(operands[i], negated[i], type);
+  if (type != parent_type)
+    push_nnf(combine_nnfs(type, base));
+}
+
+/* Push the negation normal form of an expression as operands of a parent of the given type */
+static void push_nnf_of(int e, bool negated, enum expr_type parent_type)
+{
+  struct expr *expr = &exprs[e];
+  enum expr_type type;
+  int operands[2], base, i;
+  bool signs[2];
+
+  switch (expr->type) {
+  case E_VAR:
+    push_nnf(new_nnf(E_VAR, negated ? -expr->variable : expr->variable));
+    break;
+  case E_TRUE:
+  case E_FALSE:
+    push_nnf(new_nnf((expr->type == E_TRUE) != negated ? E_TRUE : E_FALSE, 0));
+    break;
+  case E_NOT:
+    push_nnf_of(expr->operands, !negated, parent_type);
+    break;
+  case E_AND:
+  case E_OR:
+    type = (expr->type == E_AND) != negated ? E_AND : E_OR;
+    base = nnf_stack_size;
+    for (i = 0; i < expr->operands_size; i++)
+      push_nnf_of(expr_operands[expr->operands + i], negated, type);
+    if (type != parent_type)
+      push_nnf(combine_nnfs(type, base));
+    break;
+  case E_IMPLIES:
+    // a => b is !a | b, and its negation is a & !b
+    operands[0] = expr_operands[expr->operands];
+    operands[1] = expr_operands[expr->operands + 1];
+    signs[0] = !negated;
+    signs[1] = negated;
+    push_junction(negated ? E_AND : E_OR, operands, signs, 2, parent_type);
+    break;
+  case E_EQUIV:
+    // a <=> b is (a & b) | (!a & !b), and its negation is (a & !b) | (!a & b)
+    base = nnf_stack_size;
+    for (i = 0; i < 2; i++) {
+      operands[0] = expr_operands[expr->operands];
+      operands[1] = expr_operands[expr->operands + 1];
+      signs[0] = i == 1;
+      signs[1] = (i == 1) != negated;
+      push_junction(E_AND, operands, signs, 2, E_OR);
+    }
+    if (parent_type != E_OR)
+      push_nnf(combine_nnfs(E_OR, base));
+    break;
+  }
+}
+
+/*
+ * Encodings.
+ * Clause counts are predicted with saturating arithmetic, as distributing a formula may yield astronomically many clauses.
+ */
+#define COUNT_MAX (1LL << 60)
+
+static long long add_counts(long long a, long long b)
+{
+  return a + b > COUNT_MAX ? COUNT_MAX : a + b;
+}
+
+static long long multiply_counts(long long a, long long b)
+{
+  return a != 0 && b > COUNT_MAX / a ? COUNT_MAX : a * b;
+}
+
+/* The number of clauses of the distributive encoding (without removing tautologies and subsumed clauses) */
+static long long distributive_clauses(int n)
+{
+  struct nnf *nnf = &nnfs[n];
+  long long count;
+  int i;
+
+  if (nnf->type == E_VAR)
+    return 1;
+  count = nnf->type == E_AND ? 0 : 1;
+  for (i = 0; i < nnf->children_size; i++)
+    count = nnf->type == E_AND ? add_counts(count, distributive_clauses(nnf_children[nnf->children + i]))
+      : multiply_counts(count, distributive_clauses(nnf_children[nnf->children + i]));
+  return count;
+}
+
+/* The number of clauses that define the auxiliary variables of a formula and its subformulas */
+static long long definition_clauses(int n)
+{
+  struct nnf *nnf = &nnfs[n];
+  long long count;
+  int i;
+
+  if (nnf->type != E_AND && nnf->type != E_OR)
+    return 0;
+  // an auxiliary conjunction implies each operand, an auxiliary disjunction implies the disjunction of its operands
+  count = nnf->type == E_AND ? nnf->children_size : 1;
+  if (tseitin)
+    count += nnf->type == E_AND ? 1 : nnf->children_size;
+  for (i = 0; i < nnf->children_size; i++)
+    count = add_counts(count, definition_clauses(nnf_children[nnf->children + i]));
+  return count;
+}
+
+/* The number of clauses of the auxiliary encoding of a top-level conjunct, which needs no auxiliary variable itself */
+static long long auxiliary_clauses(int n)
+{
+  struct nnf *nnf = &nnfs[n];
+  long long count = 1;
+  int i;
+
+  if (nnf->type != E_OR)
+    return nnf->type == E_VAR ? 1 : add_counts(definition_clauses(n), 1);
+  for (i = 0; i < nnf->children_size; i++)
+    count = add_counts(count, definition_clauses(nnf_children[nnf->children + i]));
+  return count;
+}
+
+static void push_literal(int literal)
+{
+  literals = grow_array(literals, literals_size, &literals_capacity, sizeof(int));
+  literals[literals_size++] = literal;
+}
+
+/* Return a literal equivalent to (or, with Plaisted-Greenbaum, implying) a formula, defining auxiliary variables as needed */
+static int auxiliary_literal(int n)
+{
+  struct nnf *nnf = &nnfs[n];
+  int base = literals_size, gate, i;
+
+  if (nnf->type == E_VAR)
+    return nnf->literal;
+  for (i = 0; i < nnf->children_size; i++) {
+    int literal = auxiliary_literal(nnf_children[nnf->children + i]);
+    push_literal(literal);
+  }
+  gate = auxiliary_variable();
+  if (nnf->type == E_AND) {
+    // gate -> (l1 & ... & ln), and with Tseitin also (l1 & ... & ln) -> gate
+    for (i = base; i < literals_size; i++) {
+      int clause[] = { -gate, literals[i] };
+      write_clause(clause, 2);
+    }
+    if (tseitin) {
+      for (i = base; i < literals_size; i++)
+        literals[i] = -literals[i];
+      push_literal(gate);
+      write_clause(literals + base, literals_size - base);
+    }
+  } else {
+    // gate -> (l1 | ... | ln), and with Tseitin also (l1 | ... | ln) -> gate
+    if (tseitin)
+      for (i = base; i < literals_size; i++) {
+        int clause[] = { gate, -literals[i] };
+        write_clause(clause, 2);
+      }
+    push_literal(-gate);
+    write_clause(literals + base, literals_size - base);
+  }
+  literals_size = base;
+  return gate;
+}
+
+static void encode_auxiliary(int n)
+{
+  struct nnf *nnf = &nnfs[n];
+  int i;
+
+  if (nnf->type != E_OR) {
+    i = auxiliary_literal(n);
+    write_clause(&i, 1);
+    return;
+  }
+  for (i = 0; i < nnf->children_size; i++) {
+    int literal = auxiliary_literal(nnf_children[nnf->children + i]);
+    push_literal(literal);
+  }
+  write_clause(literals, literals_size);
+  literals_size = 0;
+}
+
+static void push_pending(int n)
+{
+  pending = grow_array(pending, pending_size, &pending_capacity, sizeof(int));
+  pending[pending_size++] = n;
+}
+
+/*
+ * Write the clauses of the disjunction of the current clause (literals) and all pending formulas.
+ * Literals and disjunctions are added to the clause in a loop, and each conjunction branches into one call per operand,
+ * so the recursion is only as deep as the number of conjunctions on a path. Afterwards, the pending formulas are restored.
+ */
+static void distribute(void)
+{
+  int low = pending_size, trail_base = trail_size, clause_base = literals_size;
+  int n, variable, i;
+  bool tautology = false;
+
+  while (pending_size > 0 && !tautology) {
+    n = pending[--pending_size];
+    // formulas that were pending before this call are overwritten below, so we remember them
+    if (pending_size < low) {
+      low = pending_size;
+      trail = grow_array(trail, trail_size, &trail_capacity, sizeof(int));
+      trail[trail_size++] = n;
+    }
+    switch (nnfs[n].type) {
+    case E_VAR:
+      variable = abs(nnfs[n].literal);
+      if (marks[variable] == 0) {
+        marks[variable] = nnfs[n].literal > 0 ? 1 : -1;
+        push_literal(nnfs[n].literal);
+      } else if (marks[variable] != (nnfs[n].literal > 0 ? 1 : -1))
+        tautology = true;
+      break;
+    case E_OR:
+      for (i = 0; i < nnfs[n].children_size; i++)
+        push_pending(nnf_children[nnfs[n].children + i]);
+      break;
+    case E_AND:
+      for (i = 0; i < nnfs[n].children_size; i++) {
+        push_pending(nnf_children[nnfs[n].children + i]);
+        distribute();
+        pending_size--;
+      }
+      tautology = true; // all clauses have been written by the branches
+      break;
+    default:
+      break; // constants have been folded
+    }
+  }
+  if (!tautology)
+    write_clause(literals, literals_size);
+
+  for (i = clause_base; i < literals_size; i++)
+    marks[abs(literals[i])] = 0;
+  literals_size = clause_base;
+  pending_size = low;
+  while (trail_size > trail_base)
+    pending[pending_size++] = trail[--trail_size];
+}
+
+static void encode_distributive(int n)
+{
+  if (variables_size >= marks_capacity) {
+    marks = realloc(marks, 2 * (variables_size + 1));
+    memset(marks + marks_capacity, 0, 2 * (variables_size + 1) - marks_capacity);
+    marks_capacity = 2 * (variables_size + 1);
+  }
+  push_pending(n);
+  distribute();
+  pending_size = 0;
+}
+
+/* Encode a top-level conjunct with the encoding that predicts fewer clauses */
+static void encode_conjunct(int n)
+{
+  int variable;
+
+  if (nnfs[n].type == E_TRUE)
+    return;
+  if (nnfs[n].type == E_FALSE) {
+    // a contradiction is encoded with a fixed auxiliary variable, as in kextractor --dimacs
+    variable = auxiliary_variable();
+    write_clause(&variable, 1);
+    variable = -variable;
+    write_clause(&variable, 1);
+    return;
+  }
+  if (distributive == DISTRIBUTIVE_ALWAYS ||
+      (distributive == DISTRIBUTIVE_AUTO && distributive_clauses(n) <= auxiliary_clauses(n))) {
+    encode_distributive(n);
+    distributed++;
+  } else {
+    encode_auxiliary(n);
+    auxiliary++;
+  }
+}
+
+static void transform_line(const char *line, long long line_number)
+{
+  struct parser parser = { line, false };
+  int e, n, i;
+
+  exprs_size = expr_operands_size = operand_stack_size = nnfs_size = nnf_children_size = nnf_stack_size = 0;
+  e = parse_equivalence(&parser);
+  skip_space(&parser);
+  if (parser.failed || *parser.p) {
+    fprintf(stderr, "could not parse constraint in line %lld: %.100s\n", line_number, line);
+    errors++;
+    return;
+  }
+  push_nnf_of(e, false, E_AND);
+  n = combine_nnfs(E_AND, 0);
+  if (nnfs[n].type != E_AND) {
+    encode_conjunct(n);
+    return;
+  }
+  for (i = 0; i < nnfs[n].children_size; i++)
+    encode_conjunct(nnf_children[nnfs[n].children + i]);
+}
+
+/* Write the names of all named variables, the projection onto all features, the problem line, and all clauses */
+static void write_dimacs(FILE *out)
+{
+  char buffer[1 << 16];
+  size_t size;
+  int name;
+
+  for (name = 0; name < names_size; name++) {
+    fputs("c ", out);
+    write_int(out, named_variables[name]);
+    putc(' ', out);
+    fputs(names[name], out);
+    putc('\n', out);
+  }
+  fputs("c p show", out);
+  for (name = 0; name < names_size; name++)
+    if (items[name]) {
+      putc(' ', out);
+      write_int(out, named_variables[name]);
+    }
+  fputs(" 0\np cnf ", out);
+  write_int(out, variables_size);
+  putc(' ', out);
+  write_int(out, clauses);
+  putc('\n', out);
+  rewind(clauses_file);
+  while ((size = fread(buffer, 1, sizeof(buffer), clauses_file)) > 0)
+    fwrite(buffer, 1, size, out);
+}
+
+static void print_usage(const char *progname)
+{
+  printf("USAGE\n");
+  printf("%s [options] MODEL DIMACS\n", progname);
+  printf("\n");
+  printf("OPTIONS\n");
+  printf("--encoding plaisted-greenbaum|tseitin\n"
+         "\t\tencode subformulas with auxiliary variables that imply them (default, preserves satisfiability)\n"
+         "\t\tor that are equivalent to them (preserves the model count)\n");
+  printf("--distributive auto|always|never\n"
+         "\t\tdistribute each conjunct if that predicts no more clauses (default), always, or never\n");
+  printf("-h, --help\tdisplay this help message\n");
+  exit(0);
+}
+
+int main(int argc, char **argv)
+{
+  static struct option long_options[] = {
+    {"encoding", required_argument, 0, 'e'},
+    {"distributive", required_argument, 0, 'd'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  FILE *in, *out;
+  char *line = NULL, *p;
+  size_t len = 0;
+  ssize_t read;
+  long long line_number = 0;
+  int opt;
+
+  while ((opt = getopt_long(argc, argv, "e:d:h", long_options, NULL)) != -1) {
+    switch (opt) {
+    case 'e':
+      if (strcmp(optarg, "plaisted-greenbaum") && strcmp(optarg, "tseitin")) {
+        fprintf(stderr, "Unknown encoding %s.  For help use -h\n", optarg);
+        exit(1);
+      }
+      tseitin = !strcmp(optarg, "tseitin");
+      break;
+    case 'd':
+      if (!strcmp(optarg, "auto"))
+        distributive = DISTRIBUTIVE_AUTO;
+      else if (!strcmp(optarg, "always"))
+        distributive = DISTRIBUTIVE_ALWAYS;
+      else if (!strcmp(optarg, "never"))
+        distributive = DISTRIBUTIVE_NEVER;
+      else {
+        fprintf(stderr, "Unknown distributive mode %s.  For help use -h\n", optarg);
+        exit(1);
+      }
+      break;
+    case 'h':
+      print_usage(argv[0]);
+      break;
+    default:
+      fprintf(stderr, "Invalid option or missing argument.  For help use -h\n");
+      exit(1);
+    }
+  }
+  if (optind != argc - 2) {
+    fprintf(stderr, "Please specify a model and a DIMACS file.  For help use -h.\n");
+    exit(1);
+  }
+  if (!strcmp(argv[optind], "-"))
+    in = stdin;
+  else if ((in = fopen(argv[optind], "r")) == NULL) {
+    perror(argv[optind]);
+    exit(1);
+  }
+  // the problem line precedes the clauses, so they are collected in a temporary file until their number is known
+  if ((clauses_file = tmpfile()) == NULL) {
+    perror("tmpfile");
+    exit(1);
+  }
+
+  while ((read = getline(&line, &len, in)) != -1) {
+    line_number++;
+    while (read > 0 && (line[read - 1] == '\n' || line[read - 1] == '\r'))
+      line[--read] = '\0';
+    for (p = line; *p == ' ' || *p == '\t'; p++)
+      ;
+    if (!strncmp(p, "#item ", strlen("#item "))) {
+      p += strlen("#item ");
+      named_variable(p, strlen(p), true);
+    } else if (*p && *p != '#')
+      transform_line(p, line_number);
+  }
+  free(line);
+  if (in != stdin)
+    fclose(in);
+
+  if (!strcmp(argv[optind + 1], "-"))
+    out = stdout;
+  else if ((out = fopen(argv[optind + 1], "w")) == NULL) {
+    fprintf(stderr, "can't open %s for writing\n", argv[optind + 1]);
+    exit(1);
+  }
+  write_dimacs(out);
+  if (fclose(out) != 0 || ferror(clauses_file)) {
+    perror("write");
+    exit(1);
+  }
+  fclose(clauses_file);
+  fprintf(stderr, "%d variables, %lld clauses, %lld conjuncts distributed, %lld with auxiliary variables, %lld unparseable lines\n",
+          variables_size, clauses, distributed, auxiliary, errors);
+  return errors > 0 ? 1 : 0;
+}
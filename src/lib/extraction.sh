@@ -5,6 +5,8 @@ LKC_BINDINGS_DIRECTORY=lkc-bindings # output directory for storing LKC bindings
 LKC_BINDINGS_OUTPUT_CSV=lkc-bindings.csv # output CSV file for storing LKC binding information
 UVL_INPUT_KEY=uvl # the name of the input key to access flat UVL feature model files
 UNCONSTRAINED_FEATURES_INPUT_KEY=unconstrained_features # the name of the input key to access unconstrained feature files
+KCONFIG_MANIFESTS_OUTPUT_CSV=kconfig-manifests.csv # output CSV file mapping manifests of parsed Kconfig files to extracted models
+KCONFIG_MODEL_EXTENSIONS=(model features rsf dimacs kextractor kextractor.gz kextractor.zst kclause kxsnapshot kxgraph stats) # files reused on cache hits
 
 # checks out a system and prepares it for further processing
 kconfig-checkout(system, revision) {
@@ -64,7 +66,7 @@ compile-lkc-binding(lkc_binding, system, revision, lkc_directory, lkc_target=con
     local kconfig_constructs=(S_UNKNOWN S_BOOLEAN S_TRISTATE S_INT S_HEX S_STRING S_OTHER P_UNKNOWN \
         P_PROMPT P_COMMENT P_MENU P_DEFAULT P_CHOICE P_SELECT P_RANGE P_ENV P_SYMBOL E_SYMBOL E_NOT \
         E_EQUAL E_UNEQUAL E_OR E_AND E_LIST E_RANGE E_CHOICE P_IMPLY E_NONE E_LTH E_LEQ E_GTH E_GEQ \
-        dir_dep sym_is_optional sym_get_choice_prop)
+        dir_dep sym_is_optional sym_get_choice_prop file_write_dep)
 
     # determine which Kconfig constructs this LKC implementation uses and enable them in our custom conf.c
     local kconfig_construct
@@ -74,6 +76,11 @@ compile-lkc-binding(lkc_binding, system, revision, lkc_directory, lkc_target=con
         fi
     done
 
+    # when profiling, compile in the binding's phase timers, which record where extraction spends its time
+    if [[ -n $PROFILE ]]; then
+        sed -i "s/PROFILE_PHASES/1/" "$lkc_directory/conf.c"
+    fi
+
     # run system-specific code for influencing the binding compilation, if needed
     compile-hook kconfig-pre-binding-hook
     for macro in $(kconfig-pre-binding-hook "$system" "$revision" "$lkc_directory"); do
@@ -109,14 +116,16 @@ compile-lkc-binding(lkc_binding, system, revision, lkc_directory, lkc_target=con
 
 # runs KConfigReader to extract a feature-model formula from Kconfig files
 # sets the global MEASURED_TIME variable
-extract-kconfig-model-with-kconfigreader(system, revision, kconfig_file, lkc_binding_file, output_log, options=, timeout=0, date_prefix=) {
-    measure "$timeout" /home/kconfigreader/run.sh \
-        "$(memory-limit 1)" \
-        de.fosd.typechef.kconfig.KConfigReader \
-        --fast \
-        --dumpconf "$lkc_binding_file" \
-        "$kconfig_file" \
-        "$(output-path "$system" "${date_prefix}$revision")" \
+extract-kconfig-model-with-kconfigreader(system, revision, kconfig_file, lkc_binding_file, output_log, options=, timeout=0, date_prefix=, manifest_file=) {
+    # KConfigReader runs dumpconf without our options, so we request its statistics and manifest with environment variables
+    DUMPCONF_STATS=$(output-path "$system" "${date_prefix}$revision.stats") DUMPCONF_MANIFEST=$manifest_file \
+        measure "$timeout" /home/kconfigreader/run.sh \
+            "$(memory-limit 1)" \
+            de.fosd.typechef.kconfig.KConfigReader \
+            --fast \
+            --dumpconf "$lkc_binding_file" \
+            "$kconfig_file" \
+            "$(output-path "$system" "${date_prefix}$revision")" \
         | tee "$output_log"
     MEASURED_TIME=$(grep -oP "^measure_time=\K.*" < "$output_log")
     # as documented in the README file, we make no decision regarding tristate or Boolean semantics by default
@@ -133,13 +142,57 @@ extract-kconfig-model-with-kconfigreader(system, revision, kconfig_file, lkc_bin
 
 # runs KClause to extract a feature-model formula from Kconfig files
 # sets the global MEASURED_TIME variable
-extract-kconfig-model-with-kclause(system, revision, kconfig_file, lkc_binding_file, kconfig_model, features_file, output_log, options=, timeout=0, date_prefix=) {
+extract-kconfig-model-with-kclause(system, revision, kconfig_file, lkc_binding_file, kconfig_model, features_file, output_log, options=, timeout=0, date_prefix=, manifest_file=) {
+    # kextractor can also Tseitin-transform the constraints natively, which bypasses KClause and z3 entirely
+    # we do not use this CNF for further processing, but we store it nonetheless if requested (opt-in to save disk space)
+    local dimacs_file=
+    if [[ $options == *"--with-dimacs"* ]]; then
+        dimacs_file=$(output-path "$system" "${date_prefix}$revision.dimacs")
+    fi
+    # with kclause-native, kextractor writes the .model file itself, which skips KClause, z3, and kclause2model.py
+    # this only supports the Boolean encoding and does not run the kclause-post-binding-hook, as it only fixes input for KClause
+    local native_kconfig_model=
+    if [[ $options == *"kclause-native"* ]]; then
+        native_kconfig_model=$kconfig_model
+    fi
+    # the binary snapshot (see kextractor-snapshot.h) is also opt-in, as it is only needed for reprocessing the parsed model
+    local snapshot_file=
+    if [[ $options == *"--with-snapshot"* ]]; then
+        snapshot_file=$(output-path "$system" "${date_prefix}$revision.kxsnapshot")
+    fi
+    # the binary dependency graph is opt-in as well, as it is only needed for graph-based analyses (e.g., variable orders)
+    local graph_file=
+    if [[ $options == *"--with-graph"* ]]; then
+        graph_file=$(output-path "$system" "${date_prefix}$revision.kxgraph")
+    fi
+    # with kclause-order-ORDER (menu, bfs, rcm, or mincut), the features in the DIMACS and .model files are numbered in the given order
+    local variable_order=
+    if [[ $options == *"kclause-order-"* ]]; then
+        variable_order=${options#*kclause-order-}
+        variable_order=${variable_order%%[^a-z]*}
+    fi
+    # with kclause-choice-ENCODING (sequential, commander, or product), large choices are encoded with auxiliary variables
+    local choice_encoding=
+    if [[ $options == *"kclause-choice-"* ]]; then
+        choice_encoding=${options#*kclause-choice-}
+        choice_encoding=${choice_encoding%%[^a-z]*}
+    fi
+    # with kclause-canonical, symbols, selects, and choice members are sorted by name instead of LKC's hash-table order
+    # then, revisions with identical Kconfig models yield identical files, which remove-duplicate-files can detect
+    local canonical=
+    if [[ $options == *"kclause-canonical"* ]]; then
+        canonical=y
+    fi
     measure "$timeout" /home/kextractor.sh \
         "$lkc_binding_file" \
         "$(output-path "$system" "${date_prefix}$revision.kextractor")" \
-        "$features_file" "$kconfig_file" \
+        "$features_file" "$kconfig_file" "$dimacs_file" "$native_kconfig_model" "$snapshot_file" "$canonical" \
+        "$(output-path "$system" "${date_prefix}$revision.stats")" "$graph_file" "$variable_order" "$choice_encoding" "$manifest_file" \
         | tee "$output_log"
     MEASURED_TIME=$(grep -oP "^measure_time=\K.*" < "$output_log")
+    if [[ -n $native_kconfig_model ]]; then
+        return
+    fi
     compile-hook kclause-post-binding-hook
     kclause-post-binding-hook "$system" "$revision" "$date_prefix"
     # as documented in the README file, we consider --disable-tristate-support to be the sensible default
@@ -248,21 +301,208 @@ remove-environment-variable-imports(file_query...) {
     find . "${file_query[@]}" -exec sed -i '/option env/d' {} \;
 }
 
+# returns the prefix used for the names of extracted files, which may start with the formatted date of the revision
+kconfig-date-prefix(system, revision, date_prefix=) {
+    if [[ -n $date_prefix ]]; then
+        echo "[$(date -d "@$(git -C "$(input-directory)/$system" log -1 --format="%ct" "$(revision-without-context "$revision")")" +"$date_prefix")]"
+    fi
+}
+
+# with --options kconfig-cache, extracted models are cached by the manifest of the parsed Kconfig files
+# the manifest lists the git blob ID of each file LKC has opened and the value of each environment variable it has read
+# the LKC binding writes it with --manifest during the extraction, so the Kconfig files are parsed only once
+# to find a cached model before the extraction, the manifest of the most recently extracted revision is checked against the blobs of the next revision,
+# so that unchanged revisions are neither checked out nor parsed, and their LKC bindings are not even compiled
+# if this predicted manifest equals that of an earlier revision (extracted with the same binding and options), its model is reused
+kconfig-cache-enabled(extractor, options=) {
+    [[ $options == *"kconfig-cache"* ]] && [[ $extractor != configfix ]]
+}
+
+# identifies the LKC binding by the git tree of its LKC implementation, or by its file if it was compiled for another revision
+# returns nothing if the binding cannot be identified (e.g., if the LKC directory contains wildcards), which disables caching
+kconfig-binding-key(system, revision, lkc_directory=, lkc_binding_file=) {
+    if [[ -n $lkc_binding_file ]]; then
+        echo "$lkc_binding_file"
+    elif [[ -n $lkc_directory ]]; then
+        lkc_directory=${lkc_directory#./}
+        git -C "$(input-directory)/$system" rev-parse -q --verify \
+            "$(revision-without-context "$revision"):${lkc_directory%/}" 2>/dev/null || true
+    fi
+}
+
+# computes the cache key of a model from its manifest and everything else that influences the extraction
+# KERNELVERSION is ignored, as we only define it to avoid warnings (see linux.sh), so reused files may mention an older version
+kconfig-manifest-digest(manifest_file, extractor, binding_key=, kconfig_file, options=) {
+    if [[ -z $binding_key ]] || ! grep -q "^file " "$manifest_file"; then
+        return
+    fi
+    {
+        grep -v "^env KERNELVERSION " "$manifest_file" | LC_ALL=C sort
+        echo "extractor $extractor"
+        echo "binding $binding_key"
+        echo "kconfig $kconfig_file"
+        echo "options $options"
+    } | sha1sum | cut -d' ' -f1
+}
+
+# predicts the manifest of a revision from the manifest of another revision, assuming that the same files are parsed
+# this looks up the blob IDs of the files in git and the values of the environment variables in the given environment
+predict-kconfig-manifest(system, revision, manifest_file, environment=) {
+    git -C "$(input-directory)/$system" ls-tree -r --full-tree "$(revision-without-context "$revision")" \
+        | awk -F'\t' '
+            NR == FNR { split($1, object, " "); blobs[$2] = object[3]; next }
+            /^file / {
+                path = substr($0, index(substr($0, 6), " ") + 6)
+                normalized_path = path
+                sub(/^(\.\/)+/, "", normalized_path)
+                print "file " (normalized_path in blobs ? blobs[normalized_path] : "-") " " path
+            }' - "$manifest_file"
+    local name
+    while read -r name; do
+        echo "env $name $(set-environment "$environment"; printenv "$name" || true)"
+    done < <(grep -oP "^env \K[^ ]*" "$manifest_file")
+}
+
+# returns the model file of a cached model with the given digest, if any
+cached-kconfig-model(system, digest=) {
+    if [[ -n $digest ]] && [[ -f $(output-path "$KCONFIG_MANIFESTS_OUTPUT_CSV") ]]; then
+        awk -F, -v system_name="$system" -v digest="$digest" '$1 == system_name && $4 == digest { print $5; exit }' \
+            "$(output-path "$KCONFIG_MANIFESTS_OUTPUT_CSV")"
+    fi
+}
+
+# returns a field of the extraction result for the given model file
+cached-kconfig-model-field(model_file, field) {
+    awk -F, -v model_file="$model_file" -v idx="$(table-field-index "$(output-csv)" "$field")" \
+        '$8 == model_file { print $idx; exit }' "$(output-csv)"
+}
+
+# copies the files extracted for a cached model, so that they belong to the given revision
+# sets the global MEASURED_TIME variable to the extraction time of the cached model
+reuse-kconfig-model(system, revision, cached_model, date_prefix=) {
+    local cached_prefix prefix extension
+    cached_prefix=$(output-path "${cached_model%.model}")
+    prefix=$(output-path "$system" "${date_prefix}$revision")
+    for extension in "${KCONFIG_MODEL_EXTENSIONS[@]}"; do
+        if [[ -f $cached_prefix.$extension ]]; then
+            cp "$cached_prefix.$extension" "$prefix.$extension"
+        fi
+    done
+    MEASURED_TIME=$(cached-kconfig-model-field "$cached_model" model_time)
+}
+
+# records the manifest of an extracted model, so that later revisions can reuse it
+record-kconfig-manifest(system, revision, digest=, kconfig_model=) {
+    local context=
+    if [[ $revision == *"["* ]]; then
+        context=$(get-context "$revision")
+    fi
+    if [[ -n $digest ]] && [[ $kconfig_model != NA ]]; then
+        echo "$system,$(revision-without-context "$revision"),$context,$digest,$kconfig_model" >> "$(output-path "$KCONFIG_MANIFESTS_OUTPUT_CSV")"
+    fi
+}
+
+# reuses a cached model if the Kconfig files parsed for the most recently extracted revision are unchanged in the given revision
+# this needs no checkout, so it is called before the LKC binding is compiled and the model is extracted
+# if no binding is compiled, the binding of the cached model is recorded for this revision
+extract-cached-kconfig-model(extractor, system, revision, kconfig_file, lkc_binding_file=, lkc_directory=, environment=, options=, date_prefix=, record_binding=) {
+    local context= previous_model manifest_file digest cached_model lkc_binding
+    kconfig-cache-enabled "$extractor" "$options" || return 1
+    if [[ $revision == *"["* ]]; then
+        context=$(get-context "$revision")
+    fi
+    if [[ ! -f $(output-path "$KCONFIG_MANIFESTS_OUTPUT_CSV") ]]; then
+        return 1
+    fi
+    previous_model=$(awk -F, -v system_name="$system" -v context="$context" '$1 == system_name && $3 == context { model = $5 } END { print model }' \
+        "$(output-path "$KCONFIG_MANIFESTS_OUTPUT_CSV")")
+    if [[ -z $previous_model ]] || [[ ! -f $(output-path "${previous_model%.model}.manifest") ]]; then
+        return 1
+    fi
+    date_prefix=$(kconfig-date-prefix "$system" "$revision" "$date_prefix")
+    manifest_file=$(output-path "$system" "${date_prefix}$revision.manifest")
+    predict-kconfig-manifest "$system" "$revision" "$(output-path "${previous_model%.model}.manifest")" "$environment" > "$manifest_file"
+    digest=$(kconfig-manifest-digest "$manifest_file" "$extractor" \
+        "$(kconfig-binding-key "$system" "$revision" "$lkc_directory" "$lkc_binding_file")" "$kconfig_file" "$options")
+    cached_model=$(cached-kconfig-model "$system" "$digest")
+    if [[ -z $cached_model ]]; then
+        rm-safe "$manifest_file"
+        return 1
+    fi
+    log "" "$(echo-progress reuse)"
+    reuse-kconfig-model "$system" "$revision" "$cached_model" "$date_prefix"
+    lkc_binding=$(cached-kconfig-model-field "$cached_model" binding_file)
+    if [[ $record_binding == y ]]; then
+        if [[ $lkc_binding != NA ]]; then
+            lkc_binding=$(output-path "$lkc_binding")
+        fi
+        echo "$system,$(revision-without-context "$revision"),$lkc_binding" >> "$(output-path "$LKC_BINDINGS_OUTPUT_CSV")"
+    fi
+    record-kconfig-model "$extractor" "$system" "$revision" "$kconfig_file" "$lkc_binding" \
+        "$(output-path "$system" "${date_prefix}$revision.model")" "$(output-path "$system" "${date_prefix}$revision.features")" \
+        "$environment" "$options" "$digest"
+}
+
+# reads a statistic written by the LKC binding with --stats (e.g., the peak RSS), or NA if it is not available
+kconfig-model-stat(stats_file, field) {
+    if [[ ! -f $stats_file ]]; then
+        echo NA
+        return
+    fi
+    awk -F, -v field="$field" '
+        NR == 1 { for (i = 1; i <= NF; i++) if ($i == field) idx = i }
+        NR == 2 && idx { value = $idx }
+        END { print (value == "" ? "NA" : value) }' "$stats_file"
+}
+
+# checks whether a model has been extracted and records it with its size and extraction time
+# sets the global MEASURED_TIME variable
+record-kconfig-model(extractor, system, revision, kconfig_file, lkc_binding_file, kconfig_model, features_file, environment=, options=, digest=) {
+    local revision_without_context context stats_file=${kconfig_model%.model}.stats
+    revision_without_context=$(revision-without-context "$revision")
+    context=$(get-context "$revision")
+    lkc_binding_file=${lkc_binding_file#"$(output-directory)/"}
+    if is-file-empty "$kconfig_model" || is-file-empty "$features_file"; then
+        log "" "$(echo-fail)"
+        kconfig_model=NA
+    else
+        log "" "$(echo-done)"
+        local features=NA variables literals
+        if [[ $extractor != configfix ]]; then
+            features=$(wc -l < "$features_file")
+        fi
+        # kextractor counts the variables and literals while writing a native model, otherwise we count them in a single pass
+        variables=$(kconfig-model-stat "$stats_file" model_variables)
+        literals=$(kconfig-model-stat "$stats_file" model_literals)
+        if [[ $variables == NA ]] || [[ $literals == NA ]]; then
+            read -r variables literals < <(awk '{
+                n = split($0, parts, "def\\(")
+                literals += n - 1
+                for (i = 2; i <= n; i++)
+                    seen[substr(parts[i], 1, index(parts[i], ")") - 1)]
+            } END { for (name in seen) variables++; print variables + 0, literals + 0 }' "$kconfig_model")
+        fi
+        kconfig_model=${kconfig_model#"$(output-directory)/"}
+    fi
+    echo "$system,$revision_without_context,$context,$lkc_binding_file,$kconfig_file,${environment//,/|},$options,$kconfig_model,$features,$variables,$literals,$MEASURED_TIME,$(kconfig-model-stat "$stats_file" parse_time),$(kconfig-model-stat "$stats_file" emit_time),$(kconfig-model-stat "$stats_file" peak_rss)" >> "$(output-csv)"
+    record-kconfig-manifest "$system" "$revision" "$digest" "$kconfig_model"
+}
+
 # extracts a feature model in form of a logical formula from a kconfig-based software system
 # it is suggested to run compile-c-binding beforehand, first to get an accurate kconfig parser, second because the make call generates files this function may need
 extract-kconfig-model(extractor, lkc_binding, system, revision, kconfig_file, lkc_binding_file=, lkc_directory, lkc_target=config, lkc_output_directory=, environment=, options=, timeout=0, date_prefix=) {
-    local revision_without_context context time
+    local revision_without_context binding_key=
     revision_without_context=$(revision-without-context "$revision")
-    context=$(get-context "$revision")
+    if kconfig-cache-enabled "$extractor" "$options"; then
+        binding_key=$(kconfig-binding-key "$system" "$revision" "$lkc_directory" "$lkc_binding_file")
+    fi
     if [[ $lkc_binding == $(none) ]] || [[ $lkc_binding_file == $(none) ]]; then
         lkc_binding_file=NA
     else
         lkc_binding_file=${lkc_binding_file:-$(output-path "$LKC_BINDINGS_DIRECTORY" "$system" "$revision_without_context")}
         lkc_binding_file+=.$lkc_binding
     fi
-    if [[ -n $date_prefix ]]; then
-        date_prefix="[$(date -d "@$(git -C "$(input-directory)/$system" log -1 --format="%ct" "$revision_without_context")" +"$date_prefix")]"
-    fi
+    date_prefix=$(kconfig-date-prefix "$system" "$revision" "$date_prefix")
     local file_extension="model"
     if [[ $extractor == configfix ]]; then
         file_extension="model"
@@ -276,6 +516,10 @@ extract-kconfig-model(extractor, lkc_binding, system, revision, kconfig_file, lk
     features_file=$(output-path "$system" "${date_prefix}$revision.features")
     local output_log
     output_log=$(mktemp)
+    local digest= manifest_file=
+    if [[ -n $binding_key ]]; then
+        manifest_file=$(output-path "$system" "${date_prefix}$revision.manifest")
+    fi
     set-environment "$environment"
     if [[ $extractor != configfix ]]; then
         # at this point, the KConfig file should already have been generated by the makefiles during binding compilation
@@ -283,10 +527,14 @@ extract-kconfig-model(extractor, lkc_binding, system, revision, kconfig_file, lk
             if [[ -f $lkc_binding_file ]]; then
                 if [[ $extractor == kconfigreader ]]; then
                     extract-kconfig-model-with-kconfigreader \
-                        "$system" "$revision" "$kconfig_file" "$lkc_binding_file" "$output_log" "$options" "$timeout" "$date_prefix"
+                        "$system" "$revision" "$kconfig_file" "$lkc_binding_file" "$output_log" "$options" "$timeout" "$date_prefix" "$manifest_file"
                 elif [[ $extractor == kclause ]]; then
                     extract-kconfig-model-with-kclause \
-                        "$system" "$revision" "$kconfig_file" "$lkc_binding_file" "$kconfig_model" "$features_file" "$output_log" "$options" "$timeout" "$date_prefix"
+                        "$system" "$revision" "$kconfig_file" "$lkc_binding_file" "$kconfig_model" "$features_file" "$output_log" "$options" "$timeout" "$date_prefix" "$manifest_file"
+                fi
+                # the binding has written the manifest while extracting, so later revisions with the same manifest can reuse this model
+                if [[ -f $manifest_file ]]; then
+                    digest=$(kconfig-manifest-digest "$manifest_file" "$extractor" "$binding_key" "$kconfig_file" "$options")
                 fi
             else
                 echo "LKC binding file $lkc_binding_file does not exist"
@@ -303,21 +551,8 @@ extract-kconfig-model(extractor, lkc_binding, system, revision, kconfig_file, lk
     rm-safe "$output_log"
     pop
     trap - EXIT
-    lkc_binding_file=${lkc_binding_file#"$(output-directory)/"}
-    if is-file-empty "$kconfig_model" || is-file-empty "$features_file"; then
-        log "" "$(echo-fail)"
-        kconfig_model=NA
-    else
-        log "" "$(echo-done)"
-        local features=NA variables=NA literals=NA
-        if [[ $extractor != configfix ]]; then
-            features=$(wc -l < "$features_file")
-        fi
-        variables=$(sed "s/)/)\n/g" < "$kconfig_model" | grep "def(" | sed "s/.*def(\(.*\)).*/\1/g" | sort | uniq | wc -l)
-        literals=$(sed "s/)/)\n/g" < "$kconfig_model" | grep -c "def(")
-        kconfig_model=${kconfig_model#"$(output-directory)/"}
-    fi
-    echo "$system,$revision_without_context,$context,$lkc_binding_file,$kconfig_file,${environment//,/|},$options,$kconfig_model,$features,$variables,$literals,$MEASURED_TIME" >> "$(output-csv)"
+    record-kconfig-model "$extractor" "$system" "$revision" "$kconfig_file" "$lkc_binding_file" "$kconfig_model" "$features_file" \
+        "$environment" "$options" "$digest"
 }
 
 # defines API functions for extracting kconfig models
@@ -349,6 +584,10 @@ register-kconfig-extractor(extractor, lkc_binding, options=, timeout=0, date_pre
             log "" "$(echo-skip)"
             return
         fi
+        if extract-cached-kconfig-model "$EXTRACTOR" "$system" "$revision" "$kconfig_file" "$lkc_binding_file" "$lkc_directory" \
+            "$environment" "$OPTIONS" "$DATE_PREFIX"; then
+            return
+        fi
         kconfig-checkout "$system" "$revision"
         extract-kconfig-model "$EXTRACTOR" "$LKC_BINDING" \
             "$system" "$revision" "$kconfig_file" "$lkc_binding_file" "$lkc_directory" "$lkc_target" "$lkc_output_directory" "$environment" "$OPTIONS" "$TIMEOUT" "$DATE_PREFIX"
@@ -362,6 +601,11 @@ register-kconfig-extractor(extractor, lkc_binding, options=, timeout=0, date_pre
             log "" "$(echo-skip)"
             return
         fi
+        if ! lkc-binding-done "$system" "$revision" && ! kconfig-model-done "$system" "$revision" \
+            && extract-cached-kconfig-model "$EXTRACTOR" "$system" "$revision" "$kconfig_file" "" "$lkc_directory" \
+                "$environment" "$OPTIONS" "$DATE_PREFIX" y; then
+            return
+        fi
         kconfig-checkout "$system" "$revision"
         if [[ $LKC_BINDING != $(none) ]] && ! lkc-binding-done "$system" "$revision" && ! should-skip compile-lkc-binding "" "$system" "$revision"; then
             compile-lkc-binding "$LKC_BINDING" "$system" "$revision" "$lkc_directory" "$lkc_target" "$lkc_output_directory" "$environment"
@@ -377,7 +621,10 @@ register-kconfig-extractor(extractor, lkc_binding, options=, timeout=0, date_pre
         echo system,revision,binding_file > "$(output-path "$LKC_BINDINGS_OUTPUT_CSV")"
     fi
     if [[ ! -f $(output-csv) ]]; then
-        echo system,revision,context,binding_file,kconfig_file,environment,options,model_file,model_features,model_variables,model_literals,model_time > "$(output-csv)"
+        echo system,revision,context,binding_file,kconfig_file,environment,options,model_file,model_features,model_variables,model_literals,model_time,binding_parse_time,binding_emit_time,binding_peak_rss > "$(output-csv)"
+    fi
+    if kconfig-cache-enabled "$extractor" "$options" && [[ ! -f $(output-path "$KCONFIG_MANIFESTS_OUTPUT_CSV") ]]; then
+        echo system,revision,context,digest,model_file > "$(output-path "$KCONFIG_MANIFESTS_OUTPUT_CSV")"
     fi
 }
 
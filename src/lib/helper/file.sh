@@ -21,6 +21,27 @@ rm-if-empty(file) {
     fi
 }
 
+# prints a file, transparently decompressing it if it ends in .gz or .zst (as written by the LKC bindings with --compress)
+cat-decompressed(file) {
+    case "$file" in
+        *.gz) gzip -dc "$file" ;;
+        *.zst) zstd -qdc "$file" ;;
+        *) cat "$file" ;;
+    esac
+}
+
+# returns the given file or, if only a compressed variant of it exists, that variant
+find-decompressible(file) {
+    local extension
+    for extension in "" .zst .gz; do
+        if [[ -f $file$extension ]]; then
+            echo "$file$extension"
+            return
+        fi
+    done
+    echo "$file"
+}
+
 # silently push directory
 push(directory) {
     pushd "$directory" > /dev/null || error "Failed to push directory $directory."
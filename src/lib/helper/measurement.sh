@@ -6,6 +6,7 @@
 measure(timeout=0, command...) {
     assert-array command
     echo "measure_command=${command[*]}"
+    export-profile
     local start
     start=$(date +%s%N)
     local exit_code=0
@@ -8,7 +8,14 @@ record-function-call(__NO_PROFILE__, function_name, stack_trace, duration_us) {
     if [[ -z $PROFILE ]]; then
         return
     fi
-    local profile_file
+    set-profile-file
+    local stage=${INSIDE_STAGE:-$EXPERIMENT_STAGE}
+    echo "$stage,$function_name,$stack_trace,1,$duration_us" >> "$PROFILE_FILE"
+}
+
+# determine the profile file of the current stage and create it if needed
+# sets the global PROFILE_FILE variable
+set-profile-file(__NO_PROFILE__) {
     # inline is-host
     if [[ -z $INSIDE_STAGE ]]; then
         # inline stages-directory + stage-directory
@@ -20,16 +27,26 @@ record-function-call(__NO_PROFILE__, function_name, stack_trace, duration_us) {
         fi
         mkdir -p "$stage_dir"
         # inline stage-prf
-        profile_file="$stage_dir/$OUTPUT_FILE_PREFIX.prf"
+        PROFILE_FILE="$stage_dir/$OUTPUT_FILE_PREFIX.prf"
     else
         # inline output-prf
-        profile_file="$DOCKER_OUTPUT_DIRECTORY/$OUTPUT_FILE_PREFIX.prf"
+        PROFILE_FILE="$DOCKER_OUTPUT_DIRECTORY/$OUTPUT_FILE_PREFIX.prf"
     fi
-    if [[ ! -f $profile_file ]]; then
-        echo "stage,function,stack,calls,total_time_us" > "$profile_file"
+    if [[ ! -f $PROFILE_FILE ]]; then
+        echo "stage,function,stack,calls,total_time_us" > "$PROFILE_FILE"
     fi
-    local stage=${INSIDE_STAGE:-$EXPERIMENT_STAGE}
-    echo "$stage,$function_name,$stack_trace,1,$duration_us" >> "$profile_file"
+}
+
+# allow external programs run by the calling function to append their own phases to the profile (e.g., the LKC bindings)
+# they are passed the profile file, the stage, and the stack trace of the calling function, under which they nest their phases
+export-profile(__NO_PROFILE__) {
+    if [[ -z $PROFILE ]]; then
+        return
+    fi
+    set-profile-file
+    export PROFILE_FILE PROFILE_STAGE PROFILE_STACK
+    PROFILE_STAGE=${INSIDE_STAGE:-$EXPERIMENT_STAGE}
+    PROFILE_STACK=$(IFS=";"; echo "${FUNCNAME[*]:1}")
 }
 
 # combine multiple profile files
@@ -61,7 +78,6 @@ convert-to-speedscope() {
             dur_ms = int($5 / 1000); 
             stage = $1;
             stack = $3; 
-            calls = $4; 
             # reverse the stack order for speedscope (root-to-leaf)
             n = split(stack, frames, ";");
             reversed = "";
@@ -72,10 +88,8 @@ convert-to-speedscope() {
             }
             # prepend stage name to the stack trace
             reversed = stage ";" reversed;
-            for(i = 0; i < calls; i++)
-            { 
-                print reversed " " dur_ms;
-            } 
+            # the duration is the total of all calls (e.g., of a phase of an LKC binding), so it is printed only once
+            print reversed " " dur_ms;
         }'
 }
 
@@ -168,8 +168,9 @@ define-stages() {
     # this allows to flexibly enable (repeated or single iterations of) the desired CNF transformations
     # some of these transformations are fully deterministic and need not be iterated (e.g., Z3), while KConfigReader is NOT deterministic
     # FeatJAR is disabled by default, because it is experimental
-    transform-to-dimacs(input=extract-kconfig-models, output=transform-to-dimacs, timeout=0, jobs=1, iteration_field=, with_featureide=, with_featjar=, with_kconfigreader=, with_z3=, with_clausy=, clausy_options=) {
-        if [[ -z $with_featureide ]] && [[ -z $with_featjar ]] && [[ -z $with_kconfigreader ]] && [[ -z $with_z3 ]] && [[ -z $with_clausy ]]; then
+    # model2dimacs is disabled by default, so earlier experiments are reproduced with KConfigReader's original transformation
+    transform-to-dimacs(input=extract-kconfig-models, output=transform-to-dimacs, timeout=0, jobs=1, iteration_field=, with_featureide=, with_featjar=, with_kconfigreader=, with_z3=, with_clausy=, clausy_options=, with_model2dimacs=, model2dimacs_options=) {
+        if [[ -z $with_featureide ]] && [[ -z $with_featjar ]] && [[ -z $with_kconfigreader ]] && [[ -z $with_z3 ]] && [[ -z $with_clausy ]] && [[ -z $with_model2dimacs ]]; then
             with_featureide=y
             with_featjar=n
             with_kconfigreader=y
@@ -185,6 +186,8 @@ define-stages() {
         [[ $with_z3 == y ]] && with_z3=1
         [[ $with_clausy == n ]] && with_clausy=
         [[ $with_clausy == y ]] && with_clausy=1
+        [[ $with_model2dimacs == n ]] && with_model2dimacs=
+        [[ $with_model2dimacs == y ]] && with_model2dimacs=1
         local inputs=()
 
         # distributive tranformation with FeatureIDE (does not scale to large formulas)
@@ -211,14 +214,17 @@ define-stages() {
             inputs+=("transform-to-dimacs-with-featjar")
         fi
 
-        if [[ -n $with_kconfigreader ]]; then
-            # intermediate format for CNF transformation with KConfigReader
+        if [[ -n $with_kconfigreader ]] || [[ -n $with_model2dimacs ]]; then
+            # intermediate format for CNF transformation with KConfigReader and model2dimacs
             transform-with-featjar \
                 --transformer transform-to-model-with-featureide \
                 --output-extension featureide.model \
                 --input "$input" \
                 --timeout "$timeout" \
                 --jobs "$jobs"
+        fi
+
+        if [[ -n $with_kconfigreader ]]; then
             # Plaisted-Greenbaum CNF tranformation with KConfigReader (preserves satisfiability, but not model count)
             iterate \
                 --iterations "$with_kconfigreader" \
@@ -236,6 +242,25 @@ define-stages() {
             inputs+=("transform-to-dimacs-with-kconfigreader")
         fi
 
+        if [[ -n $with_model2dimacs ]]; then
+            # streaming distributive or Plaisted-Greenbaum/Tseitin CNF transformation, chosen per constraint (options configurable)
+            iterate \
+                --iterations "$with_model2dimacs" \
+                --iteration-field "$iteration_field" \
+                --file-fields dimacs_file \
+                --image kconfigreader \
+                --input transform-to-model-with-featureide \
+                --output transform-to-dimacs-with-model2dimacs \
+                --resumable y \
+                --command transform-to-dimacs-with-model2dimacs \
+                --input-extension featureide.model \
+                --options "$model2dimacs_options" \
+                --timeout "$timeout" \
+                --jobs "$jobs"
+            join-into transform-to-model-with-featureide transform-to-dimacs-with-model2dimacs
+            inputs+=("transform-to-dimacs-with-model2dimacs")
+        fi
+
         if [[ -n $with_z3 ]]; then
             # intermediate format for CNF transformation with Z3
             transform-with-featjar \
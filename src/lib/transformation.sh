@@ -127,6 +127,21 @@ transform-to-dimacs-with-kconfigreader(input_extension=model, output_extension=d
         "$jobs"
 }
 
+# transforms kconfigreader model files to DIMACS using model2dimacs, which streams the constraints instead of loading them into a JVM
+# options controls the CNF transformation (e.g., --encoding tseitin or --distributive never)
+transform-to-dimacs-with-model2dimacs(input_extension=model, output_extension=dimacs, options=, timeout=0, jobs=1) {
+    transform-files \
+        "$(input-csv)" \
+        "$input_extension" \
+        "$output_extension" \
+        transform-to-dimacs-with-model2dimacs \
+        "$(lambda input,output 'echo /home/model2dimacs '"$options"' "$input" "$output"')" \
+        "$(dimacs-data-fields)" \
+        "$(dimacs-data-extractor)" \
+        "$timeout" \
+        "$jobs"
+}
+
 # transforms SMT files to DIMACS using Z3
 transform-smt-to-dimacs-with-z3(input_extension=smt, output_extension=dimacs, timeout=0, jobs=1) {
     transform-files \
@@ -193,10 +208,10 @@ transform-dimacs-to-backbone-dimacs-with(transformer, input_extension=dimacs, ou
 # thus, we recreate it here from the intermediate files, which creates a more reliable and standardized list of features
 compute-model-features-helper(input, output) {
     local kextractor_file
-    kextractor_file="$(dirname "$input")/$(basename "$input" .model).kextractor"
+    kextractor_file=$(find-decompressible "$(dirname "$input")/$(basename "$input" .model).kextractor")
     if [[ -f $kextractor_file ]]; then
         # this formula was extracted with KClause
-        grep -E "^config " "$kextractor_file" | cut -d' ' -f2 | sed 's/^CONFIG_//'
+        cat-decompressed "$kextractor_file" | grep -E "^config " | cut -d' ' -f2 | sed 's/^CONFIG_//'
     else
         # this formula was either extracted with KConfigReader (and already mentions all variables in the model file) ...
         grep -E "^#item " "$input" | cut -d' ' -f2